@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "AllocationTracker.h"
+
+#include <atomic>
+#include <new>
+#include <cstdlib>
+
+using namespace giselle;
+
+static std::atomic<std::uint64_t> n_allocations(0);
+static std::atomic<std::uint64_t> n_deallocations(0);
+static std::atomic<std::uint64_t> n_bytes(0);
+static std::atomic<AllocationTracker::Listener*> p_listener(nullptr);
+
+bool AllocationTracker::isTracking(void)
+{
+#ifdef GISELLE_TRACK_ALLOCATIONS
+	return true;
+#else
+	return false;
+#endif
+}
+
+AllocationTracker::Counters AllocationTracker::getCounters(void)
+{
+	Counters c;
+	c.allocations = n_allocations.load(std::memory_order_relaxed);
+	c.deallocations = n_deallocations.load(std::memory_order_relaxed);
+	c.bytes = n_bytes.load(std::memory_order_relaxed);
+	return c;
+}
+
+void AllocationTracker::setListener(Listener* p_listener)
+{
+	::p_listener.store(p_listener, std::memory_order_release);
+}
+
+#ifdef GISELLE_TRACK_ALLOCATIONS
+
+// set while the listener runs, so that its own allocations are not reported
+static thread_local bool in_listener = false;
+
+static void* tracked_alloc(std::size_t size)
+{
+	if (size == 0) size = 1;
+	void* p;
+	while ((p = std::malloc(size)) == nullptr)
+	{
+		std::new_handler handler = std::get_new_handler();
+		if (handler == nullptr) return nullptr;
+		handler();
+	}
+
+	n_allocations.fetch_add(1, std::memory_order_relaxed);
+	n_bytes.fetch_add(size, std::memory_order_relaxed);
+	AllocationTracker::Listener* p_l = p_listener.load(std::memory_order_acquire);
+	if (p_l != nullptr && !in_listener)
+	{
+		in_listener = true;
+		p_l->allocated(size);
+		in_listener = false;
+	}
+	return p;
+}
+
+static void tracked_free(void* p)
+{
+	if (p == nullptr) return;
+	n_deallocations.fetch_add(1, std::memory_order_relaxed);
+	AllocationTracker::Listener* p_l = p_listener.load(std::memory_order_acquire);
+	if (p_l != nullptr && !in_listener)
+	{
+		in_listener = true;
+		p_l->deallocated();
+		in_listener = false;
+	}
+	std::free(p);
+}
+
+void* operator new(std::size_t size)
+{
+	void* p = tracked_alloc(size);
+	if (p == nullptr) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](std::size_t size)
+{
+	void* p = tracked_alloc(size);
+	if (p == nullptr) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	return tracked_alloc(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return tracked_alloc(size);
+}
+
+void operator delete(void* p) noexcept
+{
+	tracked_free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	tracked_free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+	tracked_free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+	tracked_free(p);
+}
+
+#endif
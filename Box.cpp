@@ -23,9 +23,13 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 #include "Box.h"
+#include "ModelBuilder.h"
+#include "MeshOptimizer.h"
+#include "MeshCache.h"
 
 #include <string.h>
 
+using namespace giselle;
 using namespace giselle::model;
 
 static const float VERTEX_ARRAY_TEMPLATE[] =
@@ -62,33 +66,36 @@ static const unsigned int INDEX_ARRAY[] =
 	20, 21, 22,   22, 23, 20 	// right
 };
 
-Model giselle::model::Box(float x1, float x2, float y1, float y2, float z1, float z2)
+static std::shared_ptr<const MeshData> generate_box(float x1, float x2, float y1, float y2,
+		float z1, float z2)
 {
-	if (x2 <= x1 || y2 <= y1 || z2 <= z1)
-		return Model();
-
 	constexpr unsigned int nVertices = 24;
 	constexpr unsigned int nTriangles = 12;
-	float* vertex_array = new float[nVertices*3];
-	float* vertex_normal_array = new float[nVertices*3];
-	unsigned int* index_array = new unsigned int[nTriangles*3];
-
-	memcpy(vertex_array, VERTEX_ARRAY_TEMPLATE, nVertices*3*sizeof(float));
+	ModelBuilder builder(nVertices, nTriangles);
+	float* vertex_array = builder.getVertexArray();
 
 	for (auto i = 0u ; i < nVertices*3 ; i+=3)
 	{
-		vertex_array[i]   = (vertex_array[i]   >= 1.0f) ? x2 : x1;
-		vertex_array[i+1] = (vertex_array[i+1] >= 1.0f) ? y2 : y1;
-		vertex_array[i+2] = (vertex_array[i+2] >= 1.0f) ? z2 : z1;
+		vertex_array[i]   = (VERTEX_ARRAY_TEMPLATE[i]   >= 1.0f) ? x2 : x1;
+		vertex_array[i+1] = (VERTEX_ARRAY_TEMPLATE[i+1] >= 1.0f) ? y2 : y1;
+		vertex_array[i+2] = (VERTEX_ARRAY_TEMPLATE[i+2] >= 1.0f) ? z2 : z1;
 	}
 
-	memcpy(vertex_normal_array, VERTEX_NORMAL_ARRAY, nVertices*3*sizeof(float));
-	memcpy(index_array, INDEX_ARRAY, nTriangles*3*sizeof(unsigned int));
+	memcpy(builder.getVertexNormalArray(), VERTEX_NORMAL_ARRAY, nVertices*3*sizeof(float));
+	memcpy(builder.getIndexArray(), INDEX_ARRAY, nTriangles*3*sizeof(unsigned int));
 
-	Model m(nVertices, nTriangles, vertex_array, vertex_normal_array, index_array);
+	builder.setBounds(math::Vector4f(x1, y1, z1), math::Vector4f(x2, y2, z2));
+	return builder.buildMesh();
+}
+
+Model giselle::model::Box(float x1, float x2, float y1, float y2, float z1, float z2)
+{
+	if (x2 <= x1 || y2 <= y1 || z2 <= z1)
+		return Model();
 
-	delete[] vertex_array;
-	delete[] vertex_normal_array;
-	delete[] index_array;
-	return m;
+	// optimized meshes have another order, keep them apart
+	MeshCache::Key key(MeshCache::BOX, {x1, x2, y1, y2, z1, z2,
+			MeshOptimizer::isAutomatic() ? 1.0f : 0.0f});
+	return Model(MeshCache::shared().get(key,
+			[=]() { return generate_box(x1, x2, y1, y2, z1, z2); }));
 }
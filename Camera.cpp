@@ -127,6 +127,12 @@ bool Camera::setRange(float near, float far)
 	return true;
 }
 
+void Camera::getRange(float& near, float& far) const
+{
+	near = this->near;
+	far = this->far;
+}
+
 bool Camera::setAspectRatio(float w, float h)
 {
 	if (w <= 0.0f || h <= 0.0f)
@@ -0,0 +1,359 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "ClusteredLighting.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include "JobSystem.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace giselle;
+using namespace math;
+
+// padding of the column bounds, never touched by a light
+static const float FAR_AWAY = 1e30f;
+
+ClusteredLighting::ClusteredLighting(unsigned int tiles_x, unsigned int tiles_y,
+									unsigned int slices)
+:	tiles_x(std::min(std::max(tiles_x, 1u), (unsigned int)MAX_TILES))
+,	tiles_y(std::min(std::max(tiles_y, 1u), (unsigned int)MAX_TILES))
+,	slices(std::max(slices, 1u))
+,	stride_x((this->tiles_x + 3) & ~3u)
+,	depth_scale(0.0f)
+,	depth_bias(0.0f)
+,	perspective(true)
+,	scale_x(1.0f)
+,	scale_y(1.0f)
+,	col_min(this->slices * this->stride_x, FAR_AWAY)
+,	col_max(this->slices * this->stride_x, FAR_AWAY)
+,	row_min(this->slices * this->tiles_y)
+,	row_max(this->slices * this->tiles_y)
+,	slice_near(this->slices)
+,	slice_far(this->slices)
+,	pairs(this->slices)
+,	slice_offset(this->slices)
+,	grid(this->tiles_x * this->tiles_y * this->slices * 2, 0)
+,	n_global(0)
+{
+}
+
+unsigned int ClusteredLighting::getTilesX(void) const
+{
+	return this->tiles_x;
+}
+
+unsigned int ClusteredLighting::getTilesY(void) const
+{
+	return this->tiles_y;
+}
+
+unsigned int ClusteredLighting::getSlices(void) const
+{
+	return this->slices;
+}
+
+unsigned int ClusteredLighting::getClusterCount(void) const
+{
+	return this->tiles_x * this->tiles_y * this->slices;
+}
+
+float ClusteredLighting::getDepthScale(void) const
+{
+	return this->depth_scale;
+}
+
+float ClusteredLighting::getDepthBias(void) const
+{
+	return this->depth_bias;
+}
+
+const unsigned int* ClusteredLighting::getGrid(void) const
+{
+	return this->grid.data();
+}
+
+const unsigned int* ClusteredLighting::getIndices(void) const
+{
+	return this->indices.data();
+}
+
+unsigned int ClusteredLighting::getIndexCount(void) const
+{
+	return this->indices.size();
+}
+
+unsigned int ClusteredLighting::getGlobalCount(void) const
+{
+	return this->n_global;
+}
+
+void ClusteredLighting::build(const Mat4x4f& view, const Mat4x4f& proj, bool perspective,
+							float near, float far,
+							const float* light_pos, const float* light_color, unsigned int n)
+{
+	this->calc_bounds(proj, perspective, near, far);
+
+	// lights reaching every cluster go first in the index list
+	this->indices.clear();
+	this->lights.clear();
+	for (unsigned int l = 0 ; l < n ; l++)
+	{
+		const float* pos = &light_pos[l * 4];
+		const float r = (pos[3] == 0.0f) ? -1.0f : lightRange(&light_color[l * 4]);
+		if (r < 0.0f)
+		{
+			this->indices.push_back(l);
+			continue;
+		}
+		if (r == 0.0f) continue;
+
+		ViewLight v;
+		v.x = view.get(0,0) * pos[0] + view.get(0,1) * pos[1] + view.get(0,2) * pos[2]
+			+ view.get(0,3);
+		v.y = view.get(1,0) * pos[0] + view.get(1,1) * pos[1] + view.get(1,2) * pos[2]
+			+ view.get(1,3);
+		v.d = -(view.get(2,0) * pos[0] + view.get(2,1) * pos[1] + view.get(2,2) * pos[2]
+			+ view.get(2,3));
+		v.r = r;
+		v.index = l;
+
+		if (v.d + r < near || v.d - r > far) continue;
+		float d0 = std::max(v.d - r, near);
+		float d1 = std::min(v.d + r, far);
+		v.s0 = (int)std::floor(std::log(d0) * this->depth_scale + this->depth_bias);
+		v.s1 = (int)std::floor(std::log(d1) * this->depth_scale + this->depth_bias);
+		v.s0 = std::max(0, std::min(v.s0, (int)this->slices - 1));
+		v.s1 = std::max(0, std::min(v.s1, (int)this->slices - 1));
+		this->lights.push_back(v);
+	}
+	this->n_global = this->indices.size();
+
+	// each slice only writes to its own clusters
+	JobSystem::shared().parallelFor(0, this->slices, 1,
+		[this](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int s = begin ; s < end ; s++)
+				this->assign_slice(s);
+		});
+
+	unsigned int total = this->n_global;
+	for (unsigned int s = 0 ; s < this->slices ; s++)
+	{
+		this->slice_offset[s] = total;
+		total += this->pairs[s].size() / 2;
+	}
+	this->indices.resize(total);
+
+	JobSystem::shared().parallelFor(0, this->slices, 1,
+		[this](unsigned int begin, unsigned int end)
+		{
+			const unsigned int n_tiles = this->tiles_x * this->tiles_y;
+			for (unsigned int s = begin ; s < end ; s++)
+			{
+				// point each cluster to the end of its list, then fill it backwards
+				unsigned int* cells = &this->grid[s * n_tiles * 2];
+				unsigned int offset = this->slice_offset[s];
+				for (unsigned int t = 0 ; t < n_tiles ; t++)
+				{
+					offset += cells[t * 2 + 1];
+					cells[t * 2] = offset;
+				}
+
+				const std::vector<unsigned int>& p = this->pairs[s];
+				for (unsigned int k = p.size() ; k > 0 ; k -= 2)
+					this->indices[--cells[p[k - 2] * 2]] = p[k - 1];
+			}
+		});
+}
+
+void ClusteredLighting::calc_bounds(const Mat4x4f& proj, bool perspective,
+									float near, float far)
+{
+	this->perspective = perspective;
+	this->scale_x = proj.get(0,0);
+	this->scale_y = proj.get(1,1);
+
+	const float log_range = std::log(far / near);
+	this->depth_scale = this->slices / log_range;
+	this->depth_bias = -std::log(near) * this->depth_scale;
+
+	for (unsigned int s = 0 ; s < this->slices ; s++)
+	{
+		const float dn = near * std::exp(log_range * s / this->slices);
+		const float df = near * std::exp(log_range * (s + 1) / this->slices);
+		this->slice_near[s] = dn;
+		this->slice_far[s] = df;
+
+		// tiles are uniform in normalized device coordinates
+		for (unsigned int i = 0 ; i < this->tiles_x ; i++)
+		{
+			const float a = (-1.0f + 2.0f * i / this->tiles_x) / this->scale_x;
+			const float b = (-1.0f + 2.0f * (i + 1) / this->tiles_x) / this->scale_x;
+			float& lo = this->col_min[s * this->stride_x + i];
+			float& hi = this->col_max[s * this->stride_x + i];
+			lo = perspective ? std::min(a * dn, a * df) : a;
+			hi = perspective ? std::max(b * dn, b * df) : b;
+		}
+		for (unsigned int j = 0 ; j < this->tiles_y ; j++)
+		{
+			const float a = (-1.0f + 2.0f * j / this->tiles_y) / this->scale_y;
+			const float b = (-1.0f + 2.0f * (j + 1) / this->tiles_y) / this->scale_y;
+			float& lo = this->row_min[s * this->tiles_y + j];
+			float& hi = this->row_max[s * this->tiles_y + j];
+			lo = perspective ? std::min(a * dn, a * df) : a;
+			hi = perspective ? std::max(b * dn, b * df) : b;
+		}
+	}
+}
+
+// tile range covered by [lo, hi] at view depths [d0, d1]
+static void tile_range(float lo, float hi, float d0, float d1, bool perspective,
+						float scale, unsigned int n_tiles, int& t0, int& t1)
+{
+	if (perspective)
+	{
+		float a = std::min(lo / d0, lo / d1);
+		float b = std::max(hi / d0, hi / d1);
+		lo = a;
+		hi = b;
+	}
+	t0 = (int)std::floor((lo * scale + 1.0f) * 0.5f * n_tiles);
+	t1 = (int)std::floor((hi * scale + 1.0f) * 0.5f * n_tiles);
+	t0 = std::max(t0, 0);
+	t1 = std::min(t1, (int)n_tiles - 1);
+}
+
+static float axis_distance(float v, float lo, float hi)
+{
+	return (v < lo) ? lo - v : (v > hi) ? v - hi : 0.0f;
+}
+
+void ClusteredLighting::assign_slice(unsigned int s)
+{
+	std::vector<unsigned int>& out = this->pairs[s];
+	out.clear();
+
+	const unsigned int n_tiles = this->tiles_x * this->tiles_y;
+	unsigned int* cells = &this->grid[s * n_tiles * 2];
+	for (unsigned int t = 0 ; t < n_tiles ; t++)
+		cells[t * 2 + 1] = 0;
+
+	const float dn = this->slice_near[s];
+	const float df = this->slice_far[s];
+	const float* c_min = &this->col_min[s * this->stride_x];
+	const float* c_max = &this->col_max[s * this->stride_x];
+	const float* r_min = &this->row_min[s * this->tiles_y];
+	const float* r_max = &this->row_max[s * this->tiles_y];
+
+	alignas(16) float dx2[MAX_TILES];
+
+	for (const ViewLight& v : this->lights)
+	{
+		if ((int)s < v.s0 || (int)s > v.s1) continue;
+
+		const float dz = axis_distance(v.d, dn, df);
+		const float rem_z = v.r * v.r - dz * dz;
+		if (rem_z < 0.0f) continue;
+
+		// conservative tile ranges, refined by the distance tests below
+		const float d0 = std::max(dn, v.d - v.r);
+		const float d1 = std::min(df, v.d + v.r);
+		int i0, i1, j0, j1;
+		tile_range(v.x - v.r, v.x + v.r, d0, d1, this->perspective, this->scale_x,
+				this->tiles_x, i0, i1);
+		if (i0 > i1) continue;
+		tile_range(v.y - v.r, v.y + v.r, d0, d1, this->perspective, this->scale_y,
+				this->tiles_y, j0, j1);
+		if (j0 > j1) continue;
+
+		const int g0 = i0 & ~3;
+#ifdef __SSE2__
+		const __m128 x = _mm_set1_ps(v.x);
+		const __m128 zero = _mm_setzero_ps();
+		for (int i = g0 ; i <= i1 ; i += 4)
+		{
+			__m128 dx = _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&c_min[i]), x),
+									_mm_sub_ps(x, _mm_loadu_ps(&c_max[i])));
+			dx = _mm_max_ps(dx, zero);
+			_mm_store_ps(&dx2[i], _mm_mul_ps(dx, dx));
+		}
+#else
+		for (int i = i0 ; i <= i1 ; i++)
+		{
+			float dx = axis_distance(v.x, c_min[i], c_max[i]);
+			dx2[i] = dx * dx;
+		}
+#endif
+
+		for (int j = j0 ; j <= j1 ; j++)
+		{
+			const float dy = axis_distance(v.y, r_min[j], r_max[j]);
+			const float rem = rem_z - dy * dy;
+			if (rem < 0.0f) continue;
+
+			const unsigned int row = j * this->tiles_x;
+#ifdef __SSE2__
+			const __m128 r = _mm_set1_ps(rem);
+			for (int i = g0 ; i <= i1 ; i += 4)
+			{
+				int mask = _mm_movemask_ps(_mm_cmple_ps(_mm_load_ps(&dx2[i]), r));
+				for ( ; mask != 0 ; mask &= mask - 1)
+				{
+					const int t = i + __builtin_ctz(mask);
+					if (t < i0 || t > i1) continue;
+					out.push_back(row + t);
+					out.push_back(v.index);
+					cells[(row + t) * 2 + 1]++;
+				}
+			}
+#else
+			for (int i = i0 ; i <= i1 ; i++)
+			{
+				if (dx2[i] > rem) continue;
+				out.push_back(row + i);
+				out.push_back(v.index);
+				cells[(row + i) * 2 + 1]++;
+			}
+#endif
+		}
+	}
+}
+
+// ----- STATIC FUNCTIONS ----
+
+float ClusteredLighting::lightRange(const float* color)
+{
+	const float attenuation = color[3];
+	if (attenuation <= 0.0f) return -1.0f;
+
+	const float intensity = std::max(color[0], std::max(color[1], color[2]));
+	if (intensity <= LIGHT_CUTOFF) return 0.0f;
+
+	return std::sqrt((intensity / LIGHT_CUTOFF - 1.0f) / attenuation);
+}
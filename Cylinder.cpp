@@ -23,9 +23,14 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 #include "Cylinder.h"
+#include "ModelBuilder.h"
+#include "MeshOptimizer.h"
+#include "MeshCache.h"
 
 #include <math.h>
 #include "MathUtils.h"
+#include "JobSystem.h"
+#include "TraceRecorder.h"
 
 #ifdef _GISELLE_DEBUG
 #include <iostream>
@@ -38,17 +43,19 @@ using namespace giselle;
 using namespace model;
 using namespace math;
 
-Model model::Cylinder(float radius, float height, int lon)
-{
-	if (radius <= 0 || height <= 0 || lon < 3)
-		return Model();
+// minimum number of vertices per mesh generation task
+static constexpr unsigned int VERTEX_GRAIN = 4096;
 
+static std::shared_ptr<const MeshData> generate_cylinder(float radius, float height, int lon)
+{
+	TraceRecorder::Scope trace("cylinder", "assets");
 	unsigned int nVertices = 4 * lon;
 	unsigned int nTriangles = 4 * (lon-1);
 
-	float* vertex_array = new float[nVertices*3];
-	float* vertex_normal_array = new float[nVertices*3];
-	unsigned int* index_array = new unsigned int[nTriangles*3];
+	ModelBuilder builder(nVertices, nTriangles);
+	float* vertex_array = builder.getVertexArray();
+	float* vertex_normal_array = builder.getVertexNormalArray();
+	unsigned int* index_array = builder.getIndexArray();
 
 	int i = 0;
 
@@ -56,37 +63,42 @@ Model model::Cylinder(float radius, float height, int lon)
 				nVertices << " vertices | " << nTriangles << " triangles" << std::endl );
 
 	const float col_step = 2*PI / lon;
-	Vector4f v = {0,1,0,0};
 
 	// build vertices : bottom base ; ring around base ; ring around top, top base
-	float alpha = 0;
-	for (int col = 0 ; col < lon ; col++)
-	{
-		float cos_alpha = cos(alpha);
-		float sin_alpha = sin(alpha);
-
-		vertex_array[i] = vertex_array[i+3*lon]
-				= vertex_array[i+6*lon] = vertex_array[i+9*lon]
-				= radius * sin_alpha;
-		vertex_normal_array[i] = vertex_normal_array[i+9*lon] = 0.0f;
-		vertex_normal_array[i+3*lon] = vertex_normal_array[i+6*lon] = sin_alpha;
-		i++;
-
-		vertex_array[i] = vertex_array[i+3*lon] = 0;
-		vertex_array[i+6*lon] = vertex_array[i+9*lon] = height;
-		vertex_normal_array[i] = -1.0f;
-		vertex_normal_array[i+3*lon] = vertex_normal_array[i+6*lon] = 0.0f;
-		vertex_normal_array[i+9*lon] = 1.0f;
-		i++;
-
-		vertex_array[i] = vertex_array[i+3*lon]
-				= vertex_array[i+6*lon] = vertex_array[i+9*lon]
-				= radius * cos_alpha;
-		vertex_normal_array[i] = vertex_normal_array[i+9*lon] = 0.0f;
-		vertex_normal_array[i+3*lon] = vertex_normal_array[i+6*lon] = cos_alpha;
-		i++;
-		alpha += col_step;
-	}
+	// columns are independent of each other, large cylinders build them in parallel
+	JobSystem::shared().parallelFor(0, lon, VERTEX_GRAIN / 4,
+		[=](unsigned int col_begin, unsigned int col_end)
+		{
+			float alpha = col_begin * col_step;
+			int k = 3 * col_begin;
+			for (int col = col_begin ; col < (int)col_end ; col++)
+			{
+				float cos_alpha = cos(alpha);
+				float sin_alpha = sin(alpha);
+
+				vertex_array[k] = vertex_array[k+3*lon]
+						= vertex_array[k+6*lon] = vertex_array[k+9*lon]
+						= radius * sin_alpha;
+				vertex_normal_array[k] = vertex_normal_array[k+9*lon] = 0.0f;
+				vertex_normal_array[k+3*lon] = vertex_normal_array[k+6*lon] = sin_alpha;
+				k++;
+
+				vertex_array[k] = vertex_array[k+3*lon] = 0;
+				vertex_array[k+6*lon] = vertex_array[k+9*lon] = height;
+				vertex_normal_array[k] = -1.0f;
+				vertex_normal_array[k+3*lon] = vertex_normal_array[k+6*lon] = 0.0f;
+				vertex_normal_array[k+9*lon] = 1.0f;
+				k++;
+
+				vertex_array[k] = vertex_array[k+3*lon]
+						= vertex_array[k+6*lon] = vertex_array[k+9*lon]
+						= radius * cos_alpha;
+				vertex_normal_array[k] = vertex_normal_array[k+9*lon] = 0.0f;
+				vertex_normal_array[k+3*lon] = vertex_normal_array[k+6*lon] = cos_alpha;
+				k++;
+				alpha += col_step;
+			}
+		});
 
 	// build triangles
 	i = 0;
@@ -132,11 +144,18 @@ Model model::Cylinder(float radius, float height, int lon)
 
 	Cylinder_D( "CYLINDER: " << i/3 << " triangles built" << std::endl);
 
-	// construct model
-	Model m(nVertices, nTriangles, vertex_array, vertex_normal_array, index_array);
+	// hand the arrays over to the mesh data
+	return builder.buildMesh();
+}
+
+Model model::Cylinder(float radius, float height, int lon)
+{
+	if (radius <= 0 || height <= 0 || lon < 3)
+		return Model();
 
-	delete[] vertex_array;
-	delete[] vertex_normal_array;
-	delete[] index_array;
-	return m;
+	// optimized meshes have another order, keep them apart
+	MeshCache::Key key(MeshCache::CYLINDER, {radius, height, (float)lon,
+			MeshOptimizer::isAutomatic() ? 1.0f : 0.0f});
+	return Model(MeshCache::shared().get(key,
+			[=]() { return generate_cylinder(radius, height, lon); }));
 }
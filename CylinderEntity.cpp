@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "CylinderEntity.h"
+#include "Cylinder.h"
+
+using namespace giselle;
+using namespace scene;
+using namespace model;
+using namespace math;
+
+CylinderEntity::CylinderEntity( float radius, float height, const Material& material,
+	const Vector4f& pos, const Vector4f& ang, const std::list<Entity*> & children )
+:	PrimitiveEntity(material,pos,ang,children)
+,	radius(radius > 0.0f ? radius : 1.0f)
+,	height(height > 0.0f ? height : 1.0f)
+{
+}
+
+CylinderEntity::~CylinderEntity()
+{
+}
+
+void CylinderEntity::setDimensions(float radius, float height)
+{
+	if (radius <= 0.0f || height <= 0.0f) return;
+	if (radius == this->radius && height == this->height) return;
+	this->radius = radius;
+	this->height = height;
+	this->invalidate();
+}
+
+float CylinderEntity::getRadius(void) const
+{
+	return this->radius;
+}
+
+float CylinderEntity::getHeight(void) const
+{
+	return this->height;
+}
+
+bool CylinderEntity::getBounds(Vector4f& min, Vector4f& max) const
+{
+	min = Vector4f(-this->radius, 0.0f, -this->radius);
+	max = Vector4f(this->radius, this->height, this->radius);
+	return true;
+}
+
+Model CylinderEntity::generate(unsigned int segments) const
+{
+	return Cylinder(this->radius, this->height, segments);
+}
+
+float CylinderEntity::curve_radius(void) const
+{
+	return this->radius;
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "DebugOutput.h"
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include <mutex>
+
+using namespace giselle;
+
+std::atomic<bool> DebugOutput::enabled(false);
+
+static std::mutex sink_mutex;
+static DebugOutput::Sink current_sink;
+static DebugOutput::Severity min_severity = DebugOutput::LOW;
+static bool type_enabled[DebugOutput::TYPE_COUNT] = { true, true, true, true, true, true, true };
+static std::atomic<std::uint64_t> counts[DebugOutput::TYPE_COUNT];
+
+static const GLenum GL_TYPES[DebugOutput::TYPE_COUNT] =
+{
+	GL_DEBUG_TYPE_ERROR, GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR, GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR,
+	GL_DEBUG_TYPE_PORTABILITY, GL_DEBUG_TYPE_PERFORMANCE, GL_DEBUG_TYPE_MARKER,
+	GL_DEBUG_TYPE_OTHER
+};
+
+static const GLenum GL_SEVERITIES[4] =
+{
+	GL_DEBUG_SEVERITY_NOTIFICATION, GL_DEBUG_SEVERITY_LOW,
+	GL_DEBUG_SEVERITY_MEDIUM, GL_DEBUG_SEVERITY_HIGH
+};
+
+static DebugOutput::Source to_source(GLenum source)
+{
+	switch (source)
+	{
+		case GL_DEBUG_SOURCE_API: return DebugOutput::API;
+		case GL_DEBUG_SOURCE_WINDOW_SYSTEM: return DebugOutput::WINDOW_SYSTEM;
+		case GL_DEBUG_SOURCE_SHADER_COMPILER: return DebugOutput::SHADER_COMPILER;
+		case GL_DEBUG_SOURCE_THIRD_PARTY: return DebugOutput::THIRD_PARTY;
+		case GL_DEBUG_SOURCE_APPLICATION: return DebugOutput::APPLICATION;
+		default: return DebugOutput::OTHER_SOURCE;
+	}
+}
+
+static DebugOutput::Type to_type(GLenum type)
+{
+	for (unsigned int t = 0 ; t < DebugOutput::TYPE_COUNT ; t++)
+		if (GL_TYPES[t] == type) return (DebugOutput::Type)t;
+	return DebugOutput::OTHER;
+}
+
+static DebugOutput::Severity to_severity(GLenum severity)
+{
+	for (int s = 0 ; s < 4 ; s++)
+		if (GL_SEVERITIES[s] == severity) return (DebugOutput::Severity)s;
+	return DebugOutput::HIGH;
+}
+
+static void GLAPIENTRY callback(GLenum source, GLenum type, GLuint id, GLenum severity,
+						GLsizei, const GLchar* text, const void*)
+{
+	DebugOutput::Message message;
+	message.source = to_source(source);
+	message.type = to_type(type);
+	message.severity = to_severity(severity);
+	message.id = id;
+	message.text = text;
+	counts[message.type].fetch_add(1, std::memory_order_relaxed);
+
+	// asynchronous messages may come from several driver threads
+	std::lock_guard<std::mutex> lock(sink_mutex);
+	if (current_sink) current_sink(message);
+}
+
+bool DebugOutput::enable(const Sink& sink, bool synchronous)
+{
+	if (!GLEW_KHR_debug) return false;
+
+	{
+		std::lock_guard<std::mutex> lock(sink_mutex);
+		current_sink = sink;
+	}
+	glDebugMessageCallback(callback, nullptr);
+	glEnable(GL_DEBUG_OUTPUT);
+	if (synchronous)
+		glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+	else
+		glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+	apply_filters();
+
+	DebugOutput::enabled.store(true, std::memory_order_relaxed);
+	return true;
+}
+
+void DebugOutput::disable(void)
+{
+	if (!DebugOutput::enabled.load(std::memory_order_relaxed)) return;
+
+	glDisable(GL_DEBUG_OUTPUT);
+	glDebugMessageCallback(nullptr, nullptr);
+	{
+		std::lock_guard<std::mutex> lock(sink_mutex);
+		current_sink = Sink();
+	}
+	DebugOutput::enabled.store(false, std::memory_order_relaxed);
+}
+
+void DebugOutput::setMinSeverity(Severity severity)
+{
+	min_severity = severity;
+	if (isEnabled()) apply_filters();
+}
+
+void DebugOutput::setTypeEnabled(Type type, bool forward)
+{
+	type_enabled[type] = forward;
+	if (isEnabled()) apply_filters();
+}
+
+std::uint64_t DebugOutput::getMessageCount(Type type)
+{
+	return counts[type].load(std::memory_order_relaxed);
+}
+
+void DebugOutput::resetCounts(void)
+{
+	for (auto& c : counts)
+		c.store(0, std::memory_order_relaxed);
+}
+
+void DebugOutput::apply_filters(void)
+{
+	// each call overrides the previous ones for the messages it matches,
+	// so start from everything and take away
+	glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_TRUE);
+	for (int s = 0 ; s < min_severity ; s++)
+		glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_SEVERITIES[s], 0, nullptr, GL_FALSE);
+	for (unsigned int t = 0 ; t < TYPE_COUNT ; t++)
+		if (!type_enabled[t])
+			glDebugMessageControl(GL_DONT_CARE, GL_TYPES[t], GL_DONT_CARE, 0, nullptr, GL_FALSE);
+}
@@ -26,7 +26,6 @@
 
 #include "MathUtils.h"
 #include "Mat4x4f.h"
-#include <stack>
 
 #ifdef _GISELLE_DEBUG
 #include <iostream>
@@ -45,6 +44,8 @@ Entity::Entity(const Vector4f& pos, const Vector4f& ang,
 ,	ang(ang.x(), ang.y(), ang.z(), 0.0f)
 ,	parent(nullptr)
 ,	children()
+,	version(0)
+,	shadow_casting(STATIC_SHADOWS)
 {
 	for (Entity* e : children)
 	{
@@ -63,6 +64,7 @@ Entity::~Entity()
 void Entity::setPosition(float x, float y, float z)
 {
 	this->pos = Vector4f(x, y, z, 1.0f);
+	this->markDirty();
 }
 
 void Entity::setOrientation(float pitch, float yaw, float roll)
@@ -75,11 +77,13 @@ void Entity::setOrientation(float pitch, float yaw, float roll)
 	while (roll < 0) roll += 2*math::PI;
 
 	this->ang = Vector4f(pitch, yaw, roll, 0.f);
+	this->markDirty();
 }
 
 void Entity::move(const Vector4f& mov)
 {
 	this->pos += {mov.x(), mov.y(), mov.z(), 0.f};
+	this->markDirty();
 }
 
 void Entity::rotate(const Vector4f& rot)
@@ -106,6 +110,8 @@ void Entity::rotate(float d_pitch, float d_yaw, float d_roll)
 		ang.z() += 2*math::PI;
 	while(ang.z() > 2*math::PI)
 		ang.z() -= 2*math::PI;
+
+	this->markDirty();
 }
 
 const Vector4f& Entity::position(void) const
@@ -119,27 +125,24 @@ void Entity::absoluteVectors(Vector4f& pos, Vector4f& ang) const
 	Vector4f r_ang = {0,0,0,0};
 	Mat4x4f r_mat = Mat4x4f::IDENTITY;
 
-	const Entity* p_ent;
-
-	std::stack<const Entity*> ent_path;
-
-	for (p_ent = this ; p_ent != nullptr ; p_ent = p_ent->getParent())
-		ent_path.push(p_ent);
-
-	while (!ent_path.empty())
-	{
-		p_ent = ent_path.top();
-		r_ang += p_ent->orientation();
-		math::translate(r_mat, p_ent->position());
-		math::rotate(r_mat, p_ent->orientation());
-		ent_path.pop();
-	}
+	this->absolute_rec(r_mat, r_ang);
 
 	r_mat.takeVector(pos);
 	pos.normalize();
 	ang = r_ang;
 }
 
+void Entity::absolute_rec(Mat4x4f& mat, Vector4f& ang) const
+{
+	// from the root down, without an explicit path
+	if (this->getParent() != nullptr)
+		this->getParent()->absolute_rec(mat, ang);
+
+	ang += this->orientation();
+	math::translate(mat, this->position());
+	math::rotate(mat, this->orientation());
+}
+
 bool Entity::attach(Entity& ent)
 {
 	if (ent.getParent()) return false; // check for already defined
@@ -165,14 +168,56 @@ void Entity::render(Renderer& renderer) const
 	//Nothing!
 }
 
+bool Entity::getBounds(Vector4f& min, Vector4f& max) const
+{
+	return false;
+}
+
+const model::Model* Entity::getOccluder(void) const
+{
+	return nullptr;
+}
+
+void Entity::selectDetail(float pixels) const
+{
+}
+
+unsigned int Entity::getCurrentLevel(void) const
+{
+	return 0;
+}
+
+void Entity::markDirty(void)
+{
+	this->version++;
+}
+
+unsigned int Entity::getVersion(void) const
+{
+	return this->version;
+}
+
+void Entity::setShadowCasting(ShadowCasting mode)
+{
+	this->shadow_casting = mode;
+	this->markDirty();
+}
+
+Entity::ShadowCasting Entity::getShadowCasting(void) const
+{
+	return this->shadow_casting;
+}
+
 void Entity::setParent(Entity& parent_ent)
 {
 	this->parent = &parent_ent;
+	this->markDirty();
 }
 
 void Entity::setParent(std::nullptr_t)
 {
 	this->parent = nullptr;
+	this->markDirty();
 }
 
 const Entity* Entity::getParent(void) const
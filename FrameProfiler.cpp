@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "FrameProfiler.h"
+#include "TraceRecorder.h"
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+using namespace giselle;
+
+static const char* const ZONE_NAMES[FrameProfiler::ZONE_COUNT] =
+{
+	"traversal", "culling", "lighting", "shadows", "submit"
+};
+
+static double elapsed_ms(const std::chrono::steady_clock::time_point& start)
+{
+	return std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - start).count();
+}
+
+static void clear_times(FrameProfiler::FrameTimes& t, std::uint64_t frame)
+{
+	t.frame = frame;
+	for (unsigned int z = 0 ; z < FrameProfiler::ZONE_COUNT ; z++)
+		t.cpu_ms[z] = t.gpu_ms[z] = 0.0;
+	t.cpu_total_ms = t.gpu_total_ms = 0.0;
+	t.gpu_valid = false;
+}
+
+FrameProfiler::FrameProfiler(void)
+:	enabled(false)
+,	timer_queries(false)
+,	frame(0)
+,	active(-1)
+,	traced(-1)
+,	traced_frame(false)
+{
+	for (Slot& s : this->slots)
+	{
+		for (unsigned int z = 0 ; z < ZONE_COUNT ; z++)
+		{
+			s.queries[z] = 0;
+			s.used[z] = false;
+		}
+		s.pending = false;
+		clear_times(s.times, 0);
+	}
+	clear_times(this->last, UINT64_MAX);
+}
+
+FrameProfiler::~FrameProfiler(void)
+{
+	this->release();
+}
+
+FrameProfiler::FrameProfiler(FrameProfiler&& other)
+:	enabled(other.enabled)
+,	timer_queries(other.timer_queries)
+,	frame(other.frame)
+,	active(other.active)
+,	traced(other.traced)
+,	traced_frame(other.traced_frame)
+,	frame_start(other.frame_start)
+,	zone_start(other.zone_start)
+,	last(other.last)
+{
+	for (unsigned int i = 0 ; i < LATENCY ; i++)
+	{
+		this->slots[i] = other.slots[i];
+		for (unsigned int z = 0 ; z < ZONE_COUNT ; z++)
+			other.slots[i].queries[z] = 0;
+	}
+	other.enabled = false;
+	other.timer_queries = false;
+}
+
+FrameProfiler& FrameProfiler::operator=(FrameProfiler&& other)
+{
+	if (this == &other) return *this;
+	this->release();
+	this->enabled = other.enabled;
+	this->timer_queries = other.timer_queries;
+	this->frame = other.frame;
+	this->active = other.active;
+	this->traced = other.traced;
+	this->traced_frame = other.traced_frame;
+	this->frame_start = other.frame_start;
+	this->zone_start = other.zone_start;
+	this->last = other.last;
+	for (unsigned int i = 0 ; i < LATENCY ; i++)
+	{
+		this->slots[i] = other.slots[i];
+		for (unsigned int z = 0 ; z < ZONE_COUNT ; z++)
+			other.slots[i].queries[z] = 0;
+	}
+	other.enabled = false;
+	other.timer_queries = false;
+	return *this;
+}
+
+void FrameProfiler::setEnabled(bool enabled)
+{
+	this->release();
+	this->enabled = enabled;
+	this->frame = 0;
+	this->active = -1;
+	clear_times(this->last, UINT64_MAX);
+	if (!enabled) return;
+
+	this->timer_queries = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+	for (Slot& s : this->slots)
+	{
+		if (this->timer_queries)
+			glGenQueries(ZONE_COUNT, s.queries);
+		s.pending = false;
+	}
+}
+
+bool FrameProfiler::isEnabled(void) const
+{
+	return this->enabled;
+}
+
+void FrameProfiler::beginFrame(void)
+{
+	this->traced_frame = TraceRecorder::isEnabled();
+	if (this->traced_frame)
+		TraceRecorder::begin("frame", "render");
+
+	if (!this->enabled) return;
+
+	// collect the frames in flight, oldest first; results come in order
+	for (unsigned int k = LATENCY ; k > 0 ; k--)
+	{
+		if (this->frame < k) continue;
+		Slot& s = this->slots[(this->frame - k) % LATENCY];
+		if (!s.pending || this->collect(s)) continue;
+		if (k < LATENCY) break;
+
+		// the slot is needed now: publish the frame without its GPU times
+		s.pending = false;
+		this->last = s.times;
+	}
+
+	Slot& s = this->current();
+	for (unsigned int z = 0 ; z < ZONE_COUNT ; z++)
+		s.used[z] = false;
+	clear_times(s.times, this->frame);
+	this->active = -1;
+	this->frame_start = Clock::now();
+}
+
+void FrameProfiler::endFrame(void)
+{
+	if (this->traced >= 0)
+		this->end((Zone)this->traced);
+	if (this->traced_frame)
+		TraceRecorder::end("frame", "render");
+	this->traced_frame = false;
+
+	if (!this->enabled) return;
+	if (this->active >= 0)
+		this->end((Zone)this->active);
+
+	Slot& s = this->current();
+	s.times.cpu_total_ms = elapsed_ms(this->frame_start);
+	if (this->timer_queries)
+		s.pending = true;
+	else
+		this->last = s.times;
+	this->frame++;
+}
+
+void FrameProfiler::begin(Zone zone)
+{
+	if (this->traced < 0 && TraceRecorder::isEnabled())
+	{
+		TraceRecorder::begin(ZONE_NAMES[zone], "render");
+		this->traced = zone;
+	}
+
+	if (!this->enabled || this->active >= 0) return;
+	Slot& s = this->current();
+	if (s.used[zone]) return;
+
+	s.used[zone] = true;
+	this->active = zone;
+	if (this->timer_queries)
+		glBeginQuery(GL_TIME_ELAPSED, s.queries[zone]);
+	this->zone_start = Clock::now();
+}
+
+void FrameProfiler::end(Zone zone)
+{
+	if (this->traced == (int)zone)
+	{
+		TraceRecorder::end(ZONE_NAMES[zone], "render");
+		this->traced = -1;
+	}
+
+	if (!this->enabled || this->active != (int)zone) return;
+	Slot& s = this->current();
+
+	s.times.cpu_ms[zone] = elapsed_ms(this->zone_start);
+	if (this->timer_queries)
+		glEndQuery(GL_TIME_ELAPSED);
+	this->active = -1;
+}
+
+const FrameProfiler::FrameTimes& FrameProfiler::getFrameTimes(void) const
+{
+	return this->last;
+}
+
+FrameProfiler::Slot& FrameProfiler::current(void)
+{
+	return this->slots[this->frame % LATENCY];
+}
+
+bool FrameProfiler::collect(Slot& slot)
+{
+	for (unsigned int z = 0 ; z < ZONE_COUNT ; z++)
+	{
+		if (!slot.used[z]) continue;
+		GLuint available = 0;
+		glGetQueryObjectuiv(slot.queries[z], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) return false;
+	}
+
+	for (unsigned int z = 0 ; z < ZONE_COUNT ; z++)
+	{
+		if (!slot.used[z]) continue;
+		GLuint64 ns = 0;
+		glGetQueryObjectui64v(slot.queries[z], GL_QUERY_RESULT, &ns);
+		slot.times.gpu_ms[z] = ns * 1e-6;
+		slot.times.gpu_total_ms += slot.times.gpu_ms[z];
+	}
+	slot.times.gpu_valid = true;
+	slot.pending = false;
+	this->last = slot.times;
+	return true;
+}
+
+void FrameProfiler::release(void)
+{
+	for (Slot& s : this->slots)
+	{
+		if (s.queries[0] != 0)
+			glDeleteQueries(ZONE_COUNT, s.queries);
+		for (unsigned int z = 0 ; z < ZONE_COUNT ; z++)
+			s.queries[z] = 0;
+		s.pending = false;
+	}
+	this->timer_queries = false;
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "FrameStats.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace giselle;
+
+static std::uint64_t FrameStats::* const COUNTERS[FrameStats::COUNTER_COUNT] =
+{
+	&FrameStats::draw_calls,
+	&FrameStats::triangles,
+	&FrameStats::entities_visited,
+	&FrameStats::entities_culled,
+	&FrameStats::uniform_uploads,
+	&FrameStats::program_binds,
+	&FrameStats::buffer_binds,
+	&FrameStats::bytes_uploaded,
+	&FrameStats::allocations,
+	&FrameStats::allocated_bytes
+};
+
+FrameStats::FrameStats(void)
+{
+	this->reset();
+}
+
+void FrameStats::reset(void)
+{
+	for (auto counter : COUNTERS)
+		this->*counter = 0;
+}
+
+std::uint64_t FrameStats::get(Counter counter) const
+{
+	return this->*COUNTERS[counter];
+}
+
+FrameStatsHistory::FrameStatsHistory(void)
+:	next(0)
+,	count(0)
+{
+}
+
+void FrameStatsHistory::push(const FrameStats& stats)
+{
+	this->frames[this->next] = stats;
+	this->next = (this->next + 1) % WINDOW;
+	if (this->count < WINDOW) this->count++;
+}
+
+void FrameStatsHistory::clear(void)
+{
+	this->next = 0;
+	this->count = 0;
+}
+
+unsigned int FrameStatsHistory::getCount(void) const
+{
+	return this->count;
+}
+
+double FrameStatsHistory::getAverage(FrameStats::Counter counter) const
+{
+	if (this->count == 0) return 0.0;
+
+	double sum = 0.0;
+	for (unsigned int i = 0 ; i < this->count ; i++)
+		sum += this->frames[i].get(counter);
+	return sum / this->count;
+}
+
+std::uint64_t FrameStatsHistory::getPercentile(FrameStats::Counter counter, float p) const
+{
+	if (this->count == 0) return 0;
+
+	std::uint64_t values[WINDOW];
+	for (unsigned int i = 0 ; i < this->count ; i++)
+		values[i] = this->frames[i].get(counter);
+
+	// nearest rank: the ceil(p/100 * n)-th smallest value
+	p = std::min(std::max(p, 0.0f), 100.0f);
+	unsigned int rank = (unsigned int)std::ceil(p / 100.0f * this->count);
+	if (rank > 0) rank--;
+	std::nth_element(values, values + rank, values + this->count);
+	return values[rank];
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "GBuffer.h"
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+using namespace giselle;
+
+GBuffer::GBuffer(int width, int height)
+:	fbo(0)
+,	textures{0, 0, 0}
+,	width(width)
+,	height(height)
+{
+	static const GLint internal[3] = { GL_RGBA16F, GL_R32UI, GL_DEPTH_COMPONENT24 };
+	static const GLenum format[3] = { GL_RGBA, GL_RED_INTEGER, GL_DEPTH_COMPONENT };
+	static const GLenum type[3] = { GL_FLOAT, GL_UNSIGNED_INT, GL_UNSIGNED_INT };
+	static const GLenum attachment[3] =
+			{ GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_DEPTH_ATTACHMENT };
+
+	glGenFramebuffers(1, &this->fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, this->fbo);
+
+	glGenTextures(3, this->textures);
+	for (int i = 0 ; i < 3 ; i++)
+	{
+		glBindTexture(GL_TEXTURE_2D, this->textures[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, internal[i], width, height, 0,
+					format[i], type[i], nullptr);
+		// always read with texelFetch
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, attachment[i], GL_TEXTURE_2D,
+							this->textures[i], 0);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	static const GLenum draw_buffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, draw_buffers);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		glDeleteTextures(3, this->textures);
+		glDeleteFramebuffers(1, &this->fbo);
+		this->fbo = 0;
+		this->textures[0] = this->textures[1] = this->textures[2] = 0;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+GBuffer::~GBuffer()
+{
+	if (this->fbo != 0)
+	{
+		glDeleteTextures(3, this->textures);
+		glDeleteFramebuffers(1, &this->fbo);
+	}
+}
+
+bool GBuffer::operator!(void) const
+{
+	return this->fbo == 0;
+}
+
+int GBuffer::getWidth(void) const
+{
+	return this->width;
+}
+
+int GBuffer::getHeight(void) const
+{
+	return this->height;
+}
+
+void GBuffer::bind(void)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, this->fbo);
+	glViewport(0, 0, this->width, this->height);
+
+	// the material needs no clearing, empty pixels are told by their depth
+	static const GLfloat no_normal[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	static const GLfloat far_depth = 1.0f;
+	glClearBufferfv(GL_COLOR, 0, no_normal);
+	glClearBufferfv(GL_DEPTH, 0, &far_depth);
+}
+
+void GBuffer::unbind(void)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+unsigned int GBuffer::getNormalTexture(void) const
+{
+	return this->textures[0];
+}
+
+unsigned int GBuffer::getMaterialTexture(void) const
+{
+	return this->textures[1];
+}
+
+unsigned int GBuffer::getDepthTexture(void) const
+{
+	return this->textures[2];
+}
@@ -26,22 +26,35 @@
 
 #include "MathUtils.h"
 #include <stack>
+#include <cmath>
+#include <cfloat>
 
 using namespace giselle;
 using namespace scene;
 using namespace model;
 using namespace math;
 
-const char* const GContext::ERROR_MSGS[4] =
+const char* const GContext::ERROR_MSGS[5] =
 {
 	"OK",
 	"Invalid Arguments",
 	"GLEW Initialization Error",
-	"Shader Loading Error"
+	"Shader Loading Error",
+	"G-Buffer Creation Error"
 };
 
 bool GContext::Glew_Init = false;
 
+static void merge_bounds(Vector4f& lo, Vector4f& hi, const Vector4f& min, const Vector4f& max)
+{
+	if (min.x() < lo.x()) lo.x() = min.x();
+	if (min.y() < lo.y()) lo.y() = min.y();
+	if (min.z() < lo.z()) lo.z() = min.z();
+	if (max.x() > hi.x()) hi.x() = max.x();
+	if (max.y() > hi.y()) hi.y() = max.y();
+	if (max.z() > hi.z()) hi.z() = max.z();
+}
+
 GContext::GContext(void)
 :	error(GContext::VAL_ERROR)
 ,	x(0)
@@ -50,10 +63,25 @@ GContext::GContext(void)
 ,	h(0)
 ,	p_scene(nullptr)
 ,	p_camera(nullptr)
+,	detail_scale(0.0f)
+,	detail_perspective(false)
+,	depth_prepass(false)
+,	overdraw_segments(0)
+,	overdraw_active(false)
+,	overdraw_pending(false)
+,	overdraw(0.0f)
+,	p_occlusion(nullptr)
+,	sw_culled(0)
+,	p_clusters(nullptr)
+,	shading(FORWARD)
+,	p_gbuffer(nullptr)
+,	p_shadows(nullptr)
+,	p_exporter(nullptr)
 {
 }
 
-GContext::GContext(int x, int y, int width, int height, scene::Scene& scene)
+GContext::GContext(int x, int y, int width, int height, scene::Scene& scene,
+				Shading shading)
 :	error(GContext::OK)
 ,	x(x)
 ,	y(y)
@@ -62,6 +90,20 @@ GContext::GContext(int x, int y, int width, int height, scene::Scene& scene)
 ,	p_scene(&scene)
 ,	p_camera(nullptr)
 ,	renderer()
+,	detail_scale(0.0f)
+,	detail_perspective(false)
+,	depth_prepass(false)
+,	overdraw_segments(0)
+,	overdraw_active(false)
+,	overdraw_pending(false)
+,	overdraw(0.0f)
+,	p_occlusion(nullptr)
+,	sw_culled(0)
+,	p_clusters(nullptr)
+,	shading(shading)
+,	p_gbuffer(nullptr)
+,	p_shadows(nullptr)
+,	p_exporter(nullptr)
 {
 	if (x < 0 || y < 0 || width <= 0 || height <= 0)
 		error = GContext::VAL_ERROR;
@@ -69,7 +111,7 @@ GContext::GContext(int x, int y, int width, int height, scene::Scene& scene)
 		init();
 }
 
-GContext::GContext(int width, int height, Scene& scene)
+GContext::GContext(int width, int height, Scene& scene, Shading shading)
 :	error(GContext::OK)
 ,	x(0)
 ,	y(0)
@@ -77,6 +119,20 @@ GContext::GContext(int width, int height, Scene& scene)
 ,	h(height)
 ,	p_scene(&scene)
 ,	p_camera(nullptr)
+,	detail_scale(0.0f)
+,	detail_perspective(false)
+,	depth_prepass(false)
+,	overdraw_segments(0)
+,	overdraw_active(false)
+,	overdraw_pending(false)
+,	overdraw(0.0f)
+,	p_occlusion(nullptr)
+,	sw_culled(0)
+,	p_clusters(nullptr)
+,	shading(shading)
+,	p_gbuffer(nullptr)
+,	p_shadows(nullptr)
+,	p_exporter(nullptr)
 {
 	if (width <= 0 || height <= 0)
 		error = GContext::VAL_ERROR;
@@ -92,8 +148,35 @@ GContext::GContext(GContext&& other)
 ,	h(other.h)
 ,	p_scene(other.p_scene)
 ,	p_camera(other.p_camera)
+,	detail_eye(other.detail_eye)
+,	detail_scale(other.detail_scale)
+,	detail_perspective(other.detail_perspective)
+,	depth_prepass(other.depth_prepass)
+,	overdraw_queries(std::move(other.overdraw_queries))
+,	overdraw_segments(other.overdraw_segments)
+,	overdraw_active(other.overdraw_active)
+,	overdraw_pending(other.overdraw_pending)
+,	overdraw(other.overdraw)
+,	p_occlusion(other.p_occlusion)
+,	sw_culled(other.sw_culled)
+,	p_clusters(other.p_clusters)
+,	shading(other.shading)
+,	p_gbuffer(other.p_gbuffer)
+,	p_shadows(other.p_shadows)
+,	p_exporter(other.p_exporter)
 {
 	this->renderer = std::move(other.renderer);
+	this->culler = std::move(other.culler);
+	this->profiler = std::move(other.profiler);
+	this->perf_counters = std::move(other.perf_counters);
+	this->frame_stats = other.frame_stats;
+	this->stats_history = other.stats_history;
+	other.overdraw_queries.clear();
+	other.p_occlusion = nullptr;
+	other.p_clusters = nullptr;
+	other.p_gbuffer = nullptr;
+	other.p_shadows = nullptr;
+	other.p_exporter = nullptr;
 	other.x = other.y = 0;
 	other.w = other.h = 0;
 	other.p_scene = nullptr;
@@ -103,6 +186,19 @@ GContext::GContext(GContext&& other)
 
 GContext::~GContext(void)
 {
+	if (this->p_occlusion != nullptr)
+		delete this->p_occlusion;
+	if (this->p_clusters != nullptr)
+		delete this->p_clusters;
+	if (this->p_gbuffer != nullptr)
+		delete this->p_gbuffer;
+	if (this->p_shadows != nullptr)
+		delete this->p_shadows;
+	if (this->p_exporter != nullptr)
+		delete this->p_exporter;
+	if (!this->overdraw_queries.empty())
+		glDeleteQueries(this->overdraw_queries.size(), this->overdraw_queries.data());
+	model::MeshData::deleteReleasedBuffers();
 }
 
 void GContext::init(void)
@@ -134,6 +230,20 @@ void GContext::init(void)
 
 	if (!renderer.initShaders())
 		error = GContext::SHADER_ERROR;
+	else if (this->shading == GContext::DEFERRED)
+	{
+		if (!renderer.initDeferred())
+			error = GContext::SHADER_ERROR;
+		else
+		{
+			this->p_gbuffer = new GBuffer(w, h);
+			if (!*this->p_gbuffer)
+				error = GContext::GBUFFER_ERROR;
+		}
+	}
+
+	this->overdraw_queries.resize(1);
+	glGenQueries(1, this->overdraw_queries.data());
 }
 
 bool GContext::operator!(void) const
@@ -166,17 +276,16 @@ void GContext::use(void) const
 void GContext::render(bool clear)
 {
 	if (this->error != GContext::OK) return;
+	this->profiler.beginFrame();
+	this->renderer.stats.reset();
+	const AllocationTracker::Counters allocs = AllocationTracker::getCounters();
+	model::MeshData::deleteReleasedBuffers();
 
 	if (clear)
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	else
 		glClear(GL_DEPTH_BUFFER_BIT);
 
-	this->renderer.use();
-
-	// pass projection matrix to renderer
-	renderer.passProjection(this->p_camera->getProjectionMatrix());
-
 	// get camera absolute position + orientation
 	Vector4f cam_pos, cam_ang;
 	this->p_camera->absoluteVectors(cam_pos, cam_ang);
@@ -186,26 +295,333 @@ void GContext::render(bool clear)
 	math::rotate(mat, -cam_ang.x(), -cam_ang.y(), -cam_ang.z());
 	math::translate(mat, -cam_pos.x(), -cam_pos.y(), -cam_pos.z());
 
+	// flatten the scene and calculate all model transformations
+	this->profiler.begin(FrameProfiler::TRAVERSAL);
+	this->items.clear();
+	this->perf_counters.begin(PerfCounters::TRAVERSAL);
+	this->collect_rec(&(this->p_scene->root()), -1);
+	this->perf_counters.end(PerfCounters::TRAVERSAL);
+	this->perf_counters.begin(PerfCounters::TRANSFORMS);
+	this->update_transforms();
+	this->perf_counters.end(PerfCounters::TRANSFORMS);
+	this->profiler.end(FrameProfiler::TRAVERSAL);
+
+	this->profiler.begin(FrameProfiler::CULLING);
+	if (this->p_occlusion != nullptr)
+		this->software_cull(mat);
+
+	// skip the subtrees known to be hidden
+	float near, far;
+	this->p_camera->getRange(near, far);
+	this->culler.select(this->items, cam_pos, 2 * near);
+	this->select_detail(cam_pos);
+	this->profiler.end(FrameProfiler::CULLING);
+
+	this->renderer.stats.entities_visited = this->items.size();
+	for (const RenderItem& item : this->items)
+		if (item.culled) this->renderer.stats.entities_culled++;
+
+	this->profiler.begin(FrameProfiler::LIGHTING);
+	this->pack_lights();
+	if (this->shading == GContext::FORWARD)
+	{
+		if (this->p_clusters != nullptr)
+			this->p_clusters->build(mat, this->p_camera->getProjectionMatrix(),
+					this->p_camera->isPerspective(), near, far,
+					this->light_pos.data(), this->light_color.data(),
+					this->light_weight.size());
+		else
+			this->select_lights();
+	}
+	this->profiler.end(FrameProfiler::LIGHTING);
+
+	if (this->p_shadows != nullptr)
+	{
+		this->profiler.begin(FrameProfiler::SHADOWS);
+		this->p_shadows->update(this->renderer, this->items, this->p_scene->getLights(),
+				this->light_pos.data(), this->light_weight.size());
+		glViewport(x, y, w, h);
+		this->profiler.end(FrameProfiler::SHADOWS);
+	}
+
+	this->profiler.begin(FrameProfiler::SUBMIT);
+	this->perf_counters.begin(PerfCounters::SUBMIT);
+	if (this->shading == GContext::DEFERRED)
+	{
+		this->render_deferred(mat);
+		this->culler.issueQueries(this->renderer, this->items);
+		this->perf_counters.end(PerfCounters::SUBMIT);
+		this->perf_counters.endFrame();
+		this->profiler.end(FrameProfiler::SUBMIT);
+		this->profiler.endFrame();
+		this->end_stats(allocs);
+		glFlush();
+		return;
+	}
+
+	const bool use_depth_prg = this->depth_prepass
+			|| this->culler.getMode() != OcclusionCuller::OFF;
+	if (use_depth_prg)
+	{
+		this->renderer.useDepthOnly();
+		renderer.passProjection(this->p_camera->getProjectionMatrix());
+		renderer.passViewMatrix(mat);
+	}
+
+	if (this->depth_prepass)
+	{
+		// lay down the depth of the visible surfaces only
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		this->draw_items(true);
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+		// shade each visible fragment once
+		glDepthFunc(GL_EQUAL);
+		glDepthMask(GL_FALSE);
+	}
+
+	this->renderer.use();
+	renderer.passShadows(this->p_shadows);
+
+	// pass projection matrix to renderer
+	renderer.passProjection(this->p_camera->getProjectionMatrix());
+
 	renderer.passViewMatrix(mat);
 
-	// pass light position and color to renderer
-	Vector4f light_pos, light_ang;
-	if (this->p_scene->getLight().position().w() == 0.0)
-		light_pos = p_scene->getLight().position();
+	// pass light positions and colors to renderer
+	if (this->p_clusters != nullptr)
+		renderer.passClusters(*this->p_clusters, this->light_pos.data(),
+				this->light_color.data(), this->light_weight.size(), x, y, w, h);
 	else
+		renderer.passLights(this->light_pos.data(), this->light_color.data(),
+							this->light_weight.size());
+
+	this->begin_overdraw_query();
+	this->draw_items(!this->depth_prepass);
+	this->suspend_overdraw_query();
+
+	if (this->depth_prepass)
 	{
-		this->p_scene->getLight().absoluteVectors(light_pos, light_ang);
-		//math::multiply(light_pos, mat); // apply view transformation
+		glDepthMask(GL_TRUE);
+		glDepthFunc(GL_LESS);
 	}
 
-	renderer.passLightProperties(light_pos, this->p_scene->getLight().getColor());
-
-	mat = Mat4x4f::IDENTITY;
-	this->render_entity_rec(&(this->p_scene->root()), mat); // recursive render
+	// test the boxes against the final depth buffer, for the next frames
+	this->culler.issueQueries(this->renderer, this->items);
+	this->perf_counters.end(PerfCounters::SUBMIT);
+	this->perf_counters.endFrame();
+	this->profiler.end(FrameProfiler::SUBMIT);
+	this->profiler.endFrame();
+	this->end_stats(allocs);
 
 	glFlush();
 }
 
+void GContext::render_deferred(const Mat4x4f& view)
+{
+	const Mat4x4f& proj = this->p_camera->getProjectionMatrix();
+
+	this->p_gbuffer->bind();
+
+	// the G-buffer holds values, not colors to blend
+	const GLboolean blend = glIsEnabled(GL_BLEND);
+	glDisable(GL_BLEND);
+
+	if (this->culler.getMode() != OcclusionCuller::OFF)
+	{ // occlusion tests draw boxes with the depth-only program
+		this->renderer.useDepthOnly();
+		renderer.passProjection(proj);
+		renderer.passViewMatrix(view);
+	}
+
+	this->renderer.useGBuffer();
+	renderer.passProjection(proj);
+	renderer.passViewMatrix(view);
+
+	this->begin_overdraw_query();
+	this->draw_items(true);
+	this->suspend_overdraw_query();
+
+	this->p_gbuffer->unbind();
+	glViewport(x, y, w, h);
+	if (blend) glEnable(GL_BLEND);
+
+	this->renderer.shadeDeferred(*this->p_gbuffer, view, proj, this->light_pos.data(),
+			this->light_color.data(), this->light_weight.size(), x, y, this->p_shadows);
+}
+
+GContext::Shading GContext::getShading(void) const
+{
+	return this->shading;
+}
+
+void GContext::setDepthPrePass(bool enabled)
+{
+	this->depth_prepass = enabled;
+}
+
+bool GContext::getDepthPrePass(void) const
+{
+	return this->depth_prepass;
+}
+
+float GContext::getOverdraw(void) const
+{
+	return this->overdraw;
+}
+
+void GContext::setOcclusionCulling(OcclusionCuller::Mode mode)
+{
+	this->culler.setMode(mode);
+}
+
+OcclusionCuller::Mode GContext::getOcclusionCulling(void) const
+{
+	return this->culler.getMode();
+}
+
+void GContext::setSoftwareOcclusion(bool enabled, unsigned int width)
+{
+	if (this->p_occlusion != nullptr)
+	{
+		delete this->p_occlusion;
+		this->p_occlusion = nullptr;
+	}
+	this->sw_culled = 0;
+
+	if (enabled && width > 0 && this->w > 0)
+	{
+		unsigned int height = width * this->h / this->w;
+		this->p_occlusion = new SoftwareOcclusion(width, height > 0 ? height : 1);
+	}
+}
+
+bool GContext::getSoftwareOcclusion(void) const
+{
+	return this->p_occlusion != nullptr;
+}
+
+void GContext::setClusteredLighting(bool enabled, unsigned int tiles_x,
+									unsigned int tiles_y, unsigned int slices)
+{
+	if (this->p_clusters != nullptr)
+	{
+		delete this->p_clusters;
+		this->p_clusters = nullptr;
+	}
+
+	if (enabled && this->renderer.setClustered(true))
+		this->p_clusters = new ClusteredLighting(tiles_x, tiles_y, slices);
+	else
+		this->renderer.setClustered(false);
+}
+
+bool GContext::getClusteredLighting(void) const
+{
+	return this->p_clusters != nullptr;
+}
+
+bool GContext::setShadows(bool enabled, unsigned int size)
+{
+	if (this->p_shadows != nullptr)
+	{
+		delete this->p_shadows;
+		this->p_shadows = nullptr;
+	}
+
+	if (!enabled) return true;
+	this->p_shadows = new ShadowMaps(size);
+	if (!*this->p_shadows)
+	{
+		delete this->p_shadows;
+		this->p_shadows = nullptr;
+		return false;
+	}
+	return true;
+}
+
+bool GContext::getShadows(void) const
+{
+	return this->p_shadows != nullptr;
+}
+
+unsigned int GContext::getShadowMapUpdates(void) const
+{
+	return (this->p_shadows != nullptr) ? this->p_shadows->getUpdates() : 0;
+}
+
+void GContext::setProfiling(bool enabled)
+{
+	if (this->error != GContext::OK) return;
+	this->profiler.setEnabled(enabled);
+}
+
+bool GContext::getProfiling(void) const
+{
+	return this->profiler.isEnabled();
+}
+
+const FrameProfiler::FrameTimes& GContext::getFrameTimes(void) const
+{
+	return this->profiler.getFrameTimes();
+}
+
+bool GContext::setPerfCounters(bool enabled)
+{
+	if (this->error != GContext::OK) return false;
+	return this->perf_counters.setEnabled(enabled);
+}
+
+bool GContext::getPerfCounters(void) const
+{
+	return this->perf_counters.isEnabled();
+}
+
+const PerfCounters::FrameCounters& GContext::getFrameCounters(void) const
+{
+	return this->perf_counters.getFrameCounters();
+}
+
+bool GContext::setStatsExport(const std::string& name, unsigned int capacity)
+{
+	if (this->p_exporter != nullptr)
+	{
+		delete this->p_exporter;
+		this->p_exporter = nullptr;
+	}
+	if (name.empty()) return true;
+	if (this->error != GContext::OK) return false;
+
+	this->p_exporter = new StatsExporter();
+	if (!this->p_exporter->open(name, capacity))
+	{
+		delete this->p_exporter;
+		this->p_exporter = nullptr;
+		return false;
+	}
+	return true;
+}
+
+bool GContext::getStatsExport(void) const
+{
+	return this->p_exporter != nullptr;
+}
+
+const FrameStats& GContext::getFrameStats(void) const
+{
+	return this->frame_stats;
+}
+
+const FrameStatsHistory& GContext::getFrameStatsHistory(void) const
+{
+	return this->stats_history;
+}
+
+unsigned int GContext::getCulledDraws(void) const
+{
+	return this->culler.getCulledDraws() + this->sw_culled;
+}
+
 void GContext::setCamera(scene::Camera& camera, bool fix_aspect_ratio)
 {
 	if (this->error != GContext::OK) return;
@@ -215,20 +631,373 @@ void GContext::setCamera(scene::Camera& camera, bool fix_aspect_ratio)
 		camera.setAspectRatio(w,h);
 }
 
-void GContext::render_entity_rec(const Entity* p_ent, const Mat4x4f& mat)
+void GContext::software_cull(const Mat4x4f& view)
 {
-	if (p_ent == nullptr) return;
-	Mat4x4f n_mat = mat;
+	Mat4x4f view_proj = this->p_camera->getProjectionMatrix();
+	view_proj *= view;
+
+	this->p_occlusion->begin(view_proj);
+	this->occluder_sub.assign(this->items.size(), false);
+	for (unsigned int i = 0 ; i < this->items.size() ; i++)
+	{
+		const model::Model* p_occluder = this->items[i].p_ent->getOccluder();
+		if (p_occluder == nullptr) continue;
+
+		this->p_occlusion->addOccluder(*p_occluder, this->items[i].mat);
+		for (int j = i ; j >= 0 && !this->occluder_sub[j] ; j = this->items[j].parent)
+			this->occluder_sub[j] = true;
+	}
+	this->p_occlusion->rasterize();
+
+	this->sw_culled = 0;
+	unsigned int i = 0;
+	while (i < this->items.size())
+	{
+		RenderItem& item = this->items[i];
+
+		// occluders would hide themselves, only test around them
+		const bool test = this->occluder_sub[i] ?
+				(item.has_bounds && item.p_ent->getOccluder() == nullptr
+					&& !this->p_occlusion->isVisible(item.bmin, item.bmax))
+			:	(item.has_sub_bounds
+					&& !this->p_occlusion->isVisible(item.sub_min, item.sub_max));
+
+		if (!test)
+			i++;
+		else if (this->occluder_sub[i])
+		{
+			item.culled = true;
+			this->sw_culled++;
+			i++;
+		}
+		else
+		{
+			for (unsigned int j = i ; j < item.end ; j++)
+			{
+				this->items[j].culled = true;
+				if (this->items[j].has_bounds) this->sw_culled++;
+			}
+			i = item.end;
+		}
+	}
+}
+
+void GContext::draw_items(bool first_pass)
+{
+	// color writes are off during the depth pre-pass
+	const bool color_writes = !(first_pass && this->depth_prepass);
+
+	unsigned int i = 0;
+	while (i < this->items.size())
+	{
+		const RenderItem& item = this->items[i];
+
+		// occlusion queries cannot overlap: the overdraw measure pauses
+		// while the subtree's box is tested
+		const bool pause = this->overdraw_active && this->culler.testsGroup(item, first_pass);
+		if (pause)
+			this->suspend_overdraw_query();
+		const bool group = this->culler.beginGroup(this->renderer, item, this->items,
+												first_pass, color_writes);
+		if (pause)
+			this->resume_overdraw_query();
+
+		if (group)
+		{
+			this->draw_range(i, item.end);
+			this->culler.endGroup();
+			i = item.end;
+		}
+		else
+		{
+			this->draw_range(i, i + 1);
+			i++;
+		}
+	}
+}
+
+void GContext::draw_range(unsigned int begin, unsigned int end)
+{
+	for (unsigned int i = begin ; i < end ; i++)
+	{
+		const RenderItem& item = this->items[i];
+		if (item.culled) continue;
+		renderer.passModelMatrix(item.mat); // update model transformation attribute
+		renderer.passLightSelection(item.lights, item.n_lights);
+		item.p_ent->render(renderer);
+	}
+}
+
+void GContext::select_detail(const Vector4f& cam_pos)
+{
+	// pixels per unit of length, at unit distance for perspective projections
+	this->detail_scale = 0.5f * this->h
+			* std::fabs(this->p_camera->getProjectionMatrix().get(1, 1));
+	this->detail_perspective = this->p_camera->isPerspective();
+	this->detail_eye = cam_pos;
+
+	// only capture this, so that the task fits in std::function without allocating
+	JobSystem::shared().parallelFor(0, this->items.size(), TRANSFORM_GRAIN,
+		[this](unsigned int begin, unsigned int end)
+		{
+			const Vector4f& eye = this->detail_eye;
+			const float scale = this->detail_scale;
+			const bool perspective = this->detail_perspective;
+			for (unsigned int i = begin ; i < end ; i++)
+			{
+				const RenderItem& item = this->items[i];
+				if (item.culled || !item.has_bounds) continue;
+
+				// the sphere around the entity's box
+				float r2 = 0.0f, d2 = 0.0f;
+				for (int c = 0 ; c < 3 ; c++)
+				{
+					float half = 0.5f * (item.bmax[c] - item.bmin[c]);
+					float d = item.bmin[c] + half - eye[c];
+					r2 += half * half;
+					d2 += d * d;
+				}
+				float diameter = 2.0f * std::sqrt(r2);
+				float pixels;
+				if (!perspective)
+					pixels = diameter * scale;
+				else if (d2 > r2)
+					pixels = diameter * scale / std::sqrt(d2);
+				else // the camera is inside the sphere
+					pixels = FLT_MAX;
+				item.p_ent->selectDetail(pixels);
+			}
+		});
+}
+
+void GContext::pack_lights(void)
+{
+	this->light_pos.clear();
+	this->light_color.clear();
+	this->light_weight.clear();
+
+	unsigned int max_lights = Renderer::MAX_SCENE_LIGHTS;
+	if (this->p_clusters != nullptr || this->shading == GContext::DEFERRED)
+		max_lights = ClusteredLighting::MAX_LIGHTS;
+
+	for (const Light* p_light : this->p_scene->getLights())
+	{
+		if (this->light_weight.size() == max_lights) break;
+
+		Vector4f pos, ang;
+		if (p_light->position().w() == 0.0)
+			pos = p_light->position();
+		else
+			p_light->absoluteVectors(pos, ang);
+
+		const Vector4f& color = p_light->getColor();
+		this->light_pos.insert(this->light_pos.end(), {pos.x(), pos.y(), pos.z(), pos.w()});
+		this->light_color.insert(this->light_color.end(),
+				{color.x(), color.y(), color.z(), p_light->getAttenuation()});
+		// luminance of the light's color
+		this->light_weight.push_back(0.2126f * color.x() + 0.7152f * color.y()
+									+ 0.0722f * color.z());
+	}
+}
+
+void GContext::select_lights(void)
+{
+	const unsigned int n = this->light_weight.size();
 
-	math::translate(n_mat, p_ent->position());
-	math::rotate(n_mat, p_ent->orientation());
+	JobSystem::shared().parallelFor(0, this->items.size(), TRANSFORM_GRAIN,
+		[this, n](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int i = begin ; i < end ; i++)
+			{
+				RenderItem& item = this->items[i];
+				item.n_lights = 0;
+				if (item.culled) continue;
+
+				// the entity's box, or its origin if it has no bounds
+				float lo[3], hi[3];
+				for (int c = 0 ; c < 3 ; c++)
+				{
+					lo[c] = item.has_bounds ? item.bmin[c] : item.mat.get(c, 3);
+					hi[c] = item.has_bounds ? item.bmax[c] : item.mat.get(c, 3);
+				}
+
+				float score[scene::Scene::MAX_LIGHTS];
+				for (unsigned int l = 0 ; l < n ; l++)
+				{
+					const float* pos = &this->light_pos[l * 4];
+					float s = this->light_weight[l];
+					if (pos[3] != 0.0f)
+					{ // attenuate by the distance to the nearest point of the box
+						float d2 = 0.0f;
+						for (int c = 0 ; c < 3 ; c++)
+						{
+							float d = (pos[c] < lo[c]) ? lo[c] - pos[c]
+									: (pos[c] > hi[c]) ? pos[c] - hi[c] : 0.0f;
+							d2 += d * d;
+						}
+						// lights without attenuation still favour the nearest
+						float att = this->light_color[l * 4 + 3];
+						s /= 1.0f + ((att > 0.0f) ? att : 1e-6f) * d2;
+					}
+
+					// insert in the sorted selection, dropping the weakest light
+					int k = item.n_lights;
+					if (k == scene::Scene::MAX_LIGHTS)
+					{
+						if (s <= score[k - 1]) continue;
+						k--;
+					}
+					else
+						item.n_lights++;
+
+					for ( ; k > 0 && score[k - 1] < s ; k--)
+					{
+						score[k] = score[k - 1];
+						item.lights[k] = item.lights[k - 1];
+					}
+					score[k] = s;
+					item.lights[k] = l;
+				}
+			}
+		});
+}
+
+bool GContext::begin_overdraw_query(void)
+{
+	if (this->overdraw_queries.empty()) return false;
+
+	if (this->overdraw_pending)
+	{
+		// never wait for the GPU, try again next frame
+		GLuint samples = 0;
+		for (unsigned int i = 0 ; i < this->overdraw_segments ; i++)
+		{
+			GLuint available = 0;
+			glGetQueryObjectuiv(this->overdraw_queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) return false;
 
-	renderer.passModelMatrix(n_mat); // update model transformation attribute
+			GLuint n = 0;
+			glGetQueryObjectuiv(this->overdraw_queries[i], GL_QUERY_RESULT, &n);
+			samples += n;
+		}
+		this->overdraw = (float)samples / ((float)this->w * this->h);
+		this->overdraw_pending = false;
+	}
 
-	p_ent->render(renderer);
+	this->overdraw_segments = 0;
+	this->overdraw_pending = true;
+	this->resume_overdraw_query();
+	return true;
+}
 
+void GContext::suspend_overdraw_query(void)
+{
+	if (!this->overdraw_active) return;
+	glEndQuery(GL_SAMPLES_PASSED);
+	this->overdraw_active = false;
+}
+
+void GContext::resume_overdraw_query(void)
+{
+	if (this->overdraw_segments == this->overdraw_queries.size())
+	{
+		GLuint q = 0;
+		glGenQueries(1, &q);
+		this->overdraw_queries.push_back(q);
+	}
+	glBeginQuery(GL_SAMPLES_PASSED, this->overdraw_queries[this->overdraw_segments++]);
+	this->overdraw_active = true;
+}
+
+void GContext::end_stats(const AllocationTracker::Counters& allocs)
+{
+	const AllocationTracker::Counters now = AllocationTracker::getCounters();
+	this->renderer.stats.allocations = now.allocations - allocs.allocations;
+	this->renderer.stats.allocated_bytes = now.bytes - allocs.bytes;
+
+	this->frame_stats = this->renderer.stats;
+	this->stats_history.push(this->frame_stats);
+	if (this->p_exporter != nullptr)
+		this->p_exporter->publish(this->frame_stats, this->profiler.getFrameTimes());
+}
+
+void GContext::collect_rec(const Entity* p_ent, int parent)
+{
+	if (p_ent == nullptr) return;
+
+	RenderItem item;
+	item.p_ent = p_ent;
+	item.parent = parent;
+	item.culled = false;
+	this->items.push_back(item);
+
+	const int index = this->items.size() - 1;
 	for (auto child : p_ent->getChildren())
-		render_entity_rec(child, n_mat);
+		collect_rec(child, index);
+
+	this->items[index].end = this->items.size();
+}
+
+void GContext::update_transforms(void)
+{
+	// local transformations are independent of each other
+	JobSystem::shared().parallelFor(0, this->items.size(), TRANSFORM_GRAIN,
+		[this](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int i = begin ; i < end ; i++)
+			{
+				RenderItem& item = this->items[i];
+				item.local = Mat4x4f::IDENTITY;
+				math::translate(item.local, item.p_ent->position());
+				math::rotate(item.local, item.p_ent->orientation());
+			}
+		});
+
+	// parents always come before their children
+	for (RenderItem& item : this->items)
+	{
+		if (item.parent < 0)
+			item.mat = item.local;
+		else
+		{
+			item.mat = this->items[item.parent].mat;
+			item.mat *= item.local;
+		}
+	}
+
+	// world-space bounds of each entity
+	JobSystem::shared().parallelFor(0, this->items.size(), TRANSFORM_GRAIN,
+		[this](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int i = begin ; i < end ; i++)
+			{
+				RenderItem& item = this->items[i];
+				Vector4f min, max;
+				item.has_bounds = item.p_ent->getBounds(min, max);
+				if (item.has_bounds)
+					math::transformBounds(item.mat, min, max, item.bmin, item.bmax);
+				item.has_sub_bounds = item.has_bounds;
+				item.sub_min = item.bmin;
+				item.sub_max = item.bmax;
+			}
+		});
+
+	// merge the bounds of each subtree, children first
+	for (int i = (int)this->items.size() - 1 ; i > 0 ; i--)
+	{
+		const RenderItem& item = this->items[i];
+		if (!item.has_sub_bounds) continue;
+
+		RenderItem& parent = this->items[item.parent];
+		if (!parent.has_sub_bounds)
+		{
+			parent.has_sub_bounds = true;
+			parent.sub_min = item.sub_min;
+			parent.sub_max = item.sub_max;
+		}
+		else
+			merge_bounds(parent.sub_min, parent.sub_max, item.sub_min, item.sub_max);
+	}
 }
 
 // ----- STATIC FUNCTIONS ----
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ /**
+ * \file AllocCheck.cpp
+ *
+ * Checks that rendering allocates nothing once a context is warmed up. A scene with
+ * a moving entity is rendered with several configurations of the context; for each,
+ * the first frames may size the context's buffers, then every following frame must
+ * report no heap allocation in its \c FrameStats. The library is compiled here with
+ * \c GISELLE_TRACK_ALLOCATIONS (see the Makefile).
+ * Usage: AllocCheck [WARMUP_FRAMES] [CHECKED_FRAMES]
+ * The exit status is 0 when no checked frame allocated.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <list>
+#include <Giselle.h>
+#include <GL/freeglut.h>
+
+using namespace std;
+using namespace giselle;
+using namespace scene;
+using namespace model;
+
+struct Config
+{
+	const char* name;
+	GContext::Shading shading;
+	bool depth_prepass;
+	OcclusionCuller::Mode occlusion;
+	bool software_occlusion;
+	bool clustered;
+	bool shadows;
+};
+
+static const Config CONFIGS[] =
+{
+	{"forward", GContext::FORWARD, false, OcclusionCuller::OFF, false, false, false},
+	{"depth pre-pass and deferred occlusion culling", GContext::FORWARD, true,
+		OcclusionCuller::DEFERRED, false, false, false},
+	{"conditional occlusion culling", GContext::FORWARD, false,
+		OcclusionCuller::CONDITIONAL, false, false, false},
+	{"software occlusion culling", GContext::FORWARD, false, OcclusionCuller::OFF,
+		true, false, false},
+	{"clustered lighting", GContext::FORWARD, false, OcclusionCuller::OFF,
+		false, true, false},
+	{"shadows", GContext::FORWARD, false, OcclusionCuller::OFF, false, false, true},
+	{"deferred shading with shadows", GContext::DEFERRED, false,
+		OcclusionCuller::DEFERRED, false, false, true}
+};
+
+static const int WIDTH = 640, HEIGHT = 400;
+
+int main(int argc, char** argv)
+{
+	const int warmup = (argc > 1) ? atoi(argv[1]) : 10;
+	const int frames = (argc > 2) ? atoi(argv[2]) : 100;
+	if (warmup < 0 || frames <= 0)
+	{
+		cerr << "Usage: " << argv[0] << " [WARMUP_FRAMES] [CHECKED_FRAMES]" << endl;
+		return 1;
+	}
+	if (!AllocationTracker::isTracking())
+	{
+		cerr << "The library was built without GISELLE_TRACK_ALLOCATIONS." << endl;
+		return 1;
+	}
+
+	glutInit(&argc, argv);
+	glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE | GLUT_DEPTH);
+	glutInitWindowSize(WIDTH, HEIGHT);
+	glutSetOption(GLUT_ACTION_ON_WINDOW_CLOSE, GLUT_ACTION_GLUTMAINLOOP_RETURNS);
+	if (glutCreateWindow("Giselle Allocation Check") < 1)
+	{
+		cerr << "Could not create a new rendering window." << endl;
+		return 1;
+	}
+
+	// a wall hiding a crowd of spheres, enough of them to split the context's tasks
+	Light light({-5, 8, 5, 1}, {0, 0, 0}, {}, {0.8, 0.8, 0.8});
+	light.setCastShadows(true);
+	Light lamp({3, 1, 4, 1}, {0, 0, 0}, {}, {0.6, 0.5, 0.3});
+	lamp.setAttenuation(0.2f);
+
+	SimpleModelEntity floor(model::Box(-10, 10, -0.5, 0, -10, 10), {0, -2, 0}, {0, 0, 0});
+	SimpleModelEntity wall(model::Box(-6, 6, -2, 3, -0.25, 0.25), {0, 0, 0}, {0, 0, 0});
+	wall.setOccluder(true);
+
+	list<Entity*> spheres;
+	for (int i = 0 ; i < 200 ; i++)
+		spheres.push_back(new SimpleModelEntity(model::Sphere(0.2f, 8, 12),
+				{(float)(i % 20) * 0.5f - 5.0f, (float)(i / 20) * 0.5f - 1.5f, -3.0f},
+				{0, 0, 0}));
+	Entity crowd({0, 0, 0}, {0, 0, 0}, spheres);
+
+	SimpleModelEntity crate(model::Box(-0.5, 0.5, -0.5, 0.5, -0.5, 0.5), {2, 0, 3}, {0, 0, 0});
+	crate.setShadowCasting(Entity::DYNAMIC_SHADOWS);
+
+	Camera camera({0, 2, 10}, {0, 0, 0});
+	camera.perspective(60.0f, 1.0f, 50.0f);
+	camera.setBackColor(0.5f, 0.5f, 0.7f);
+
+	Scene scene({&light, &lamp, &camera, &floor, &wall, &crowd, &crate});
+	scene.setLight(light);
+
+	int failures = 0;
+	for (const Config& config : CONFIGS)
+	{
+		GContext context(0, 0, WIDTH, HEIGHT, scene, config.shading);
+		if (!context)
+		{
+			cerr << config.name << ": " << context.getErrorMsg() << endl;
+			failures++;
+			continue;
+		}
+		context.setCamera(camera, true);
+		context.setDepthPrePass(config.depth_prepass);
+		context.setOcclusionCulling(config.occlusion);
+		context.setSoftwareOcclusion(config.software_occlusion);
+		context.setClusteredLighting(config.clustered);
+		context.setShadows(config.shadows);
+
+		int allocating = 0;
+		uint64_t allocations = 0;
+		for (int f = 0 ; f < warmup + frames ; f++)
+		{
+			crate.rotate(0.0f, 0.05f, 0.0f);
+			context.use();
+			context.render();
+			glutSwapBuffers();
+			glutMainLoopEvent();
+
+			const uint64_t n = context.getFrameStats().allocations;
+			if (f >= warmup && n != 0)
+			{
+				allocating++;
+				allocations += n;
+			}
+		}
+
+		cout << config.name << ": ";
+		if (allocating == 0)
+			cout << "no allocation" << endl;
+		else
+		{
+			cout << allocations << " allocations in " << allocating << " of "
+				<< frames << " frames" << endl;
+			failures++;
+		}
+	}
+
+	for (Entity* p_sphere : spheres)
+		delete p_sphere;
+	MeshCache::shared().clear();
+	MeshData::deleteReleasedBuffers(); // while the window's context is current
+	return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ /**
+ * \file ClusterBench.cpp
+ *
+ * Compares clustered light assignment (see \c ClusteredLighting ) with the naive loop
+ * over every light, on the CPU. Random attenuated lights and random fragments are
+ * spread over the view frustum of a perspective camera; each fragment is shaded by
+ * all the lights, then only by the lights of its cluster, with the arithmetic of the
+ * clustered fragment shader. The clustered time includes the light assignment.
+ * Usage: ClusterBench [LIGHTS] [FRAGMENTS] [ITERATIONS]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <Giselle.h>
+
+using namespace std;
+using namespace giselle;
+using namespace scene;
+using namespace math;
+
+typedef chrono::steady_clock Clock;
+
+static double elapsed_ms(const Clock::time_point& start)
+{
+	return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+// diffuse intensity of light k at point p with normal n, as in the clustered shader
+static float shade(const vector<float>& pos, const vector<float>& color, unsigned int k,
+				const float* p, const float* n)
+{
+	const float lx = pos[k*4] - p[0], ly = pos[k*4+1] - p[1], lz = pos[k*4+2] - p[2];
+	const float d2 = lx*lx + ly*ly + lz*lz;
+	const float att = 1.0f / (1.0f + color[k*4+3] * d2);
+	const float kd = max((lx*n[0] + ly*n[1] + lz*n[2]) / sqrt(d2), 0.0f);
+	return kd * att * color[k*4];
+}
+
+int main(int argc, char** argv)
+{
+	const unsigned int n_lights = (argc > 1) ? atoi(argv[1]) : 1000;
+	const unsigned int n_frags = (argc > 2) ? atoi(argv[2]) : 200000;
+	const unsigned int iterations = (argc > 3) ? atoi(argv[3]) : 5;
+	if (n_lights == 0 || n_lights > ClusteredLighting::MAX_LIGHTS || n_frags == 0
+			|| iterations == 0)
+	{
+		cerr << "Usage: " << argv[0] << " [LIGHTS] [FRAGMENTS] [ITERATIONS]" << endl;
+		return 1;
+	}
+
+	const float near = 0.5f, far = 100.0f;
+	Camera camera; // at the origin, looking down -Z
+	camera.perspective(60.0f, near, far, 16.0f / 9.0f);
+	const Mat4x4f& proj = camera.getProjectionMatrix();
+	const float sx = proj.get(0,0), sy = proj.get(1,1);
+
+	// a point of the frustum: screen coordinates in [0,1[, depth spread evenly in log
+	mt19937 rng(1234);
+	uniform_real_distribution<float> unit(0.0f, 1.0f);
+	auto frustum_point = [&](float* p, float* screen)
+	{
+		const float d = near * pow(far / near, unit(rng));
+		screen[0] = unit(rng);
+		screen[1] = unit(rng);
+		p[0] = (2.0f * screen[0] - 1.0f) * d / sx;
+		p[1] = (2.0f * screen[1] - 1.0f) * d / sy;
+		p[2] = -d;
+	};
+
+	vector<float> light_pos(n_lights * 4), light_color(n_lights * 4);
+	for (unsigned int k = 0 ; k < n_lights ; k++)
+	{
+		float screen[2];
+		frustum_point(&light_pos[k*4], screen);
+		light_pos[k*4+3] = 1.0f;
+		light_color[k*4] = light_color[k*4+1] = light_color[k*4+2] = 0.5f + 0.5f * unit(rng);
+		light_color[k*4+3] = 0.5f + 4.5f * unit(rng); // ranges of about 5 to 23
+	}
+
+	vector<float> frag_pos(n_frags * 3), frag_normal(n_frags * 3);
+	vector<unsigned int> frag_tile(n_frags * 2);
+	vector<float> frag_depth(n_frags);
+	for (unsigned int i = 0 ; i < n_frags ; i++)
+	{
+		float screen[2];
+		frustum_point(&frag_pos[i*3], screen);
+		frag_tile[i*2] = (unsigned int)(screen[0] * ClusteredLighting::DEFAULT_TILES_X);
+		frag_tile[i*2+1] = (unsigned int)(screen[1] * ClusteredLighting::DEFAULT_TILES_Y);
+		frag_depth[i] = -frag_pos[i*3+2];
+
+		float* n = &frag_normal[i*3];
+		n[0] = unit(rng) - 0.5f; n[1] = unit(rng) - 0.5f; n[2] = unit(rng);
+		const float len = sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+		n[0] /= len; n[1] /= len; n[2] /= len;
+	}
+
+	vector<float> naive(n_frags), clustered(n_frags);
+	ClusteredLighting clusters;
+	auto cluster_of = [&](unsigned int i)
+	{
+		int slice = (int)floor(log(frag_depth[i]) * clusters.getDepthScale()
+							+ clusters.getDepthBias());
+		slice = min(max(slice, 0), (int)clusters.getSlices() - 1);
+		return (slice * clusters.getTilesY() + frag_tile[i*2+1]) * clusters.getTilesX()
+			+ frag_tile[i*2];
+	};
+	double naive_ms = 0.0, build_ms = 0.0, clustered_ms = 0.0;
+	unsigned long long shaded = 0;
+
+	for (unsigned int it = 0 ; it < iterations ; it++)
+	{
+		Clock::time_point t = Clock::now();
+		for (unsigned int i = 0 ; i < n_frags ; i++)
+		{
+			float c = 0.0f;
+			for (unsigned int k = 0 ; k < n_lights ; k++)
+				c += shade(light_pos, light_color, k, &frag_pos[i*3], &frag_normal[i*3]);
+			naive[i] = c;
+		}
+		naive_ms += elapsed_ms(t);
+
+		t = Clock::now();
+		clusters.build(Mat4x4f::IDENTITY, proj, true, near, far,
+					light_pos.data(), light_color.data(), n_lights);
+		build_ms += elapsed_ms(t);
+
+		t = Clock::now();
+		const unsigned int* grid = clusters.getGrid();
+		const unsigned int* indices = clusters.getIndices();
+		const unsigned int n_global = clusters.getGlobalCount();
+		shaded = 0;
+		for (unsigned int i = 0 ; i < n_frags ; i++)
+		{
+			float c = 0.0f;
+			for (unsigned int j = 0 ; j < n_global ; j++)
+				c += shade(light_pos, light_color, indices[j], &frag_pos[i*3], &frag_normal[i*3]);
+
+			const unsigned int cluster = cluster_of(i);
+			const unsigned int offset = grid[cluster*2], count = grid[cluster*2+1];
+			for (unsigned int j = 0 ; j < count ; j++)
+				c += shade(light_pos, light_color, indices[offset + j],
+							&frag_pos[i*3], &frag_normal[i*3]);
+			clustered[i] = c;
+			shaded += n_global + count;
+		}
+		clustered_ms += elapsed_ms(t);
+	}
+
+	// lights left out of a cluster must not reach it above the cutoff
+	unsigned long long missed = 0;
+	vector<bool> listed(n_lights);
+	const unsigned int* grid = clusters.getGrid();
+	const unsigned int* indices = clusters.getIndices();
+	for (unsigned int i = 0 ; i < n_frags ; i++)
+	{
+		const unsigned int cluster = cluster_of(i);
+		fill(listed.begin(), listed.end(), false);
+		for (unsigned int j = 0 ; j < clusters.getGlobalCount() ; j++)
+			listed[indices[j]] = true;
+		for (unsigned int j = 0 ; j < grid[cluster*2+1] ; j++)
+			listed[indices[grid[cluster*2] + j]] = true;
+
+		const float* p = &frag_pos[i*3];
+		for (unsigned int k = 0 ; k < n_lights ; k++)
+		{
+			const float lx = light_pos[k*4] - p[0], ly = light_pos[k*4+1] - p[1],
+						lz = light_pos[k*4+2] - p[2];
+			const float att = 1.0f / (1.0f + light_color[k*4+3] * (lx*lx + ly*ly + lz*lz));
+			if (!listed[k] && light_color[k*4] * att > ClusteredLighting::LIGHT_CUTOFF)
+				missed++;
+		}
+	}
+
+	naive_ms /= iterations;
+	build_ms /= iterations;
+	clustered_ms /= iterations;
+	cout << fixed << setprecision(3);
+	cout << n_lights << " lights, " << n_frags << " fragments, "
+		<< clusters.getClusterCount() << " clusters, "
+		<< JobSystem::shared().getWorkerCount() << " workers" << endl;
+	cout << "naive:     " << setw(10) << naive_ms << " ms, "
+		<< n_lights << " lights per fragment" << endl;
+	cout << "clustered: " << setw(10) << build_ms + clustered_ms << " ms ("
+		<< build_ms << " ms assigning), "
+		<< (double)shaded / n_frags << " lights per fragment" << endl;
+	cout << "speedup:   " << setw(10) << naive_ms / (build_ms + clustered_ms) << endl;
+	cout << "lights missed above the cutoff: " << missed << endl;
+	return (missed == 0) ? 0 : 1;
+}
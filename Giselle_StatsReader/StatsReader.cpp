@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+ /**
+ * \file StatsReader.cpp
+ *
+ * Prints the frames published by a \c StatsExporter in another process, as they come.
+ * Usage: StatsReader NAME [POLL_MS]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <StatsExporter.h>
+
+using namespace std;
+using namespace giselle;
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		cerr << "Usage: " << argv[0] << " NAME [POLL_MS]" << endl;
+		return 1;
+	}
+	const int poll_ms = (argc > 2) ? atoi(argv[2]) : 100;
+
+	StatsExporter::Reader reader;
+	if (!reader.open(argv[1]))
+	{
+		cerr << "No stats ring named " << argv[1] << endl;
+		return 1;
+	}
+
+	cout << "   frame   cpu ms   gpu ms    draws  triangles  culled  allocs  lost" << endl;
+	cout << fixed << setprecision(3);
+
+	StatsExporter::Record r;
+	for (;;)
+	{
+		while (reader.read(r))
+		{
+			cout << setw(8) << r.frame << ' ';
+			if (r.timed_frame == UINT64_MAX)
+				cout << "       -        - ";
+			else
+			{
+				cout << setw(8) << r.cpu_total_ms << ' ';
+				if (r.gpu_valid)
+					cout << setw(8) << r.gpu_total_ms << ' ';
+				else
+					cout << "       - ";
+			}
+			cout << setw(8) << r.counters[FrameStats::DRAW_CALLS] << ' '
+				<< setw(10) << r.counters[FrameStats::TRIANGLES] << ' '
+				<< setw(7) << r.counters[FrameStats::ENTITIES_CULLED] << ' '
+				<< setw(7) << r.counters[FrameStats::ALLOCATIONS] << ' '
+				<< setw(5) << reader.getLost() << endl;
+		}
+		this_thread::sleep_for(chrono::milliseconds(poll_ms));
+	}
+	return 0;
+}
@@ -0,0 +1,464 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "JobSystem.h"
+#include "TraceRecorder.h"
+
+#include <chrono>
+
+using namespace giselle;
+
+typedef std::chrono::steady_clock Clock;
+
+struct JobSystem::Job
+{
+	Task task;
+	std::atomic<int> pending; // unfinished dependencies (+1 while submitting)
+	std::atomic<bool> finished;
+	std::mutex mutex;
+	std::vector<std::shared_ptr<Job>> dependents;
+
+	Job(const Task& task)
+	:	task(task)
+	,	pending(1)
+	,	finished(false)
+	{}
+};
+
+// a range of parallelFor(), living on the stack of the calling thread
+struct JobSystem::Range
+{
+	const RangeTask* p_task;
+	unsigned int begin, end;
+	unsigned int chunk;    // indices per chunk
+	unsigned int n_chunks;
+	unsigned int next;     // next chunk to claim, guarded by range_mutex
+	std::atomic<unsigned int> done; // chunks finished
+	Range* p_next;
+};
+
+struct JobSystem::Worker
+{
+	std::mutex mutex;
+	std::deque<std::shared_ptr<Job>> tasks;
+	std::thread thread;
+
+	std::atomic<std::uint64_t> tasks_executed;
+	std::atomic<std::uint64_t> tasks_stolen;
+	std::atomic<std::uint64_t> busy_ns;
+	std::atomic<std::uint64_t> idle_ns;
+
+	Worker()
+	:	tasks_executed(0)
+	,	tasks_stolen(0)
+	,	busy_ns(0)
+	,	idle_ns(0)
+	{}
+};
+
+// worker identification of the current thread
+static thread_local JobSystem* tl_system = nullptr;
+static thread_local int tl_index = -1;
+
+static std::uint64_t elapsed_ns(const Clock::time_point& start)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+unsigned int JobSystem::shared_workers = JobSystem::defaultWorkerCount();
+std::atomic<bool> JobSystem::shared_created(false);
+std::mutex JobSystem::shared_mutex;
+
+// ---- Handle ----
+
+JobSystem::Handle::Handle(void)
+:	p_job(nullptr)
+{
+}
+
+bool JobSystem::Handle::done(void) const
+{
+	return this->p_job == nullptr || this->p_job->finished.load();
+}
+
+float JobSystem::WorkerStats::utilization(void) const
+{
+	std::uint64_t total = busy_ns + idle_ns;
+	if (total == 0) return 0.0f;
+	return (float)((double)busy_ns / total);
+}
+
+// ---- JobSystem ----
+
+JobSystem::JobSystem(unsigned int n_workers)
+:	workers()
+,	n_queued(0)
+,	next_worker(0)
+,	running(true)
+,	p_ranges(nullptr)
+,	n_ranges(0)
+{
+	for (unsigned int i = 0 ; i < n_workers ; i++)
+		this->workers.push_back(std::unique_ptr<Worker>(new Worker));
+
+	for (unsigned int i = 0 ; i < n_workers ; i++)
+		this->workers[i]->thread = std::thread(&JobSystem::workerLoop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->sleep_mutex);
+		this->running = false;
+	}
+	this->sleep_cv.notify_all();
+
+	for (auto& w : this->workers)
+		if (w->thread.joinable())
+			w->thread.join();
+
+	// run what is left here, including dependents made runnable on the way, so
+	// that no thread waiting on a task blocks forever
+	bool stolen;
+	while (std::shared_ptr<Job> job = this->take(-1, stolen))
+		this->execute(job);
+}
+
+unsigned int JobSystem::getWorkerCount(void) const
+{
+	return this->workers.size();
+}
+
+JobSystem::Handle JobSystem::submit(const Task& task, const std::vector<Handle>& deps)
+{
+	Handle h;
+	h.p_job = std::make_shared<Job>(task);
+
+	for (const Handle& d : deps)
+	{
+		if (d.p_job == nullptr) continue;
+		std::lock_guard<std::mutex> lock(d.p_job->mutex);
+		if (!d.p_job->finished)
+		{
+			h.p_job->pending++;
+			d.p_job->dependents.push_back(h.p_job);
+		}
+	}
+
+	// release the submission guard
+	if (--h.p_job->pending == 0)
+		this->enqueue(h.p_job);
+
+	return h;
+}
+
+void JobSystem::wait(const Handle& handle)
+{
+	int self = (tl_system == this) ? tl_index : -1;
+
+	while (!handle.done())
+	{
+		bool stolen;
+		std::shared_ptr<Job> job = this->take(self, stolen);
+		if (job)
+		{
+			this->execute(job);
+			if (self >= 0)
+			{
+				this->workers[self]->tasks_executed++;
+				if (stolen) this->workers[self]->tasks_stolen++;
+			}
+		}
+		else if (!this->help())
+			std::this_thread::yield();
+	}
+}
+
+void JobSystem::parallelFor(unsigned int begin, unsigned int end, unsigned int grain,
+							const RangeTask& task)
+{
+	if (end <= begin) return;
+	if (grain == 0) grain = 1;
+
+	const unsigned int n = end - begin;
+	if (this->workers.empty() || n <= grain)
+	{
+		task(begin, end);
+		return;
+	}
+
+	// no point in more chunks than a few per thread
+	unsigned int n_chunks = (n + grain - 1) / grain;
+	const unsigned int max_chunks = 4 * (this->workers.size() + 1);
+	if (n_chunks > max_chunks) n_chunks = max_chunks;
+	const unsigned int chunk = (n + n_chunks - 1) / n_chunks;
+
+	Range range;
+	range.p_task = &task;
+	range.begin = begin;
+	range.end = end;
+	range.chunk = chunk;
+	range.n_chunks = (n + chunk - 1) / chunk;
+	range.next = 1; // the calling thread does the first chunk
+	range.done = 0;
+	range.p_next = nullptr;
+
+	{
+		std::lock_guard<std::mutex> lock(this->range_mutex);
+		range.p_next = this->p_ranges;
+		this->p_ranges = &range;
+		this->n_ranges++;
+	}
+	{ // avoid lost wake-ups of sleeping workers
+		std::lock_guard<std::mutex> lock(this->sleep_mutex);
+	}
+	this->sleep_cv.notify_all();
+
+	this->run_chunk(range, 0);
+
+	// keep claiming chunks, then wait for the chunks run by other threads; work of
+	// other ranges is left alone, as it might wait on a caller of this one (such as
+	// a mesh cache entry being generated here)
+	Range* p_range = &range;
+	unsigned int k;
+	while (this->claim(p_range, k))
+		this->run_chunk(range, k);
+
+	while (range.done.load(std::memory_order_acquire) < range.n_chunks)
+		std::this_thread::yield();
+}
+
+JobSystem::WorkerStats JobSystem::getWorkerStats(unsigned int worker) const
+{
+	WorkerStats s = {0, 0, 0, 0};
+	if (worker >= this->workers.size()) return s;
+
+	const Worker& w = *this->workers[worker];
+	s.tasks_executed = w.tasks_executed;
+	s.tasks_stolen = w.tasks_stolen;
+	s.busy_ns = w.busy_ns;
+	s.idle_ns = w.idle_ns;
+	return s;
+}
+
+void JobSystem::resetStats(void)
+{
+	for (auto& w : this->workers)
+	{
+		w->tasks_executed = 0;
+		w->tasks_stolen = 0;
+		w->busy_ns = 0;
+		w->idle_ns = 0;
+	}
+}
+
+void JobSystem::enqueue(const std::shared_ptr<Job>& job)
+{
+	if (this->workers.empty())
+	{
+		this->execute(job);
+		return;
+	}
+
+	unsigned int target;
+	if (tl_system == this)
+		target = tl_index; // push to own deque
+	else
+		target = this->next_worker++ % this->workers.size();
+
+	{
+		std::lock_guard<std::mutex> lock(this->workers[target]->mutex);
+		this->workers[target]->tasks.push_back(job);
+	}
+	this->n_queued++;
+
+	{ // avoid lost wake-ups of sleeping workers
+		std::lock_guard<std::mutex> lock(this->sleep_mutex);
+	}
+	this->sleep_cv.notify_one();
+}
+
+void JobSystem::execute(const std::shared_ptr<Job>& job)
+{
+	{
+		TraceRecorder::Scope trace("task", "jobs");
+		job->task();
+	}
+
+	std::vector<std::shared_ptr<Job>> dependents;
+	{
+		std::lock_guard<std::mutex> lock(job->mutex);
+		job->finished = true;
+		dependents.swap(job->dependents);
+	}
+
+	for (auto& d : dependents)
+		if (--d->pending == 0)
+			this->enqueue(d);
+}
+
+bool JobSystem::claim(Range*& p_range, unsigned int& chunk)
+{
+	std::lock_guard<std::mutex> lock(this->range_mutex);
+	Range* p = (p_range != nullptr) ? p_range : this->p_ranges;
+	if (p == nullptr || p->next == p->n_chunks) return false;
+
+	chunk = p->next++;
+	if (p->next == p->n_chunks)
+	{ // no chunks left to claim, unlink the range
+		Range** pp = &this->p_ranges;
+		while (*pp != p) pp = &(*pp)->p_next;
+		*pp = p->p_next;
+		this->n_ranges--;
+	}
+	p_range = p;
+	return true;
+}
+
+void JobSystem::run_chunk(Range& range, unsigned int chunk)
+{
+	const unsigned int b = range.begin + chunk * range.chunk;
+	const unsigned int e = (range.end - b > range.chunk) ? b + range.chunk : range.end;
+	{
+		TraceRecorder::Scope trace("task", "jobs");
+		(*range.p_task)(b, e);
+	}
+	// the range may be gone right after this
+	range.done.fetch_add(1, std::memory_order_release);
+}
+
+bool JobSystem::help(void)
+{
+	Range* p_range = nullptr;
+	unsigned int k;
+	if (!this->claim(p_range, k)) return false;
+	this->run_chunk(*p_range, k);
+	return true;
+}
+
+std::shared_ptr<JobSystem::Job> JobSystem::take(int self, bool& stolen)
+{
+	std::shared_ptr<Job> job;
+	stolen = false;
+	const unsigned int n = this->workers.size();
+	if (n == 0) return job;
+
+	if (self >= 0)
+	{ // own deque, LIFO
+		Worker& w = *this->workers[self];
+		std::lock_guard<std::mutex> lock(w.mutex);
+		if (!w.tasks.empty())
+		{
+			job = w.tasks.back();
+			w.tasks.pop_back();
+			this->n_queued--;
+			return job;
+		}
+	}
+
+	// steal from the other workers, FIFO
+	const unsigned int start = (self >= 0) ? self + 1 : this->next_worker.load();
+	for (unsigned int k = 0 ; k < n ; k++)
+	{
+		unsigned int i = (start + k) % n;
+		if ((int)i == self) continue;
+		Worker& w = *this->workers[i];
+		std::lock_guard<std::mutex> lock(w.mutex);
+		if (!w.tasks.empty())
+		{
+			job = w.tasks.front();
+			w.tasks.pop_front();
+			this->n_queued--;
+			stolen = true;
+			return job;
+		}
+	}
+	return job;
+}
+
+void JobSystem::workerLoop(unsigned int index)
+{
+	tl_system = this;
+	tl_index = index;
+	Worker& self = *this->workers[index];
+
+	while (this->running)
+	{
+		bool stolen;
+		std::shared_ptr<Job> job = this->take(index, stolen);
+		if (job)
+		{
+			Clock::time_point t = Clock::now();
+			this->execute(job);
+			self.busy_ns += elapsed_ns(t);
+			self.tasks_executed++;
+			if (stolen) self.tasks_stolen++;
+		}
+		else if (this->n_ranges > 0)
+		{
+			Clock::time_point t = Clock::now();
+			if (this->help())
+			{
+				self.busy_ns += elapsed_ns(t);
+				self.tasks_executed++;
+			}
+		}
+		else
+		{
+			Clock::time_point t = Clock::now();
+			std::unique_lock<std::mutex> lock(this->sleep_mutex);
+			this->sleep_cv.wait(lock, [this]() {
+				return this->n_queued > 0 || this->n_ranges > 0 || !this->running;
+			});
+			self.idle_ns += elapsed_ns(t);
+		}
+	}
+}
+
+// ----- STATIC FUNCTIONS ----
+
+JobSystem& JobSystem::shared(void)
+{
+	if (!shared_created.load(std::memory_order_acquire))
+	{ // freeze the worker count before it is read
+		std::lock_guard<std::mutex> lock(shared_mutex);
+		shared_created = true;
+	}
+	static JobSystem instance(JobSystem::shared_workers);
+	return instance;
+}
+
+bool JobSystem::setSharedWorkerCount(unsigned int n_workers)
+{
+	std::lock_guard<std::mutex> lock(shared_mutex);
+	if (shared_created) return false;
+	shared_workers = n_workers;
+	return true;
+}
+
+unsigned int JobSystem::defaultWorkerCount(void)
+{
+	unsigned int n = std::thread::hardware_concurrency();
+	return (n > 1) ? n - 1 : 1;
+}
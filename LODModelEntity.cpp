@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "LODModelEntity.h"
+
+#include <cmath>
+
+using namespace giselle;
+using namespace scene;
+using namespace model;
+using namespace math;
+
+constexpr float LODModelEntity::DEFAULT_TRIANGLE_PIXELS;
+constexpr float LODModelEntity::DEFAULT_HYSTERESIS;
+
+LODModelEntity::LODModelEntity( const Vector4f& pos, const Vector4f& ang,
+	const std::list<Entity*> & children )
+:	Entity(pos,ang,children)
+,	hysteresis(DEFAULT_HYSTERESIS)
+,	current(0)
+,	occluder(false)
+{
+}
+
+LODModelEntity::LODModelEntity( const std::vector<Model>& chain, float triangle_pixels,
+	const Vector4f& pos, const Vector4f& ang, const std::list<Entity*> & children )
+:	Entity(pos,ang,children)
+,	hysteresis(DEFAULT_HYSTERESIS)
+,	current(0)
+,	occluder(false)
+{
+	// a mesh of n triangles spans about sqrt(n) triangles across, so the next
+	// level's triangles are triangle_pixels high at sqrt(n) * triangle_pixels
+	for (std::size_t i = 0 ; i < chain.size() ; i++)
+	{
+		float min_pixels = 0.0f;
+		if (i + 1 < chain.size())
+			min_pixels = triangle_pixels * std::sqrt((float)chain[i+1].getNTriangles());
+		this->addLevel(chain[i], min_pixels);
+	}
+}
+
+LODModelEntity::~LODModelEntity()
+{
+}
+
+LODModelEntity::LODModelEntity(const LODModelEntity& other)
+:	Entity(other)
+,	levels(other.levels)
+,	hysteresis(other.hysteresis)
+,	current(other.current)
+,	occluder(other.occluder)
+{
+}
+
+void LODModelEntity::addLevel(const Model& model, float min_pixels)
+{
+	Level level = {model, min_pixels};
+	std::vector<Level>::iterator it = this->levels.begin();
+	while (it != this->levels.end() && it->min_pixels >= min_pixels)
+		++it;
+	this->levels.insert(it, level);
+	this->current = 0;
+	this->markDirty();
+}
+
+unsigned int LODModelEntity::getLevelCount(void) const
+{
+	return this->levels.size();
+}
+
+Model& LODModelEntity::getLevel(unsigned int level)
+{
+	return this->levels[level].model;
+}
+
+float LODModelEntity::getThreshold(unsigned int level) const
+{
+	return this->levels[level].min_pixels;
+}
+
+unsigned int LODModelEntity::getCurrentLevel(void) const
+{
+	return this->current;
+}
+
+void LODModelEntity::setHysteresis(float hysteresis)
+{
+	if (hysteresis >= 0.0f && hysteresis < 1.0f)
+		this->hysteresis = hysteresis;
+}
+
+float LODModelEntity::getHysteresis(void) const
+{
+	return this->hysteresis;
+}
+
+void LODModelEntity::setOccluder(bool occluder)
+{
+	this->occluder = occluder;
+}
+
+bool LODModelEntity::isOccluder(void) const
+{
+	return this->occluder;
+}
+
+void LODModelEntity::render(Renderer& renderer) const
+{
+	if (this->levels.empty()) return;
+	const Model& model = this->levels[this->current].model;
+	renderer.passMaterial(model.getMaterial()); // pass this level's material
+	renderer.drawModel(model); //draw the model
+}
+
+bool LODModelEntity::getBounds(Vector4f& min, Vector4f& max) const
+{
+	return !this->levels.empty() && this->levels.front().model.getBounds(min, max);
+}
+
+const Model* LODModelEntity::getOccluder(void) const
+{
+	if (!this->occluder || this->levels.empty()) return nullptr;
+	return &this->levels.back().model;
+}
+
+void LODModelEntity::selectDetail(float pixels) const
+{
+	const unsigned int n = this->levels.size();
+	unsigned int level = this->current;
+
+	// coarser while well under the current level's threshold
+	while (level + 1 < n && pixels < this->levels[level].min_pixels * (1.0f - this->hysteresis))
+		level++;
+
+	// finer while well over the finer level's threshold
+	while (level > 0 && pixels >= this->levels[level-1].min_pixels * (1.0f + this->hysteresis))
+		level--;
+
+	this->current = level;
+}
@@ -33,6 +33,8 @@ Light::Light(const Vector4f& pos, const Vector4f& ang,
 			const Vector4f& light_color )
 :	Entity(pos, ang, children)
 ,	color(light_color)
+,	attenuation(0.0f)
+,	cast_shadows(false)
 {
 	this->color.clamp();
 }
@@ -51,3 +53,23 @@ const math::Vector4f& Light::getColor(void) const
 {
 	return this->color;
 }
+
+void Light::setAttenuation(float attenuation)
+{
+	this->attenuation = (attenuation > 0.0f) ? attenuation : 0.0f;
+}
+
+float Light::getAttenuation(void) const
+{
+	return this->attenuation;
+}
+
+void Light::setCastShadows(bool cast_shadows)
+{
+	this->cast_shadows = cast_shadows;
+}
+
+bool Light::getCastShadows(void) const
+{
+	return this->cast_shadows;
+}
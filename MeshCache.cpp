@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "MeshCache.h"
+
+#include <chrono>
+#include <cstring>
+
+using namespace giselle;
+using namespace giselle::model;
+
+constexpr unsigned int MeshCache::MAX_PARAMS;
+constexpr std::size_t MeshCache::DEFAULT_BUDGET;
+
+MeshCache::Key::Key(unsigned int generator, std::initializer_list<float> params)
+:	generator(generator)
+,	n_params(0)
+{
+	for (float param : params)
+	{
+		if (this->n_params == MAX_PARAMS) break;
+		this->params[this->n_params++] = param;
+	}
+	for (unsigned int i = this->n_params ; i < MAX_PARAMS ; i++)
+		this->params[i] = 0.0f;
+}
+
+bool MeshCache::Key::operator==(const Key& other) const
+{
+	return this->generator == other.generator && this->n_params == other.n_params
+			&& memcmp(this->params, other.params, this->n_params * sizeof(float)) == 0;
+}
+
+std::size_t MeshCache::KeyHash::operator()(const Key& key) const
+{
+	// FNV-1a over the generator and the parameters' bits
+	std::uint64_t hash = 14695981039346656037ull;
+	auto mix = [&hash](std::uint32_t value)
+	{
+		for (int i = 0 ; i < 4 ; i++)
+		{
+			hash ^= (value >> (i * 8)) & 0xff;
+			hash *= 1099511628211ull;
+		}
+	};
+	mix(key.generator);
+	for (unsigned int i = 0 ; i < key.n_params ; i++)
+	{
+		std::uint32_t bits;
+		memcpy(&bits, &key.params[i], sizeof(bits));
+		mix(bits);
+	}
+	return (std::size_t)hash;
+}
+
+MeshCache::MeshCache(std::size_t budget)
+:	budget(budget)
+,	stats()
+,	clears(0)
+{}
+
+std::shared_ptr<const MeshData> MeshCache::get(const Key& key, const Generate& generate)
+{
+	std::unique_lock<std::mutex> lock(this->mutex);
+	auto it = this->entries.find(key);
+	if (it != this->entries.end())
+	{
+		this->stats.hits++;
+		this->lru.splice(this->lru.begin(), this->lru, it->second.lru);
+		Future mesh = it->second.mesh;
+		lock.unlock();
+		return mesh.get(); // waits if another thread is generating it
+	}
+
+	this->stats.misses++;
+	std::promise<std::shared_ptr<const MeshData>> promise;
+	this->lru.push_front(key);
+	Entry& entry = this->entries[key];
+	entry.mesh = promise.get_future().share();
+	entry.bytes = 0;
+	entry.lru = this->lru.begin();
+	const unsigned int clears = this->clears;
+
+	// generate outside the lock, so that other keys are served in the meantime;
+	// only clear() removes the entry until it is ready
+	lock.unlock();
+	std::shared_ptr<const MeshData> mesh;
+	try
+	{
+		mesh = generate();
+	}
+	catch (...)
+	{
+		// the waiting threads get the exception, and later requests try again
+		lock.lock();
+		promise.set_exception(std::current_exception());
+		if (this->clears == clears)
+		{
+			it = this->entries.find(key);
+			this->lru.erase(it->second.lru);
+			this->entries.erase(it);
+		}
+		throw;
+	}
+
+	lock.lock();
+	promise.set_value(mesh);
+	if (this->clears == clears && mesh)
+	{
+		it = this->entries.find(key);
+		it->second.bytes = byteSize(*mesh);
+		this->stats.bytes += it->second.bytes;
+		this->evict();
+	}
+	return mesh;
+}
+
+void MeshCache::setBudget(std::size_t budget)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->budget = budget;
+	this->evict();
+}
+
+std::size_t MeshCache::getBudget(void) const
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->budget;
+}
+
+void MeshCache::clear(void)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->entries.clear();
+	this->lru.clear();
+	this->stats = Stats();
+	this->clears++;
+}
+
+MeshCache::Stats MeshCache::getStats(void) const
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	Stats stats = this->stats;
+	stats.entries = this->entries.size();
+	return stats;
+}
+
+MeshCache& MeshCache::shared(void)
+{
+	static MeshCache cache;
+	return cache;
+}
+
+std::size_t MeshCache::byteSize(const MeshData& mesh)
+{
+	return mesh.getLayout().planarFloat().size(mesh.getNVertices())
+			+ mesh.getNTriangles() * 3 * sizeof(unsigned int);
+}
+
+void MeshCache::evict(void)
+{
+	// walk from the least recently used end, skipping meshes being generated
+	auto it = this->lru.end();
+	while (this->stats.bytes > this->budget && it != this->lru.begin())
+	{
+		--it;
+		auto entry = this->entries.find(*it);
+		if (entry->second.bytes == 0 && entry->second.mesh.wait_for(std::chrono::seconds(0))
+				!= std::future_status::ready)
+			continue;
+
+		this->stats.bytes -= entry->second.bytes;
+		this->stats.evictions++;
+		this->entries.erase(entry);
+		it = this->lru.erase(it);
+	}
+}
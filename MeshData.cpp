@@ -0,0 +1,248 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "MeshData.h"
+#include "MathUtils.h"
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <mutex>
+
+using namespace giselle;
+using namespace giselle::model;
+
+// buffer objects of destroyed meshes, waiting for a thread with a GL context
+struct ReleasedBuffers
+{
+	std::mutex mutex;
+	std::vector<GLuint> names;
+};
+
+static ReleasedBuffers& released_buffers(void)
+{
+	// never destroyed, as meshes may still be released during static destruction
+	static ReleasedBuffers* p_released = new ReleasedBuffers;
+	return *p_released;
+}
+
+MeshData::MeshData(void)
+:	nVertices(0)
+,	nTriangles(0)
+,	vertex_arr(nullptr)
+,	index_arr(nullptr)
+{
+	this->buffers[0] = this->buffers[1] = 0;
+	this->index_size = 0;
+}
+
+MeshData::MeshData(unsigned int nVertices, unsigned int nTriangles, const float* vertex_array,
+		const float* vertex_normal_array, const unsigned int* index_array,
+		const VertexLayout& layout)
+:	nVertices(nVertices)
+,	nTriangles(nTriangles)
+,	layout(layout)
+{
+	this->buffers[0] = this->buffers[1] = 0;
+	this->index_size = 0;
+
+	// positions and normals first, then the defaults of the other attributes
+	const VertexLayout planar = layout.planarFloat();
+	const VertexLayout given(VertexLayout::FLOAT, VertexLayout::FLOAT,
+			VertexLayout::NONE, VertexLayout::NONE, false);
+	this->vertex_arr = new float[planar.size(nVertices) / sizeof(float)];
+	memcpy(this->vertex_arr, vertex_array, nVertices*3*sizeof(float));
+	memcpy(this->vertex_arr + nVertices*3, vertex_normal_array, nVertices*3*sizeof(float));
+	if (planar != given) // in place, positions and normals keep their offsets
+		VertexLayout::convert(given, this->vertex_arr, planar, this->vertex_arr, nVertices);
+
+	this->index_arr = new unsigned int[nTriangles*3];
+	memcpy(this->index_arr, index_array, nTriangles*3*sizeof(unsigned int));
+
+	this->calcBounds();
+}
+
+MeshData::~MeshData(void)
+{
+	if (this->buffers[0] != 0)
+	{ // there may be no GL context on this thread
+		ReleasedBuffers& released = released_buffers();
+		std::lock_guard<std::mutex> lock(released.mutex);
+		released.names.insert(released.names.end(), this->buffers, this->buffers + 2);
+	}
+
+	if (this->vertex_arr != nullptr)
+	{ delete[] this->vertex_arr; this->vertex_arr = nullptr; }
+
+	if (this->index_arr != nullptr)
+	{ delete[] this->index_arr; this->index_arr = nullptr; }
+}
+
+void MeshData::deleteReleasedBuffers(void)
+{
+	ReleasedBuffers& released = released_buffers();
+	std::lock_guard<std::mutex> lock(released.mutex);
+	if (released.names.empty()) return;
+	glDeleteBuffers(released.names.size(), released.names.data());
+	released.names.clear();
+}
+
+unsigned int MeshData::getNVertices(void) const
+{ return this->nVertices; }
+
+unsigned int MeshData::getNTriangles(void) const
+{ return this->nTriangles; }
+
+const float* MeshData::getVertexArray(void) const
+{ return this->vertex_arr; }
+
+const float* MeshData::getVertexNormalArray(void) const
+{ return this->attribute(VertexLayout::NORMAL); }
+
+const float* MeshData::getTexCoordArray(void) const
+{ return this->attribute(VertexLayout::TEXCOORD); }
+
+const float* MeshData::getColorArray(void) const
+{ return this->attribute(VertexLayout::COLOR); }
+
+const unsigned int* MeshData::getIndexArray(void) const
+{ return this->index_arr; }
+
+const VertexLayout& MeshData::getLayout(void) const
+{ return this->layout; }
+
+std::shared_ptr<const MeshData> MeshData::withLayout(const VertexLayout& layout) const
+{
+	MeshData* p = new MeshData();
+	p->nVertices = this->nVertices;
+	p->nTriangles = this->nTriangles;
+	p->layout = layout;
+	p->bounds_min = this->bounds_min;
+	p->bounds_max = this->bounds_max;
+
+	const VertexLayout planar = layout.planarFloat();
+	float bounds[6];
+	this->get_bounds(bounds);
+	p->vertex_arr = new float[planar.size(this->nVertices) / sizeof(float)];
+	VertexLayout::convert(this->layout.planarFloat(), this->vertex_arr,
+			planar, p->vertex_arr, this->nVertices, bounds);
+
+	p->index_arr = new unsigned int[this->nTriangles*3];
+	memcpy(p->index_arr, this->index_arr, this->nTriangles*3*sizeof(unsigned int));
+
+	return std::shared_ptr<const MeshData>(p);
+}
+
+const float* MeshData::attribute(VertexLayout::Attribute attribute) const
+{
+	if (this->vertex_arr == nullptr || !this->layout.has(attribute)) return nullptr;
+	return this->vertex_arr
+			+ this->layout.planarFloat().offset(attribute, this->nVertices) / sizeof(float);
+}
+
+void MeshData::getBounds(math::Vector4f& min, math::Vector4f& max) const
+{
+	min = this->bounds_min;
+	max = this->bounds_max;
+}
+
+MeshData::QuantizationError MeshData::getQuantizationError(void) const
+{
+	QuantizationError error = { 0.0f, 0.0f };
+	if (this->vertex_arr == nullptr) return error;
+
+	// positions and normals only, through the layout and back
+	const VertexLayout planar = this->layout.planarFloat();
+	const VertexLayout encoded(this->layout.formats[VertexLayout::POSITION],
+			this->layout.formats[VertexLayout::NORMAL], VertexLayout::NONE, VertexLayout::NONE,
+			this->layout.interleaved);
+	const VertexLayout decoded = encoded.planarFloat();
+	float bounds[6];
+	this->get_bounds(bounds);
+
+	std::vector<unsigned char> data(encoded.size(this->nVertices));
+	std::vector<float> back(decoded.size(this->nVertices) / sizeof(float));
+	VertexLayout::convert(planar, this->vertex_arr, encoded, data.data(), this->nVertices, bounds);
+	VertexLayout::convert(encoded, data.data(), decoded, back.data(), this->nVertices, bounds);
+
+	const unsigned int n = this->nVertices;
+	for (unsigned int i = 0 ; i < n ; i++)
+	{
+		const float* p = this->vertex_arr + 3*i;
+		const float* q = back.data() + 3*i;
+		const float dx = p[0] - q[0], dy = p[1] - q[1], dz = p[2] - q[2];
+		const float d = std::sqrt(dx*dx + dy*dy + dz*dz);
+		if (d > error.position) error.position = d;
+
+		const float* a = this->vertex_arr + 3*n + 3*i;
+		const float* b = back.data() + 3*n + 3*i;
+		const float la = std::sqrt(a[0]*a[0] + a[1]*a[1] + a[2]*a[2]);
+		const float lb = std::sqrt(b[0]*b[0] + b[1]*b[1] + b[2]*b[2]);
+		if (la == 0.0f || lb == 0.0f) continue;
+		float c = (a[0]*b[0] + a[1]*b[1] + a[2]*b[2]) / (la * lb);
+		if (c > 1.0f) c = 1.0f;
+		const float angle = math::radians2degrees(std::acos(c));
+		if (angle > error.normal) error.normal = angle;
+	}
+	return error;
+}
+
+void MeshData::get_bounds(float* bounds) const
+{
+	bounds[0] = this->bounds_min.x();
+	bounds[1] = this->bounds_min.y();
+	bounds[2] = this->bounds_min.z();
+	bounds[3] = this->bounds_max.x();
+	bounds[4] = this->bounds_max.y();
+	bounds[5] = this->bounds_max.z();
+}
+
+bool MeshData::isUploaded(void) const
+{
+	return this->buffers[0] != 0;
+}
+
+void MeshData::calcBounds(void)
+{
+	if (this->vertex_arr == nullptr || this->nVertices == 0) return;
+
+	float lo[3], hi[3];
+	for (int k = 0 ; k < 3 ; k++)
+		lo[k] = hi[k] = this->vertex_arr[k];
+
+	for (unsigned int i = 1 ; i < this->nVertices ; i++)
+	{
+		for (int k = 0 ; k < 3 ; k++)
+		{
+			float v = this->vertex_arr[i*3 + k];
+			if (v < lo[k]) lo[k] = v;
+			if (v > hi[k]) hi[k] = v;
+		}
+	}
+
+	this->bounds_min = math::Vector4f(lo[0], lo[1], lo[2]);
+	this->bounds_max = math::Vector4f(hi[0], hi[1], hi[2]);
+}
@@ -0,0 +1,510 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "MeshOptimizer.h"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace giselle;
+using namespace giselle::model;
+
+constexpr unsigned int MeshOptimizer::CACHE_SIZE;
+constexpr float MeshOptimizer::OVERDRAW_THRESHOLD;
+
+std::atomic<bool> MeshOptimizer::automatic(false);
+
+namespace
+{
+	// parameters of Forsyth's "Linear-Speed Vertex Cache Optimisation"
+	const unsigned int FORSYTH_CACHE = 32;
+	const unsigned int FORSYTH_VALENCE = 32;
+	const float LAST_TRIANGLE_SCORE = 0.75f;
+	const float CACHE_DECAY = 1.5f;
+	const float VALENCE_BOOST_SCALE = 2.0f;
+	const float VALENCE_BOOST_POWER = 0.5f;
+
+	struct ForsythTables
+	{
+		float cache[FORSYTH_CACHE];
+		float valence[FORSYTH_VALENCE];
+
+		ForsythTables(void)
+		{
+			for (unsigned int i = 0 ; i < FORSYTH_CACHE ; i++)
+			{
+				// the vertices of the last triangle get a fixed score, so that
+				// the next triangle is not biased to any of its edges
+				if (i < 3)
+					cache[i] = LAST_TRIANGLE_SCORE;
+				else
+					cache[i] = std::pow(1.0f - (float)(i - 3) / (FORSYTH_CACHE - 3), CACHE_DECAY);
+			}
+			valence[0] = 0.0f;
+			for (unsigned int i = 1 ; i < FORSYTH_VALENCE ; i++)
+				valence[i] = VALENCE_BOOST_SCALE * std::pow((float)i, -VALENCE_BOOST_POWER);
+		}
+	};
+
+	const ForsythTables& forsyth_tables(void)
+	{
+		static const ForsythTables tables;
+		return tables;
+	}
+
+	float forsyth_score(int cache_position, unsigned int live_triangles)
+	{
+		// vertices with no triangles left can't make any triangle better
+		if (live_triangles == 0) return -1.0f;
+
+		const ForsythTables& tables = forsyth_tables();
+		float score = cache_position < 0 ? 0.0f : tables.cache[cache_position];
+		if (live_triangles < FORSYTH_VALENCE)
+			score += tables.valence[live_triangles];
+		else
+			score += VALENCE_BOOST_SCALE * std::pow((float)live_triangles, -VALENCE_BOOST_POWER);
+		return score;
+	}
+
+	// triangles using each vertex, as offsets into a single list
+	struct Adjacency
+	{
+		std::vector<unsigned int> counts;
+		std::vector<unsigned int> offsets;
+		std::vector<unsigned int> triangles;
+
+		Adjacency(const unsigned int* indices, unsigned int nTriangles, unsigned int nVertices)
+		:	counts(nVertices, 0)
+		,	offsets(nVertices, 0)
+		,	triangles(nTriangles * 3)
+		{
+			for (unsigned int i = 0 ; i < nTriangles * 3 ; i++)
+				counts[indices[i]]++;
+			unsigned int offset = 0;
+			for (unsigned int v = 0 ; v < nVertices ; v++)
+			{
+				offsets[v] = offset;
+				offset += counts[v];
+			}
+			std::vector<unsigned int> fill(offsets);
+			for (unsigned int i = 0 ; i < nTriangles * 3 ; i++)
+				triangles[fill[indices[i]]++] = i / 3;
+		}
+	};
+
+	void triangle_normal(const float* positions, const unsigned int* tri, float* n)
+	{
+		const float* a = positions + tri[0]*3;
+		const float* b = positions + tri[1]*3;
+		const float* c = positions + tri[2]*3;
+		float u[3] = {b[0]-a[0], b[1]-a[1], b[2]-a[2]};
+		float w[3] = {c[0]-a[0], c[1]-a[1], c[2]-a[2]};
+		// not normalized: its length is twice the triangle's area
+		n[0] = u[1]*w[2] - u[2]*w[1];
+		n[1] = u[2]*w[0] - u[0]*w[2];
+		n[2] = u[0]*w[1] - u[1]*w[0];
+	}
+};
+
+MeshOptimizer::CacheStatistics MeshOptimizer::analyze(const unsigned int* indices,
+		unsigned int nTriangles, unsigned int nVertices, unsigned int cache_size)
+{
+	CacheStatistics stats = {0.0f, 0.0f};
+	if (indices == nullptr || nTriangles == 0 || nVertices == 0 || cache_size == 0)
+		return stats;
+
+	// FIFO cache: a vertex is still cached while fewer than cache_size misses
+	// happened since it was last loaded
+	std::vector<unsigned int> loaded(nVertices, 0);
+	unsigned int time = cache_size + 1;
+	unsigned int misses = 0, used = 0;
+	for (unsigned int i = 0 ; i < nTriangles * 3 ; i++)
+	{
+		unsigned int v = indices[i];
+		if (loaded[v] == 0) used++;
+		if (time - loaded[v] > cache_size)
+		{
+			loaded[v] = time++;
+			misses++;
+		}
+	}
+
+	stats.acmr = (float)misses / nTriangles;
+	stats.atvr = (float)misses / used;
+	return stats;
+}
+
+void MeshOptimizer::optimizeVertexCache(unsigned int* indices, unsigned int nTriangles,
+		unsigned int nVertices)
+{
+	if (indices == nullptr || nTriangles == 0 || nVertices == 0) return;
+
+	Adjacency adjacency(indices, nTriangles, nVertices);
+	// the triangles not emitted yet come first in each vertex's list
+	std::vector<unsigned int>& live = adjacency.counts;
+
+	std::vector<int> cache_position(nVertices, -1);
+	std::vector<float> vertex_score(nVertices);
+	for (unsigned int v = 0 ; v < nVertices ; v++)
+		vertex_score[v] = forsyth_score(-1, live[v]);
+
+	std::vector<bool> emitted(nTriangles, false);
+
+	std::vector<unsigned int> output(nTriangles * 3);
+
+	// the last three slots hold the vertices pushed out by the latest triangle
+	unsigned int cache[FORSYTH_CACHE + 3];
+	unsigned int cache_count = 0;
+
+	// start from the best triangle of the whole mesh
+	unsigned int best = 0;
+	float best_score = -1.0f;
+	for (unsigned int t = 0 ; t < nTriangles ; t++)
+	{
+		const unsigned int* tri = indices + t*3;
+		float score = vertex_score[tri[0]] + vertex_score[tri[1]] + vertex_score[tri[2]];
+		if (score > best_score)
+		{
+			best_score = score;
+			best = t;
+		}
+	}
+
+	unsigned int next_unemitted = 0;
+	for (unsigned int out = 0 ; out < nTriangles ; out++)
+	{
+		if (best == nTriangles)
+		{
+			// the cache ran dry: restart from the next triangle of the input
+			while (emitted[next_unemitted]) next_unemitted++;
+			best = next_unemitted;
+		}
+
+		const unsigned int* tri = indices + best*3;
+		std::memcpy(output.data() + out*3, tri, 3 * sizeof(unsigned int));
+		emitted[best] = true;
+
+		// retire the triangle from its vertices' lists
+		for (unsigned int k = 0 ; k < 3 ; k++)
+		{
+			unsigned int v = tri[k];
+			unsigned int* list = adjacency.triangles.data() + adjacency.offsets[v];
+			for (unsigned int j = 0 ; j < live[v] ; j++)
+			{
+				if (list[j] == best)
+				{
+					std::swap(list[j], list[live[v] - 1]);
+					live[v]--;
+					break;
+				}
+			}
+		}
+
+		// move the triangle's vertices to the front of the cache (LRU)
+		unsigned int new_cache[FORSYTH_CACHE + 3];
+		unsigned int new_count = 0;
+		for (unsigned int k = 0 ; k < 3 ; k++)
+			new_cache[new_count++] = tri[k];
+		for (unsigned int i = 0 ; i < cache_count ; i++)
+		{
+			unsigned int v = cache[i];
+			if (v != tri[0] && v != tri[1] && v != tri[2])
+				new_cache[new_count++] = v;
+		}
+		std::memcpy(cache, new_cache, new_count * sizeof(unsigned int));
+		cache_count = new_count;
+
+		// rescore the vertices that moved, including those pushed out
+		for (unsigned int i = 0 ; i < cache_count ; i++)
+		{
+			unsigned int v = cache[i];
+			cache_position[v] = i < FORSYTH_CACHE ? (int)i : -1;
+			vertex_score[v] = forsyth_score(cache_position[v], live[v]);
+		}
+
+		// the next triangle is the best one touching the cache
+		best = nTriangles;
+		best_score = -1.0f;
+		for (unsigned int i = 0 ; i < cache_count ; i++)
+		{
+			unsigned int v = cache[i];
+			const unsigned int* list = adjacency.triangles.data() + adjacency.offsets[v];
+			for (unsigned int j = 0 ; j < live[v] ; j++)
+			{
+				unsigned int t = list[j];
+				const unsigned int* other = indices + t*3;
+				float score = vertex_score[other[0]] + vertex_score[other[1]] + vertex_score[other[2]];
+				if (score > best_score)
+				{
+					best_score = score;
+					best = t;
+				}
+			}
+		}
+		if (cache_count > FORSYTH_CACHE)
+			cache_count = FORSYTH_CACHE;
+	}
+
+	std::memcpy(indices, output.data(), nTriangles * 3 * sizeof(unsigned int));
+}
+
+void MeshOptimizer::optimizeOverdraw(unsigned int* indices, unsigned int nTriangles,
+		const float* positions, unsigned int nVertices, float threshold)
+{
+	if (indices == nullptr || positions == nullptr || nTriangles < 2 || nVertices == 0)
+		return;
+
+	// hard boundaries: triangles whose vertices all miss the cache, where the
+	// cache order jumped to another area of the mesh
+	std::vector<unsigned int> misses(nTriangles);
+	{
+		std::vector<unsigned int> loaded(nVertices, 0);
+		unsigned int time = CACHE_SIZE + 1;
+		for (unsigned int t = 0 ; t < nTriangles ; t++)
+		{
+			misses[t] = 0;
+			for (unsigned int k = 0 ; k < 3 ; k++)
+			{
+				unsigned int v = indices[t*3 + k];
+				if (time - loaded[v] > CACHE_SIZE)
+				{
+					loaded[v] = time++;
+					misses[t]++;
+				}
+			}
+		}
+	}
+	std::vector<unsigned int> hard;
+	for (unsigned int t = 0 ; t < nTriangles ; t++)
+		if (t == 0 || misses[t] == 3) hard.push_back(t);
+	hard.push_back(nTriangles);
+
+	// soft boundaries: within an area, end a cluster once its own ACMR, starting
+	// from an empty cache, is close enough to the area's, so that drawing it apart
+	// from its neighbours costs little cache efficiency
+	std::vector<unsigned int> clusters;
+	std::vector<unsigned int> loaded(nVertices, 0);
+	unsigned int time = CACHE_SIZE + 1;
+	for (std::size_t h = 0 ; h + 1 < hard.size() ; h++)
+	{
+		unsigned int begin = hard[h], end = hard[h+1];
+		unsigned int area_misses = 0;
+		for (unsigned int t = begin ; t < end ; t++)
+			area_misses += misses[t];
+		float limit = threshold * area_misses / (end - begin);
+
+		unsigned int start = begin, cluster_misses = 0;
+		clusters.push_back(begin);
+		time += CACHE_SIZE + 1; // flush the cache
+		for (unsigned int t = begin ; t < end ; t++)
+		{
+			for (unsigned int k = 0 ; k < 3 ; k++)
+			{
+				unsigned int v = indices[t*3 + k];
+				if (time - loaded[v] > CACHE_SIZE)
+				{
+					loaded[v] = time++;
+					cluster_misses++;
+				}
+			}
+			if (t + 1 < end && (float)cluster_misses / (t + 1 - start) <= limit)
+			{
+				start = t + 1;
+				cluster_misses = 0;
+				clusters.push_back(start);
+				time += CACHE_SIZE + 1;
+			}
+		}
+	}
+	clusters.push_back(nTriangles);
+	unsigned int nClusters = (unsigned int)clusters.size() - 1;
+	if (nClusters < 2) return;
+
+	// area-weighted centroid and normal of the clusters and of the mesh
+	std::vector<float> centroids(nClusters * 3), normals(nClusters * 3);
+	float mesh_centroid[3] = {0.0f, 0.0f, 0.0f};
+	float mesh_area = 0.0f;
+	for (unsigned int c = 0 ; c < nClusters ; c++)
+	{
+		float* centroid = centroids.data() + c*3;
+		float* normal = normals.data() + c*3;
+		float area = 0.0f;
+		centroid[0] = centroid[1] = centroid[2] = 0.0f;
+		normal[0] = normal[1] = normal[2] = 0.0f;
+		for (unsigned int t = clusters[c] ; t < clusters[c+1] ; t++)
+		{
+			const unsigned int* tri = indices + t*3;
+			float n[3];
+			triangle_normal(positions, tri, n);
+			float a = std::sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+			for (unsigned int k = 0 ; k < 3 ; k++)
+			{
+				centroid[k] += a * (positions[tri[0]*3+k] + positions[tri[1]*3+k]
+						+ positions[tri[2]*3+k]) / 3.0f;
+				normal[k] += n[k];
+			}
+			area += a;
+		}
+		for (unsigned int k = 0 ; k < 3 ; k++)
+			mesh_centroid[k] += centroid[k];
+		mesh_area += area;
+		if (area > 0.0f)
+			for (unsigned int k = 0 ; k < 3 ; k++)
+				centroid[k] /= area;
+		float length = std::sqrt(normal[0]*normal[0] + normal[1]*normal[1] + normal[2]*normal[2]);
+		if (length > 0.0f)
+			for (unsigned int k = 0 ; k < 3 ; k++)
+				normal[k] /= length;
+	}
+	if (mesh_area > 0.0f)
+		for (unsigned int k = 0 ; k < 3 ; k++)
+			mesh_centroid[k] /= mesh_area;
+
+	// clusters facing away from the center are the most likely occluders
+	std::vector<float> keys(nClusters);
+	std::vector<unsigned int> order(nClusters);
+	for (unsigned int c = 0 ; c < nClusters ; c++)
+	{
+		const float* centroid = centroids.data() + c*3;
+		const float* normal = normals.data() + c*3;
+		keys[c] = (centroid[0] - mesh_centroid[0]) * normal[0]
+				+ (centroid[1] - mesh_centroid[1]) * normal[1]
+				+ (centroid[2] - mesh_centroid[2]) * normal[2];
+		order[c] = c;
+	}
+	std::stable_sort(order.begin(), order.end(),
+			[&keys](unsigned int a, unsigned int b) { return keys[a] > keys[b]; });
+
+	std::vector<unsigned int> output;
+	output.reserve(nTriangles * 3);
+	for (unsigned int c : order)
+		output.insert(output.end(), indices + clusters[c]*3, indices + clusters[c+1]*3);
+	std::memcpy(indices, output.data(), nTriangles * 3 * sizeof(unsigned int));
+}
+
+void MeshOptimizer::optimizeVertexFetch(float* vertices, const VertexLayout& layout,
+		unsigned int nVertices, unsigned int* indices, unsigned int nTriangles)
+{
+	if (vertices == nullptr || indices == nullptr || nVertices == 0) return;
+
+	const unsigned int UNUSED = ~0u;
+	std::vector<unsigned int> remap(nVertices, UNUSED);
+	unsigned int next = 0;
+	for (unsigned int i = 0 ; i < nTriangles * 3 ; i++)
+	{
+		unsigned int& r = remap[indices[i]];
+		if (r == UNUSED) r = next++;
+		indices[i] = r;
+	}
+	for (unsigned int v = 0 ; v < nVertices ; v++)
+		if (remap[v] == UNUSED) remap[v] = next++;
+
+	VertexLayout planar = layout.planarFloat();
+	std::vector<float> scratch;
+	for (unsigned int a = 0 ; a < VertexLayout::ATTRIBUTE_COUNT ; a++)
+	{
+		VertexLayout::Attribute attribute = (VertexLayout::Attribute)a;
+		if (!planar.has(attribute)) continue;
+
+		unsigned int n = VertexLayout::components(attribute);
+		float* data = vertices + planar.offset(attribute, nVertices) / sizeof(float);
+		scratch.assign(data, data + nVertices * n);
+		for (unsigned int v = 0 ; v < nVertices ; v++)
+			std::memcpy(data + remap[v]*n, scratch.data() + v*n, n * sizeof(float));
+	}
+}
+
+MeshOptimizer::Report MeshOptimizer::optimize(ModelBuilder& builder)
+{
+	unsigned int nVertices = builder.getNVertices();
+	unsigned int nTriangles = builder.getNTriangles();
+	unsigned int* indices = builder.getIndexArray();
+
+	Report report;
+	report.before = analyze(indices, nTriangles, nVertices);
+	const std::vector<unsigned int> original(indices, indices + nTriangles * 3);
+	optimizeVertexCache(indices, nTriangles, nVertices);
+	optimizeOverdraw(indices, nTriangles, builder.getVertexArray(), nVertices);
+	report.after = analyze(indices, nTriangles, nVertices);
+
+	// small or already well ordered meshes may come out worse
+	if (report.after.acmr >= report.before.acmr)
+	{
+		std::copy(original.begin(), original.end(), indices);
+		report.after = report.before;
+		return report;
+	}
+
+	// renumbering the vertices leaves the cache statistics as they are
+	optimizeVertexFetch(builder.getVertexArray(), builder.getLayout(), nVertices,
+			indices, nTriangles);
+	return report;
+}
+
+Model MeshOptimizer::optimize(const Model& model, Report* p_report)
+{
+	const MeshData* p_mesh = model.getMesh().get();
+	if (p_mesh == nullptr)
+	{
+		if (p_report != nullptr) *p_report = Report();
+		return model;
+	}
+
+	unsigned int nVertices = p_mesh->getNVertices();
+	unsigned int nTriangles = p_mesh->getNTriangles();
+	ModelBuilder builder(nVertices, nTriangles, p_mesh->getLayout());
+	std::memcpy(builder.getVertexArray(), p_mesh->getVertexArray(), nVertices*3 * sizeof(float));
+	if (builder.getVertexNormalArray() != nullptr)
+		std::memcpy(builder.getVertexNormalArray(), p_mesh->getVertexNormalArray(),
+				nVertices*3 * sizeof(float));
+	if (builder.getTexCoordArray() != nullptr)
+		std::memcpy(builder.getTexCoordArray(), p_mesh->getTexCoordArray(),
+				nVertices*2 * sizeof(float));
+	if (builder.getColorArray() != nullptr)
+		std::memcpy(builder.getColorArray(), p_mesh->getColorArray(),
+				nVertices*4 * sizeof(float));
+	std::memcpy(builder.getIndexArray(), p_mesh->getIndexArray(),
+			nTriangles*3 * sizeof(unsigned int));
+	math::Vector4f min, max;
+	p_mesh->getBounds(min, max);
+	builder.setBounds(min, max);
+
+	Report report = optimize(builder);
+	if (p_report != nullptr) *p_report = report;
+
+	builder.setOptimize(false);
+	return builder.build(model.getMaterial());
+}
+
+void MeshOptimizer::setAutomatic(bool enabled)
+{
+	automatic.store(enabled, std::memory_order_relaxed);
+}
+
+bool MeshOptimizer::isAutomatic(void)
+{
+	return automatic.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,713 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "MeshSimplifier.h"
+#include "ModelBuilder.h"
+#include "JobSystem.h"
+#include "TraceRecorder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#ifdef _GISELLE_DEBUG
+#include <iostream>
+#define MeshSimplifier_D(x) std::cout << x
+#else
+#define MeshSimplifier_D(x)
+#endif
+
+using namespace giselle;
+using namespace giselle::model;
+
+constexpr unsigned int MeshSimplifier::PARALLEL_GRAIN;
+constexpr float MeshSimplifier::LOD_RATIO;
+
+namespace
+{
+	// weight of the planes keeping borders and seams in place, per squared edge length
+	const float BORDER_WEIGHT = 10.0f;
+
+	// collapses may not turn a triangle's normal further than acos(0.25)
+	const float MIN_NORMAL_COSINE = 0.25f;
+
+	// sum of squared distances to a set of weighted planes
+	struct Quadric
+	{
+		float a00, a11, a22, a01, a02, a12;
+		float b0, b1, b2;
+		float c;
+		float w;
+	};
+
+	void quadric_plane(Quadric& q, const float* n, float d, float w)
+	{
+		q.a00 = w * n[0] * n[0];
+		q.a11 = w * n[1] * n[1];
+		q.a22 = w * n[2] * n[2];
+		q.a01 = w * n[0] * n[1];
+		q.a02 = w * n[0] * n[2];
+		q.a12 = w * n[1] * n[2];
+		q.b0 = w * n[0] * d;
+		q.b1 = w * n[1] * d;
+		q.b2 = w * n[2] * d;
+		q.c = w * d * d;
+		q.w = w;
+	}
+
+	void quadric_add(Quadric& q, const Quadric& r)
+	{
+		q.a00 += r.a00; q.a11 += r.a11; q.a22 += r.a22;
+		q.a01 += r.a01; q.a02 += r.a02; q.a12 += r.a12;
+		q.b0 += r.b0; q.b1 += r.b1; q.b2 += r.b2;
+		q.c += r.c;
+		q.w += r.w;
+	}
+
+	// mean squared distance of a point to the planes
+	float quadric_error(const Quadric& q, const float* v)
+	{
+		float x = v[0], y = v[1], z = v[2];
+		float e = q.a00*x*x + q.a11*y*y + q.a22*z*z
+				+ 2 * (q.a01*x*y + q.a02*x*z + q.a12*y*z)
+				+ 2 * (q.b0*x + q.b1*y + q.b2*z) + q.c;
+		return q.w > 0 ? std::fabs(e) / q.w : 0.0f;
+	}
+
+	void cross(const float* u, const float* w, float* n)
+	{
+		n[0] = u[1]*w[2] - u[2]*w[1];
+		n[1] = u[2]*w[0] - u[0]*w[2];
+		n[2] = u[0]*w[1] - u[1]*w[0];
+	}
+
+	float dot(const float* u, const float* w)
+	{ return u[0]*w[0] + u[1]*w[1] + u[2]*w[2]; }
+
+	void triangle_normal(const float* a, const float* b, const float* c, float* n)
+	{
+		float u[3] = {b[0]-a[0], b[1]-a[1], b[2]-a[2]};
+		float w[3] = {c[0]-a[0], c[1]-a[1], c[2]-a[2]};
+		cross(u, w, n);
+	}
+
+	const float* mesh_attribute(const MeshData& mesh, VertexLayout::Attribute attribute)
+	{
+		switch (attribute)
+		{
+			case VertexLayout::POSITION: return mesh.getVertexArray();
+			case VertexLayout::NORMAL: return mesh.getVertexNormalArray();
+			case VertexLayout::TEXCOORD: return mesh.getTexCoordArray();
+			case VertexLayout::COLOR: return mesh.getColorArray();
+			default: return nullptr;
+		}
+	}
+
+	float* builder_attribute(ModelBuilder& builder, VertexLayout::Attribute attribute)
+	{
+		switch (attribute)
+		{
+			case VertexLayout::POSITION: return builder.getVertexArray();
+			case VertexLayout::NORMAL: return builder.getVertexNormalArray();
+			case VertexLayout::TEXCOORD: return builder.getTexCoordArray();
+			case VertexLayout::COLOR: return builder.getColorArray();
+			default: return nullptr;
+		}
+	}
+
+	/**
+	 * The state of a simplification. Vertices with the same attributes are merged
+	 * into one, and vertices with the same position share a position id (the index
+	 * of one of them) and a quadric.
+	 */
+	class Simplifier
+	{
+		public:
+			explicit Simplifier(const MeshData& mesh);
+
+			/** Collapses edges until the target is reached or the error limit
+			 * would be exceeded
+			 * \return whether any edge was collapsed */
+			bool reduce(unsigned int target_triangles, float error_limit);
+
+			unsigned int getNTriangles(void) const
+			{ return (unsigned int)(this->indices.size() / 3); }
+
+			float getError(void) const
+			{ return this->error; }
+
+			Model extract(const Material& material) const;
+
+		private:
+			enum Kind { MANIFOLD, BORDER, SEAM, LOCKED };
+			enum EdgeKind { INTERIOR, BORDER_EDGE, SEAM_EDGE, NON_MANIFOLD };
+
+			struct HalfEdge
+			{
+				std::uint64_t key; // position ids, smallest first
+				unsigned int triangle;
+				unsigned int corner; // the half-edge goes from this corner to the next
+			};
+
+			struct Edge
+			{
+				unsigned int p0, p1;
+				unsigned int triangle; // one of the triangles of the edge
+				EdgeKind kind;
+			};
+
+			struct Collapse
+			{
+				unsigned int from, to;
+				float cost;
+			};
+
+			const MeshData& mesh;
+			unsigned int nVertices;
+			const float* positions;
+			std::vector<unsigned int> position; // vertex -> position id
+			std::vector<unsigned int> indices;  // current triangles
+			std::vector<Quadric> quadrics;      // per position id
+			std::vector<unsigned char> kinds;   // per position id
+			std::vector<Edge> edges;
+			float scale; // 1 / size of the mesh
+			float error;
+
+			const float* pos(unsigned int vertex) const
+			{ return this->positions + vertex*3; }
+
+			void classify(void);
+			bool pass(unsigned int target_triangles, float error_limit);
+			bool can_move(unsigned int p, EdgeKind kind) const;
+	};
+
+	Simplifier::Simplifier(const MeshData& mesh)
+	:	mesh(mesh)
+	,	nVertices(mesh.getNVertices())
+	,	positions(mesh.getVertexArray())
+	,	position(mesh.getNVertices())
+	,	quadrics(mesh.getNVertices())
+	,	kinds(mesh.getNVertices(), MANIFOLD)
+	,	scale(0.0f)
+	,	error(0.0f)
+	{
+		const unsigned int nV = this->nVertices;
+
+		// merge the vertices with identical attributes
+		const VertexLayout& layout = mesh.getLayout();
+		std::vector<const float*> arrays;
+		std::vector<unsigned int> components;
+		for (unsigned int a = 0 ; a < VertexLayout::ATTRIBUTE_COUNT ; a++)
+		{
+			VertexLayout::Attribute attribute = (VertexLayout::Attribute)a;
+			if (!layout.has(attribute)) continue;
+			arrays.push_back(mesh_attribute(mesh, attribute));
+			components.push_back(VertexLayout::components(attribute));
+		}
+		auto less_attributes = [&](unsigned int u, unsigned int v)
+		{
+			for (std::size_t a = 0 ; a < arrays.size() ; a++)
+			{
+				unsigned int n = components[a];
+				const float* x = arrays[a] + u*n;
+				const float* y = arrays[a] + v*n;
+				for (unsigned int k = 0 ; k < n ; k++)
+					if (x[k] != y[k]) return x[k] < y[k];
+			}
+			return false;
+		};
+		auto less_position = [this](unsigned int u, unsigned int v)
+		{
+			const float* x = this->pos(u);
+			const float* y = this->pos(v);
+			for (unsigned int k = 0 ; k < 3 ; k++)
+				if (x[k] != y[k]) return x[k] < y[k];
+			return false;
+		};
+
+		std::vector<unsigned int> order(nV);
+		for (unsigned int v = 0 ; v < nV ; v++) order[v] = v;
+
+		std::vector<unsigned int> merged(nV);
+		std::sort(order.begin(), order.end(), less_attributes);
+		for (unsigned int i = 0 ; i < nV ; i++)
+			merged[order[i]] = (i > 0 && !less_attributes(order[i-1], order[i]))
+					? merged[order[i-1]] : order[i];
+
+		std::sort(order.begin(), order.end(), less_position);
+		for (unsigned int i = 0 ; i < nV ; i++)
+			this->position[order[i]] = (i > 0 && !less_position(order[i-1], order[i]))
+					? this->position[order[i-1]] : order[i];
+
+		const unsigned int* source = mesh.getIndexArray();
+		unsigned int nT = mesh.getNTriangles();
+		this->indices.reserve(nT * 3);
+		for (unsigned int t = 0 ; t < nT ; t++)
+		{
+			unsigned int a = merged[source[t*3]];
+			unsigned int b = merged[source[t*3+1]];
+			unsigned int c = merged[source[t*3+2]];
+			if (this->position[a] == this->position[b] || this->position[b] == this->position[c]
+					|| this->position[a] == this->position[c])
+				continue;
+			this->indices.push_back(a);
+			this->indices.push_back(b);
+			this->indices.push_back(c);
+		}
+		nT = this->getNTriangles();
+
+		math::Vector4f min, max;
+		mesh.getBounds(min, max);
+		float diagonal = std::sqrt((max.x()-min.x())*(max.x()-min.x())
+				+ (max.y()-min.y())*(max.y()-min.y()) + (max.z()-min.z())*(max.z()-min.z()));
+		if (diagonal > 0) this->scale = 1.0f / diagonal;
+
+		// plane quadrics of the triangles, weighted by their area
+		std::vector<Quadric> triangle_quadrics(nT);
+		JobSystem::shared().parallelFor(0, nT, MeshSimplifier::PARALLEL_GRAIN,
+			[&](unsigned int begin, unsigned int end)
+			{
+				for (unsigned int t = begin ; t < end ; t++)
+				{
+					const unsigned int* tri = this->indices.data() + t*3;
+					float n[3];
+					triangle_normal(this->pos(tri[0]), this->pos(tri[1]), this->pos(tri[2]), n);
+					float length = std::sqrt(dot(n, n));
+					if (length > 0)
+					{
+						n[0] /= length; n[1] /= length; n[2] /= length;
+					}
+					quadric_plane(triangle_quadrics[t], n, -dot(n, this->pos(tri[0])), length / 2);
+				}
+			});
+		std::memset(this->quadrics.data(), 0, nV * sizeof(Quadric));
+		for (unsigned int t = 0 ; t < nT ; t++)
+			for (unsigned int k = 0 ; k < 3 ; k++)
+				quadric_add(this->quadrics[this->position[this->indices[t*3+k]]], triangle_quadrics[t]);
+
+		// planes through borders and seams, perpendicular to their triangle, to keep
+		// them in place
+		this->classify();
+		for (const Edge& edge : this->edges)
+		{
+			if (edge.kind != BORDER_EDGE && edge.kind != SEAM_EDGE) continue;
+			const unsigned int* tri = this->indices.data() + edge.triangle*3;
+			float n[3];
+			triangle_normal(this->pos(tri[0]), this->pos(tri[1]), this->pos(tri[2]), n);
+			const float* a = this->pos(edge.p0);
+			const float* b = this->pos(edge.p1);
+			float e[3] = {b[0]-a[0], b[1]-a[1], b[2]-a[2]};
+			float m[3];
+			cross(e, n, m);
+			float length = std::sqrt(dot(m, m));
+			if (length == 0) continue;
+			m[0] /= length; m[1] /= length; m[2] /= length;
+
+			Quadric q;
+			quadric_plane(q, m, -dot(m, a), BORDER_WEIGHT * dot(e, e));
+			quadric_add(this->quadrics[edge.p0], q);
+			quadric_add(this->quadrics[edge.p1], q);
+		}
+	}
+
+	void Simplifier::classify(void)
+	{
+		const unsigned int nT = this->getNTriangles();
+		const unsigned int* idx = this->indices.data();
+
+		std::vector<HalfEdge> half_edges(nT * 3);
+		JobSystem::shared().parallelFor(0, nT, MeshSimplifier::PARALLEL_GRAIN,
+			[&](unsigned int begin, unsigned int end)
+			{
+				for (unsigned int t = begin ; t < end ; t++)
+					for (unsigned int k = 0 ; k < 3 ; k++)
+					{
+						std::uint64_t a = this->position[idx[t*3 + k]];
+						std::uint64_t b = this->position[idx[t*3 + (k+1)%3]];
+						HalfEdge& h = half_edges[t*3 + k];
+						h.key = a < b ? (a << 32 | b) : (b << 32 | a);
+						h.triangle = t;
+						h.corner = k;
+					}
+			});
+		std::sort(half_edges.begin(), half_edges.end(),
+				[](const HalfEdge& x, const HalfEdge& y) { return x.key < y.key; });
+
+		std::vector<unsigned char> border_count(this->nVertices, 0);
+		std::vector<unsigned char> seam_count(this->nVertices, 0);
+		std::fill(this->kinds.begin(), this->kinds.end(), (unsigned char)MANIFOLD);
+		this->edges.clear();
+
+		for (std::size_t i = 0 ; i < half_edges.size() ; )
+		{
+			std::size_t j = i + 1;
+			while (j < half_edges.size() && half_edges[j].key == half_edges[i].key) j++;
+
+			Edge edge;
+			edge.p0 = (unsigned int)(half_edges[i].key >> 32);
+			edge.p1 = (unsigned int)(half_edges[i].key & 0xffffffffu);
+			edge.triangle = half_edges[i].triangle;
+			if (j - i == 1)
+				edge.kind = BORDER_EDGE;
+			else if (j - i == 2)
+			{
+				// the vertices of both triangles, from p0 to p1
+				unsigned int v[2][2];
+				for (unsigned int h = 0 ; h < 2 ; h++)
+				{
+					const HalfEdge& half = half_edges[i + h];
+					unsigned int a = idx[half.triangle*3 + half.corner];
+					unsigned int b = idx[half.triangle*3 + (half.corner+1)%3];
+					bool forward = this->position[a] == edge.p0;
+					v[h][0] = forward ? a : b;
+					v[h][1] = forward ? b : a;
+				}
+				bool opposite = (this->position[idx[half_edges[i].triangle*3 + half_edges[i].corner]]
+						!= this->position[idx[half_edges[i+1].triangle*3 + half_edges[i+1].corner]]);
+				if (!opposite)
+					edge.kind = NON_MANIFOLD; // inconsistent winding
+				else if (v[0][0] != v[1][0] || v[0][1] != v[1][1])
+					edge.kind = SEAM_EDGE;
+				else
+					edge.kind = INTERIOR;
+			}
+			else
+				edge.kind = NON_MANIFOLD;
+
+			switch (edge.kind)
+			{
+				case BORDER_EDGE:
+					border_count[edge.p0]++; border_count[edge.p1]++;
+					break;
+				case SEAM_EDGE:
+					seam_count[edge.p0]++; seam_count[edge.p1]++;
+					break;
+				case NON_MANIFOLD:
+					this->kinds[edge.p0] = this->kinds[edge.p1] = LOCKED;
+					break;
+				default:
+					break;
+			}
+			// saturate, the exact counts past 2 don't matter
+			if (border_count[edge.p0] > 3) border_count[edge.p0] = 3;
+			if (border_count[edge.p1] > 3) border_count[edge.p1] = 3;
+			if (seam_count[edge.p0] > 3) seam_count[edge.p0] = 3;
+			if (seam_count[edge.p1] > 3) seam_count[edge.p1] = 3;
+
+			this->edges.push_back(edge);
+			i = j;
+		}
+
+		// vertices in the middle of a single border or seam may slide along it,
+		// corners stay
+		for (unsigned int p = 0 ; p < this->nVertices ; p++)
+		{
+			if (this->position[p] != p || this->kinds[p] == LOCKED) continue;
+			if (border_count[p] > 0)
+				this->kinds[p] = (border_count[p] == 2 && seam_count[p] == 0) ? BORDER : LOCKED;
+			else if (seam_count[p] > 0)
+				this->kinds[p] = seam_count[p] == 2 ? SEAM : LOCKED;
+		}
+	}
+
+	bool Simplifier::can_move(unsigned int p, EdgeKind kind) const
+	{
+		switch (this->kinds[p])
+		{
+			case MANIFOLD: return kind == INTERIOR;
+			case BORDER: return kind == BORDER_EDGE;
+			case SEAM: return kind == SEAM_EDGE;
+			default: return false;
+		}
+	}
+
+	bool Simplifier::pass(unsigned int target_triangles, float error_limit)
+	{
+		this->classify();
+		const unsigned int nT = this->getNTriangles();
+		unsigned int* idx = this->indices.data();
+
+		// the cheapest collapse of each edge, if any
+		const unsigned int nE = (unsigned int)this->edges.size();
+		const unsigned int NONE = ~0u;
+		std::vector<Collapse> collapses(nE);
+		JobSystem::shared().parallelFor(0, nE, MeshSimplifier::PARALLEL_GRAIN,
+			[&](unsigned int begin, unsigned int end)
+			{
+				for (unsigned int e = begin ; e < end ; e++)
+				{
+					const Edge& edge = this->edges[e];
+					Collapse& collapse = collapses[e];
+					collapse.from = NONE;
+					if (edge.kind == NON_MANIFOLD) continue;
+
+					Quadric q = this->quadrics[edge.p0];
+					quadric_add(q, this->quadrics[edge.p1]);
+					if (this->can_move(edge.p0, edge.kind))
+					{
+						collapse.from = edge.p0;
+						collapse.to = edge.p1;
+						collapse.cost = quadric_error(q, this->pos(edge.p1));
+					}
+					if (this->can_move(edge.p1, edge.kind))
+					{
+						float cost = quadric_error(q, this->pos(edge.p0));
+						if (collapse.from == NONE || cost < collapse.cost)
+						{
+							collapse.from = edge.p1;
+							collapse.to = edge.p0;
+							collapse.cost = cost;
+						}
+					}
+				}
+			});
+
+		std::vector<unsigned int> order;
+		order.reserve(nE);
+		for (unsigned int e = 0 ; e < nE ; e++)
+			if (collapses[e].from != NONE) order.push_back(e);
+		std::sort(order.begin(), order.end(),
+				[&](unsigned int a, unsigned int b) { return collapses[a].cost < collapses[b].cost; });
+
+		// triangles around each position
+		std::vector<unsigned int> offsets(this->nVertices + 1, 0);
+		for (unsigned int i = 0 ; i < nT*3 ; i++)
+			offsets[this->position[idx[i]] + 1]++;
+		for (unsigned int p = 0 ; p < this->nVertices ; p++)
+			offsets[p+1] += offsets[p];
+		std::vector<unsigned int> adjacency(nT * 3);
+		{
+			std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+			for (unsigned int i = 0 ; i < nT*3 ; i++)
+				adjacency[fill[this->position[idx[i]]]++] = i / 3;
+		}
+
+		std::vector<bool> dead(nT, false);
+		std::vector<bool> touched(this->nVertices, false);
+		std::vector<std::pair<unsigned int, unsigned int>> remap; // vertex of from -> of to
+		unsigned int live = nT, n_collapses = 0;
+
+		for (unsigned int e : order)
+		{
+			if (live <= target_triangles) break;
+			const Collapse& collapse = collapses[e];
+			float collapse_error = std::sqrt(collapse.cost) * this->scale;
+			if (collapse_error > error_limit) break;
+
+			// one collapse per vertex per pass, since the costs are not updated
+			if (touched[collapse.from] || touched[collapse.to]) continue;
+
+			// the triangles of the edge tell which vertex of \b to each vertex of
+			// \b from becomes, on each side of a seam
+			remap.clear();
+			bool valid = true;
+			for (unsigned int i = offsets[collapse.from] ; valid && i < offsets[collapse.from+1] ; i++)
+			{
+				unsigned int t = adjacency[i];
+				if (dead[t]) continue;
+				unsigned int* tri = idx + t*3;
+				int k_from = -1, k_to = -1;
+				for (int k = 0 ; k < 3 ; k++)
+				{
+					if (this->position[tri[k]] == collapse.from) k_from = k;
+					else if (this->position[tri[k]] == collapse.to) k_to = k;
+				}
+				if (k_to < 0) continue;
+
+				bool known = false;
+				for (const auto& pair : remap)
+				{
+					if (pair.first == tri[k_from])
+					{
+						known = true;
+						valid = pair.second == tri[k_to];
+					}
+				}
+				if (!known) remap.push_back(std::make_pair(tri[k_from], tri[k_to]));
+			}
+
+			// the other triangles must all have a vertex to go to and stay
+			// facing the same way
+			for (unsigned int i = offsets[collapse.from] ; valid && i < offsets[collapse.from+1] ; i++)
+			{
+				unsigned int t = adjacency[i];
+				if (dead[t]) continue;
+				const unsigned int* tri = idx + t*3;
+				int k_from = -1;
+				bool has_to = false;
+				for (int k = 0 ; k < 3 ; k++)
+				{
+					if (this->position[tri[k]] == collapse.from) k_from = k;
+					else if (this->position[tri[k]] == collapse.to) has_to = true;
+				}
+				if (has_to) continue;
+
+				bool mapped = false;
+				for (const auto& pair : remap)
+					if (pair.first == tri[k_from]) mapped = true;
+				if (!mapped) { valid = false; break; }
+
+				const float* a = this->pos(tri[(k_from+1)%3]);
+				const float* b = this->pos(tri[(k_from+2)%3]);
+				float before[3], after[3];
+				triangle_normal(this->pos(tri[k_from]), a, b, before);
+				triangle_normal(this->pos(collapse.to), a, b, after);
+				if (dot(before, after) <= MIN_NORMAL_COSINE
+						* std::sqrt(dot(before, before) * dot(after, after)))
+					valid = false;
+			}
+			if (!valid) continue;
+
+			for (unsigned int i = offsets[collapse.from] ; i < offsets[collapse.from+1] ; i++)
+			{
+				unsigned int t = adjacency[i];
+				if (dead[t]) continue;
+				unsigned int* tri = idx + t*3;
+				bool has_to = false;
+				for (int k = 0 ; k < 3 ; k++)
+					if (this->position[tri[k]] == collapse.to) has_to = true;
+				if (has_to)
+				{
+					dead[t] = true;
+					live--;
+					continue;
+				}
+				for (int k = 0 ; k < 3 ; k++)
+					for (const auto& pair : remap)
+						if (tri[k] == pair.first) { tri[k] = pair.second; break; }
+			}
+
+			quadric_add(this->quadrics[collapse.to], this->quadrics[collapse.from]);
+			touched[collapse.from] = touched[collapse.to] = true;
+			if (collapse_error > this->error) this->error = collapse_error;
+			n_collapses++;
+		}
+
+		unsigned int out = 0;
+		for (unsigned int t = 0 ; t < nT ; t++)
+		{
+			if (dead[t]) continue;
+			if (out != t)
+				std::memcpy(idx + out*3, idx + t*3, 3 * sizeof(unsigned int));
+			out++;
+		}
+		this->indices.resize(out * 3);
+
+		return n_collapses > 0;
+	}
+
+	bool Simplifier::reduce(unsigned int target_triangles, float error_limit)
+	{
+		unsigned int start = this->getNTriangles();
+		while (this->getNTriangles() > target_triangles
+				&& this->pass(target_triangles, error_limit))
+			;
+		return this->getNTriangles() < start;
+	}
+
+	Model Simplifier::extract(const Material& material) const
+	{
+		// the vertices left, in order of first use
+		const unsigned int UNUSED = ~0u;
+		std::vector<unsigned int> remap(this->nVertices, UNUSED);
+		std::vector<unsigned int> used;
+		for (unsigned int v : this->indices)
+		{
+			if (remap[v] == UNUSED)
+			{
+				remap[v] = (unsigned int)used.size();
+				used.push_back(v);
+			}
+		}
+
+		const unsigned int nV = (unsigned int)used.size();
+		const unsigned int nT = this->getNTriangles();
+		const VertexLayout& layout = this->mesh.getLayout();
+		ModelBuilder builder(nV, nT, layout);
+		for (unsigned int a = 0 ; a < VertexLayout::ATTRIBUTE_COUNT ; a++)
+		{
+			VertexLayout::Attribute attribute = (VertexLayout::Attribute)a;
+			if (!layout.has(attribute)) continue;
+			unsigned int n = VertexLayout::components(attribute);
+			const float* src = mesh_attribute(this->mesh, attribute);
+			float* dst = builder_attribute(builder, attribute);
+			for (unsigned int v = 0 ; v < nV ; v++)
+				std::memcpy(dst + v*n, src + used[v]*n, n * sizeof(float));
+		}
+		unsigned int* dst = builder.getIndexArray();
+		for (unsigned int i = 0 ; i < nT*3 ; i++)
+			dst[i] = remap[this->indices[i]];
+
+		return builder.build(material);
+	}
+};
+
+Model MeshSimplifier::simplify(const Model& model, unsigned int target_triangles,
+		float target_error, float* p_error)
+{
+	if (p_error != nullptr) *p_error = 0.0f;
+	const MeshData* p_mesh = model.getMesh().get();
+	if (p_mesh == nullptr || p_mesh->getNTriangles() <= target_triangles)
+		return model;
+
+	TraceRecorder::Scope trace("simplify", "assets");
+	Simplifier simplifier(*p_mesh);
+	if (!simplifier.reduce(target_triangles, target_error))
+		return model;
+
+	MeshSimplifier_D( "SIMPLIFY: " << p_mesh->getNTriangles() << " -> "
+			<< simplifier.getNTriangles() << " triangles, error "
+			<< simplifier.getError() << std::endl );
+	if (p_error != nullptr) *p_error = simplifier.getError();
+	return simplifier.extract(model.getMaterial());
+}
+
+std::vector<Model> MeshSimplifier::simplifyChain(const Model& model, unsigned int levels,
+		float ratio, float target_error, std::vector<float>* p_errors)
+{
+	std::vector<Model> chain(1, model);
+	if (p_errors != nullptr) p_errors->assign(1, 0.0f);
+
+	const MeshData* p_mesh = model.getMesh().get();
+	if (p_mesh == nullptr || !(ratio > 0.0f && ratio < 1.0f))
+		return chain;
+
+	TraceRecorder::Scope trace("simplify", "assets");
+	Simplifier simplifier(*p_mesh);
+	float target = (float)p_mesh->getNTriangles();
+	for (unsigned int level = 0 ; level < levels ; level++)
+	{
+		target *= ratio;
+		if (!simplifier.reduce((unsigned int)target, target_error))
+			break;
+
+		MeshSimplifier_D( "SIMPLIFY: level " << level+1 << ", "
+				<< simplifier.getNTriangles() << " triangles, error "
+				<< simplifier.getError() << std::endl );
+		chain.push_back(simplifier.extract(model.getMaterial()));
+		if (p_errors != nullptr) p_errors->push_back(simplifier.getError());
+	}
+	return chain;
+}
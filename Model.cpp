@@ -24,130 +24,94 @@
  */
 #include "Model.h"
 
-#include <GL/glew.h>
-#include <GL/gl.h>
-#include <cstring>
-
 using namespace giselle;
 using namespace giselle::model;
 
 Model::Model()
-:	nVertices(0)
-,	nTriangles(0)
-,	vertex_arr(nullptr)
-,	vertex_normal_arr(nullptr)
-,	index_arr(nullptr)
 {}
 
 Model::Model( unsigned int nVertices, unsigned int nTriangles, float* vertex_array,
 		float* vertex_normal_array, unsigned int* index_array, const Material& material)
-:	nVertices(0)
-,	nTriangles(0)
-,	vertex_arr(nullptr)
-,	vertex_normal_arr(nullptr)
-,	index_arr(nullptr)
-,	material(material)
+:	material(material)
 {
 	if ((vertex_array != nullptr
 		&& vertex_normal_array != nullptr
 		&& index_array != nullptr) && nVertices >= 3 && nTriangles >= 1)
 	{
-		this->nVertices = nVertices;
-		this->nTriangles = nTriangles;
-
-		this->vertex_arr = new float[this->nVertices*3];
-		memcpy(this->vertex_arr, vertex_array, this->nVertices*3*sizeof(float));
-
-		this->vertex_normal_arr = new float[this->nVertices*3];
-		memcpy(this->vertex_normal_arr, vertex_normal_array, this->nVertices*3*sizeof(float));
-
-		this->index_arr = new unsigned int[this->nTriangles*3];
-		memcpy(this->index_arr, index_array, this->nTriangles*3*sizeof(unsigned int));
+		this->p_mesh = std::shared_ptr<const MeshData>(new MeshData(nVertices, nTriangles,
+				vertex_array, vertex_normal_array, index_array));
 	}
 }
 
-Model::~Model()
-{
-	if (this->vertex_arr != nullptr)
-	{ delete[] this->vertex_arr; this->vertex_arr = nullptr; }
-
-	if (this->vertex_normal_arr != nullptr)
-	{ delete[] this->vertex_normal_arr; this->vertex_normal_arr = nullptr; }
+Model::Model(const std::shared_ptr<const MeshData>& mesh, const Material& material)
+:	p_mesh(mesh)
+,	material(material)
+{}
 
-	if (this->index_arr != nullptr)
-	{ delete[] this->index_arr; this->index_arr = nullptr; }
-}
+Model::~Model()
+{}
 
 Model::Model(const Model& other)
-:	nVertices(other.nVertices)
-,	nTriangles(other.nTriangles)
-,	vertex_arr(nullptr)
-,	vertex_normal_arr(nullptr)
-,	index_arr(nullptr)
+:	p_mesh(other.p_mesh)
 ,	material(other.material)
-{
-	if (other.vertex_arr != nullptr)
-	{
-		this->vertex_arr = new float[nVertices*3];
-		memcpy(this->vertex_arr,
-				other.vertex_arr, nVertices*3*sizeof(float));
-	}
+{}
 
-	if (other.vertex_normal_arr != nullptr)
-	{
-		this->vertex_normal_arr = new float[nVertices*3];
-		memcpy(this->vertex_normal_arr,
-				other.vertex_normal_arr, nVertices*3*sizeof(float));
-	}
+Model::Model(Model&& other)
+:	p_mesh(std::move(other.p_mesh))
+,	material(other.material)
+{}
 
-	if (other.index_arr != nullptr)
-	{
-		this->index_arr = new unsigned int[nTriangles*3];
-		memcpy(this->index_arr,
-				other.index_arr, nTriangles*3*sizeof(unsigned int));
-	}
+Model& Model::operator=(const Model& other)
+{
+	this->p_mesh = other.p_mesh;
+	this->material = other.material;
+	return *this;
 }
 
-Model::Model(Model&& other)
-:	nVertices(other.nVertices)
-,	nTriangles(other.nTriangles)
-,	vertex_arr(other.vertex_arr)
-,	vertex_normal_arr(other.vertex_normal_arr)
-,	index_arr(other.index_arr)
-,	material(other.material)
+Model& Model::operator=(Model&& other)
 {
-	other.vertex_arr = other.vertex_normal_arr = nullptr;
-	other.index_arr = nullptr;
+	this->p_mesh = std::move(other.p_mesh);
+	this->material = other.material;
+	return *this;
 }
 
+const std::shared_ptr<const MeshData>& Model::getMesh(void) const
+{ return this->p_mesh; }
+
 unsigned int Model::getNVertices(void) const
-{ return this->nVertices; }
+{ return this->p_mesh ? this->p_mesh->getNVertices() : 0; }
 
 unsigned int Model::getNTriangles(void) const
-{ return this->nTriangles; }
+{ return this->p_mesh ? this->p_mesh->getNTriangles() : 0; }
 
 const float* Model::getVertexArray(void) const
-{ return this->vertex_arr; }
+{ return this->p_mesh ? this->p_mesh->getVertexArray() : nullptr; }
 
 const float* Model::getVertexNormalArray(void) const
-{ return this->vertex_normal_arr; }
+{ return this->p_mesh ? this->p_mesh->getVertexNormalArray() : nullptr; }
 
 const unsigned int* Model::getIndexArray(void) const
-{ return this->index_arr; }
+{ return this->p_mesh ? this->p_mesh->getIndexArray() : nullptr; }
 
 bool Model::isConsistent(void) const
 {
-	if (this->vertex_arr == nullptr ||
-		this->vertex_normal_arr == nullptr ||
-		this->index_arr == nullptr)
-		return false;
+	if (!this->p_mesh) return false;
 
-	for (unsigned int i = 0 ; i < this->nTriangles*3 ; i++)
-		if (this->index_arr[i] >= nVertices) return false;
+	const unsigned int* index_arr = this->p_mesh->getIndexArray();
+	const unsigned int nVertices = this->p_mesh->getNVertices();
+	for (unsigned int i = 0 ; i < this->p_mesh->getNTriangles()*3 ; i++)
+		if (index_arr[i] >= nVertices) return false;
 
 	return true;
 }
 
+bool Model::getBounds(math::Vector4f& min, math::Vector4f& max) const
+{
+	if (!this->p_mesh) return false;
+	this->p_mesh->getBounds(min, max);
+	return true;
+}
+
 const Material& Model::getMaterial(void) const
 {
 	return this->material;
@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "ModelBuilder.h"
+#include "MeshOptimizer.h"
+
+using namespace giselle;
+using namespace giselle::model;
+
+ModelBuilder::ModelBuilder(void)
+:	nVertices(0)
+,	nTriangles(0)
+,	vertex_arr(nullptr)
+,	index_arr(nullptr)
+,	has_bounds(false)
+,	optimize(MeshOptimizer::isAutomatic())
+{}
+
+ModelBuilder::ModelBuilder(unsigned int nVertices, unsigned int nTriangles,
+		const VertexLayout& layout)
+:	nVertices(0)
+,	nTriangles(0)
+,	vertex_arr(nullptr)
+,	index_arr(nullptr)
+,	has_bounds(false)
+,	optimize(MeshOptimizer::isAutomatic())
+{
+	this->reserve(nVertices, nTriangles, layout);
+}
+
+ModelBuilder::~ModelBuilder(void)
+{
+	this->release();
+}
+
+ModelBuilder::ModelBuilder(ModelBuilder&& other)
+:	nVertices(other.nVertices)
+,	nTriangles(other.nTriangles)
+,	layout(other.layout)
+,	vertex_arr(other.vertex_arr)
+,	index_arr(other.index_arr)
+,	has_bounds(other.has_bounds)
+,	bounds_min(other.bounds_min)
+,	bounds_max(other.bounds_max)
+,	optimize(other.optimize)
+{
+	other.vertex_arr = nullptr;
+	other.index_arr = nullptr;
+	other.nVertices = other.nTriangles = 0;
+	other.has_bounds = false;
+}
+
+void ModelBuilder::reserve(unsigned int nVertices, unsigned int nTriangles,
+		const VertexLayout& layout)
+{
+	this->release();
+	this->nVertices = nVertices;
+	this->nTriangles = nTriangles;
+	this->layout = layout;
+	if (nVertices > 0)
+		this->vertex_arr = new float[layout.planarFloat().size(nVertices) / sizeof(float)];
+	if (nTriangles > 0)
+		this->index_arr = new unsigned int[nTriangles*3];
+}
+
+unsigned int ModelBuilder::getNVertices(void) const
+{ return this->nVertices; }
+
+unsigned int ModelBuilder::getNTriangles(void) const
+{ return this->nTriangles; }
+
+const VertexLayout& ModelBuilder::getLayout(void) const
+{ return this->layout; }
+
+float* ModelBuilder::getVertexArray(void)
+{ return this->vertex_arr; }
+
+float* ModelBuilder::getVertexNormalArray(void)
+{ return this->attribute(VertexLayout::NORMAL); }
+
+float* ModelBuilder::getTexCoordArray(void)
+{ return this->attribute(VertexLayout::TEXCOORD); }
+
+float* ModelBuilder::getColorArray(void)
+{ return this->attribute(VertexLayout::COLOR); }
+
+unsigned int* ModelBuilder::getIndexArray(void)
+{ return this->index_arr; }
+
+void ModelBuilder::setBounds(const math::Vector4f& min, const math::Vector4f& max)
+{
+	this->has_bounds = true;
+	this->bounds_min = min;
+	this->bounds_max = max;
+}
+
+void ModelBuilder::setOptimize(bool optimize)
+{ this->optimize = optimize; }
+
+bool ModelBuilder::getOptimize(void) const
+{ return this->optimize; }
+
+Model ModelBuilder::build(const Material& material)
+{
+	return Model(this->buildMesh(), material);
+}
+
+std::shared_ptr<const MeshData> ModelBuilder::buildMesh(void)
+{
+	std::shared_ptr<const MeshData> mesh;
+
+	// same requirements as Model's constructor
+	if (this->nVertices >= 3 && this->nTriangles >= 1)
+	{
+		if (this->optimize)
+			MeshOptimizer::optimize(*this);
+
+		MeshData* p = new MeshData();
+		p->nVertices = this->nVertices;
+		p->nTriangles = this->nTriangles;
+		p->layout = this->layout;
+		p->vertex_arr = this->vertex_arr;
+		p->index_arr = this->index_arr;
+		this->vertex_arr = nullptr;
+		this->index_arr = nullptr;
+
+		if (this->has_bounds)
+		{
+			p->bounds_min = this->bounds_min;
+			p->bounds_max = this->bounds_max;
+		}
+		else
+			p->calcBounds();
+		mesh = std::shared_ptr<const MeshData>(p);
+	}
+
+	this->release();
+	return mesh;
+}
+
+float* ModelBuilder::attribute(VertexLayout::Attribute attribute)
+{
+	if (this->vertex_arr == nullptr || !this->layout.has(attribute)) return nullptr;
+	return this->vertex_arr
+			+ this->layout.planarFloat().offset(attribute, this->nVertices) / sizeof(float);
+}
+
+void ModelBuilder::release(void)
+{
+	if (this->vertex_arr != nullptr)
+	{ delete[] this->vertex_arr; this->vertex_arr = nullptr; }
+
+	if (this->index_arr != nullptr)
+	{ delete[] this->index_arr; this->index_arr = nullptr; }
+
+	this->nVertices = this->nTriangles = 0;
+	this->has_bounds = false;
+}
@@ -0,0 +1,284 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "OcclusionCuller.h"
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+using namespace giselle;
+using namespace scene;
+using namespace math;
+
+// entities with bounds in a subtree, leaving out those culled beforehand
+// (by software occlusion) so that no draw is counted twice
+static unsigned int count_draws(const std::vector<RenderItem>& items, unsigned int begin)
+{
+	unsigned int n = 0;
+	for (unsigned int i = begin ; i < items[begin].end ; i++)
+		if (items[i].has_bounds && !items[i].culled) n++;
+	return n;
+}
+
+OcclusionCuller::OcclusionCuller(void)
+:	mode(OcclusionCuller::OFF)
+,	frame(0)
+,	culled_draws(0)
+,	eye()
+,	margin(0.0f)
+{
+}
+
+OcclusionCuller::~OcclusionCuller(void)
+{
+	this->purge(true);
+}
+
+OcclusionCuller::OcclusionCuller(OcclusionCuller&& other)
+:	mode(other.mode)
+,	frame(other.frame)
+,	culled_draws(other.culled_draws)
+,	eye(other.eye)
+,	margin(other.margin)
+,	queries(std::move(other.queries))
+{
+	other.queries.clear();
+	other.to_test.clear();
+}
+
+OcclusionCuller& OcclusionCuller::operator=(OcclusionCuller&& other)
+{
+	if (this == &other) return *this;
+	this->purge(true);
+	this->mode = other.mode;
+	this->frame = other.frame;
+	this->culled_draws = other.culled_draws;
+	this->eye = other.eye;
+	this->margin = other.margin;
+	this->queries = std::move(other.queries);
+	other.queries.clear();
+	other.to_test.clear();
+	return *this;
+}
+
+void OcclusionCuller::setMode(Mode mode)
+{
+	if (mode == this->mode) return;
+	this->purge(true);
+	this->mode = mode;
+	this->culled_draws = 0;
+}
+
+OcclusionCuller::Mode OcclusionCuller::getMode(void) const
+{
+	return this->mode;
+}
+
+unsigned int OcclusionCuller::getCulledDraws(void) const
+{
+	return this->culled_draws;
+}
+
+void OcclusionCuller::select(std::vector<RenderItem>& items, const Vector4f& eye, float margin)
+{
+	this->to_test.clear();
+	if (this->mode == OcclusionCuller::OFF) return;
+
+	this->frame++;
+	this->eye = eye;
+	this->margin = margin;
+	if (this->frame % MAX_AGE == 0)
+		this->purge(false);
+
+	if (this->mode == OcclusionCuller::CONDITIONAL)
+	{
+		// results only feed the statistics, the GPU does the culling
+		unsigned int culled = 0;
+		for (const RenderItem& item : items)
+		{
+			if (item.parent != 0 || !item.has_sub_bounds) continue;
+			Query& q = this->query(item.p_ent);
+			this->collect(q);
+			if (!q.visible) culled += q.draws;
+		}
+		this->culled_draws = culled;
+		return;
+	}
+
+	this->culled_draws = 0;
+	unsigned int i = 0;
+	while (i < items.size())
+	{
+		RenderItem& item = items[i];
+		if (!item.has_sub_bounds)
+		{
+			i++;
+			continue;
+		}
+
+		Query& q = this->query(item.p_ent);
+		this->collect(q);
+
+		// a subtree not reached in the last frame has no recent result
+		const bool known = (q.last_frame + 1 == this->frame);
+		q.last_frame = this->frame;
+		this->to_test.push_back(std::make_pair(i, &q));
+
+		if (known && !q.visible && !this->containsEye(item))
+		{
+			// hidden: skip the whole subtree, only its root box is tested again
+			this->culled_draws += count_draws(items, i);
+			for (unsigned int j = i ; j < item.end ; j++)
+				items[j].culled = true;
+			i = item.end;
+		}
+		else
+			i++;
+	}
+}
+
+void OcclusionCuller::issueQueries(Renderer& renderer, const std::vector<RenderItem>& items)
+{
+	if (this->mode != OcclusionCuller::DEFERRED || this->to_test.empty()) return;
+
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glDepthMask(GL_FALSE);
+	// the depth buffer holds the subtrees themselves now: a box face lying on
+	// the surface it bounds must pass
+	GLint depth_func = GL_LESS;
+	glGetIntegerv(GL_DEPTH_FUNC, &depth_func);
+	glDepthFunc(GL_LEQUAL);
+
+	for (auto& t : this->to_test)
+	{
+		Query& q = *t.second;
+		if (q.pending) continue; // still waiting for the last one
+
+		const RenderItem& item = items[t.first];
+		glBeginQuery(GL_ANY_SAMPLES_PASSED, q.id);
+		renderer.drawBounds(item.sub_min, item.sub_max);
+		glEndQuery(GL_ANY_SAMPLES_PASSED);
+		q.pending = true;
+	}
+
+	glDepthFunc(depth_func);
+	glDepthMask(GL_TRUE);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+bool OcclusionCuller::beginGroup(Renderer& renderer, const RenderItem& item,
+								const std::vector<RenderItem>& items,
+								bool test, bool color_writes)
+{
+	if (this->mode != OcclusionCuller::CONDITIONAL
+			|| item.parent != 0 || !item.has_sub_bounds
+			|| this->containsEye(item))
+		return false;
+
+	Query& q = this->query(item.p_ent);
+	if (test)
+	{
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		glDepthMask(GL_FALSE);
+
+		glBeginQuery(GL_ANY_SAMPLES_PASSED, q.id);
+		renderer.drawBounds(item.sub_min, item.sub_max);
+		glEndQuery(GL_ANY_SAMPLES_PASSED);
+		q.pending = true;
+		q.draws = count_draws(items, &item - &items[0]);
+		q.last_frame = this->frame;
+
+		glDepthMask(GL_TRUE);
+		if (color_writes)
+			glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	}
+	else if (q.last_frame != this->frame)
+		return false; // not tested in this frame
+
+	glBeginConditionalRender(q.id, GL_QUERY_NO_WAIT);
+	return true;
+}
+
+bool OcclusionCuller::testsGroup(const RenderItem& item, bool test) const
+{
+	return test && this->mode == OcclusionCuller::CONDITIONAL
+			&& item.parent == 0 && item.has_sub_bounds && !this->containsEye(item);
+}
+
+void OcclusionCuller::endGroup(void)
+{
+	glEndConditionalRender();
+}
+
+OcclusionCuller::Query& OcclusionCuller::query(const Entity* p_ent)
+{
+	Query& q = this->queries[p_ent];
+	if (q.id == 0)
+	{
+		glGenQueries(1, &q.id);
+		q.pending = false;
+		q.visible = true;
+		q.last_frame = 0;
+		q.draws = 0;
+	}
+	return q;
+}
+
+bool OcclusionCuller::collect(Query& q)
+{
+	if (!q.pending) return false;
+
+	GLuint available = 0;
+	glGetQueryObjectuiv(q.id, GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) return false;
+
+	GLuint result = 0;
+	glGetQueryObjectuiv(q.id, GL_QUERY_RESULT, &result);
+	q.visible = (result != 0);
+	q.pending = false;
+	return true;
+}
+
+bool OcclusionCuller::containsEye(const RenderItem& item) const
+{
+	return eye.x() >= item.sub_min.x() - margin && eye.x() <= item.sub_max.x() + margin
+		&& eye.y() >= item.sub_min.y() - margin && eye.y() <= item.sub_max.y() + margin
+		&& eye.z() >= item.sub_min.z() - margin && eye.z() <= item.sub_max.z() + margin;
+}
+
+void OcclusionCuller::purge(bool all)
+{
+	auto it = this->queries.begin();
+	while (it != this->queries.end())
+	{
+		if (all || it->second.last_frame + MAX_AGE < this->frame)
+		{
+			glDeleteQueries(1, &it->second.id);
+			it = this->queries.erase(it);
+		}
+		else
+			++it;
+	}
+	this->to_test.clear();
+}
@@ -0,0 +1,247 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "PerfCounters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+using namespace giselle;
+
+static void clear_counters(PerfCounters::FrameCounters& c, std::uint64_t frame)
+{
+	c.frame = frame;
+	for (unsigned int p = 0 ; p < PerfCounters::PHASE_COUNT ; p++)
+		for (unsigned int e = 0 ; e < PerfCounters::EVENT_COUNT ; e++)
+			c.counts[p][e] = 0;
+	for (unsigned int e = 0 ; e < PerfCounters::EVENT_COUNT ; e++)
+		c.available[e] = false;
+}
+
+#ifdef __linux__
+static const std::uint64_t EVENT_CONFIGS[PerfCounters::EVENT_COUNT] =
+{
+	PERF_COUNT_HW_CPU_CYCLES,
+	PERF_COUNT_HW_INSTRUCTIONS,
+	PERF_COUNT_HW_CACHE_MISSES,
+	PERF_COUNT_HW_BRANCH_MISSES
+};
+
+static int open_event(std::uint64_t config, int group_fd)
+{
+	struct perf_event_attr attr;
+	std::memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = config;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP
+			| PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return (int)syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC);
+}
+#endif
+
+PerfCounters::PerfCounters(void)
+:	n_open(0)
+,	active(-1)
+,	frame(0)
+{
+	for (unsigned int e = 0 ; e < EVENT_COUNT ; e++)
+	{
+		this->fds[e] = -1;
+		this->order[e] = 0;
+		this->start.values[e] = 0;
+	}
+	this->start.time_enabled = this->start.time_running = 0;
+	clear_counters(this->current, 0);
+	clear_counters(this->last, UINT64_MAX);
+}
+
+PerfCounters::~PerfCounters(void)
+{
+	this->close_all();
+}
+
+PerfCounters::PerfCounters(PerfCounters&& other)
+:	n_open(other.n_open)
+,	active(other.active)
+,	frame(other.frame)
+,	start(other.start)
+,	current(other.current)
+,	last(other.last)
+{
+	for (unsigned int e = 0 ; e < EVENT_COUNT ; e++)
+	{
+		this->fds[e] = other.fds[e];
+		this->order[e] = other.order[e];
+		other.fds[e] = -1;
+	}
+	other.n_open = 0;
+	other.active = -1;
+}
+
+PerfCounters& PerfCounters::operator=(PerfCounters&& other)
+{
+	if (this != &other)
+	{
+		this->close_all();
+		for (unsigned int e = 0 ; e < EVENT_COUNT ; e++)
+		{
+			this->fds[e] = other.fds[e];
+			this->order[e] = other.order[e];
+			other.fds[e] = -1;
+		}
+		this->n_open = other.n_open;
+		this->active = other.active;
+		this->frame = other.frame;
+		this->start = other.start;
+		this->current = other.current;
+		this->last = other.last;
+		other.n_open = 0;
+		other.active = -1;
+	}
+	return *this;
+}
+
+bool PerfCounters::setEnabled(bool enabled)
+{
+	if (enabled == this->isEnabled()) return true;
+	this->close_all();
+	this->active = -1;
+	this->frame = 0;
+	clear_counters(this->current, 0);
+	clear_counters(this->last, UINT64_MAX);
+	if (!enabled) return true;
+
+#ifdef __linux__
+	// all events in one group, led by the first one that opens, so that they
+	// are read at once and scheduled together
+	int leader = -1;
+	for (unsigned int e = 0 ; e < EVENT_COUNT ; e++)
+	{
+		int fd = open_event(EVENT_CONFIGS[e], leader);
+		if (fd < 0) continue;
+		if (leader < 0) leader = fd;
+		this->fds[e] = fd;
+		this->order[e] = this->n_open++;
+		this->current.available[e] = true;
+	}
+#endif
+	return this->n_open > 0;
+}
+
+bool PerfCounters::isEnabled(void) const
+{
+	return this->n_open > 0;
+}
+
+bool PerfCounters::isAvailable(Event event) const
+{
+	return this->fds[event] >= 0;
+}
+
+void PerfCounters::begin(Phase phase)
+{
+	if (this->n_open == 0 || this->active >= 0) return;
+	if (this->read(this->start))
+		this->active = phase;
+}
+
+void PerfCounters::end(Phase phase)
+{
+	if (this->active != (int)phase) return;
+	this->active = -1;
+
+	Reading now;
+	if (!this->read(now)) return;
+
+	// scale up the counts when the events had to share the counters
+	const std::uint64_t enabled = now.time_enabled - this->start.time_enabled;
+	const std::uint64_t running = now.time_running - this->start.time_running;
+	const double scale = (running > 0 && running < enabled)
+			? (double)enabled / running : 1.0;
+
+	for (unsigned int e = 0 ; e < EVENT_COUNT ; e++)
+	{
+		if (this->fds[e] < 0) continue;
+		const std::uint64_t delta = now.values[e] - this->start.values[e];
+		this->current.counts[phase][e] += (std::uint64_t)(delta * scale);
+	}
+}
+
+void PerfCounters::endFrame(void)
+{
+	if (this->n_open == 0) return;
+	this->active = -1;
+	this->last = this->current;
+	clear_counters(this->current, ++this->frame);
+	for (unsigned int e = 0 ; e < EVENT_COUNT ; e++)
+		this->current.available[e] = this->fds[e] >= 0;
+}
+
+const PerfCounters::FrameCounters& PerfCounters::getFrameCounters(void) const
+{
+	return this->last;
+}
+
+bool PerfCounters::read(Reading& reading) const
+{
+#ifdef __linux__
+	// nr, time_enabled, time_running, then a value per event of the group
+	std::uint64_t buffer[3 + EVENT_COUNT];
+	int leader = -1;
+	for (unsigned int e = 0 ; e < EVENT_COUNT && leader < 0 ; e++)
+		leader = this->fds[e];
+	if (leader < 0) return false;
+
+	const ssize_t size = (3 + this->n_open) * sizeof(std::uint64_t);
+	if (::read(leader, buffer, size) != size) return false;
+
+	reading.time_enabled = buffer[1];
+	reading.time_running = buffer[2];
+	for (unsigned int e = 0 ; e < EVENT_COUNT ; e++)
+		reading.values[e] = (this->fds[e] >= 0) ? buffer[3 + this->order[e]] : 0;
+	return true;
+#else
+	(void)reading;
+	return false;
+#endif
+}
+
+void PerfCounters::close_all(void)
+{
+#ifdef __linux__
+	// the leader is closed last, it is the first one open
+	for (int e = EVENT_COUNT - 1 ; e >= 0 ; e--)
+		if (this->fds[e] >= 0) close(this->fds[e]);
+#endif
+	for (unsigned int e = 0 ; e < EVENT_COUNT ; e++)
+		this->fds[e] = -1;
+	this->n_open = 0;
+}
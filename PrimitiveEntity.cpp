@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "PrimitiveEntity.h"
+#include "MathUtils.h"
+
+#include <cmath>
+
+using namespace giselle;
+using namespace scene;
+using namespace model;
+using namespace math;
+
+constexpr unsigned int PrimitiveEntity::MIN_SEGMENTS;
+constexpr unsigned int PrimitiveEntity::LEVEL_COUNT;
+constexpr unsigned int PrimitiveEntity::MAX_SEGMENTS;
+constexpr float PrimitiveEntity::DEFAULT_TRIANGLE_PIXELS;
+constexpr float PrimitiveEntity::DEFAULT_HYSTERESIS;
+
+PrimitiveEntity::PrimitiveEntity( const Material& material,
+	const Vector4f& pos, const Vector4f& ang, const std::list<Entity*> & children )
+:	Entity(pos,ang,children)
+,	material(material)
+,	triangle_pixels(DEFAULT_TRIANGLE_PIXELS)
+,	hysteresis(DEFAULT_HYSTERESIS)
+,	current(0)
+{
+}
+
+PrimitiveEntity::~PrimitiveEntity()
+{
+}
+
+PrimitiveEntity::PrimitiveEntity(const PrimitiveEntity& other)
+:	Entity(other)
+,	material(other.material)
+,	triangle_pixels(other.triangle_pixels)
+,	hysteresis(other.hysteresis)
+,	current(other.current)
+{
+	for (unsigned int i = 0 ; i < LEVEL_COUNT ; i++)
+		this->levels[i] = other.levels[i];
+}
+
+Material& PrimitiveEntity::getMaterial(void)
+{
+	return this->material;
+}
+
+void PrimitiveEntity::setMaterial(const Material& material)
+{
+	this->material = material;
+}
+
+void PrimitiveEntity::setTrianglePixels(float pixels)
+{
+	if (pixels > 0.0f)
+		this->triangle_pixels = pixels;
+}
+
+float PrimitiveEntity::getTrianglePixels(void) const
+{
+	return this->triangle_pixels;
+}
+
+void PrimitiveEntity::setHysteresis(float hysteresis)
+{
+	if (hysteresis >= 0.0f && hysteresis < 1.0f)
+		this->hysteresis = hysteresis;
+}
+
+float PrimitiveEntity::getHysteresis(void) const
+{
+	return this->hysteresis;
+}
+
+unsigned int PrimitiveEntity::getCurrentLevel(void) const
+{
+	return this->current;
+}
+
+const Model& PrimitiveEntity::getLevel(unsigned int level) const
+{
+	Model& model = this->levels[level];
+	if (model.getMesh() == nullptr)
+		model = this->generate(segments(level));
+	return model;
+}
+
+unsigned int PrimitiveEntity::segments(unsigned int level)
+{
+	return MIN_SEGMENTS << level;
+}
+
+void PrimitiveEntity::render(Renderer& renderer) const
+{
+	renderer.passMaterial(this->material); // pass this entity's material
+	renderer.drawModel(this->getLevel(this->current)); //draw the model
+}
+
+void PrimitiveEntity::selectDetail(float pixels) const
+{
+	// pixels is the size of the sphere around the entity's box, scale it down to
+	// the round parts of the shape
+	Vector4f min, max;
+	if (!this->getBounds(min, max)) return;
+	float dx = max.x() - min.x(), dy = max.y() - min.y(), dz = max.z() - min.z();
+	float diagonal = std::sqrt(dx*dx + dy*dy + dz*dz);
+	if (diagonal <= 0.0f) return;
+
+	// segments needed to go around the shape in triangle_pixels steps
+	float circumference = (float)PI * pixels * 2.0f * this->curve_radius() / diagonal;
+	float needed = circumference / this->triangle_pixels;
+
+	unsigned int level = this->current;
+	while (level + 1 < LEVEL_COUNT && needed > segments(level) * (1.0f + this->hysteresis))
+		level++;
+	while (level > 0 && needed < segments(level - 1) * (1.0f - this->hysteresis))
+		level--;
+
+	this->getLevel(level);
+	this->current = level;
+}
+
+void PrimitiveEntity::invalidate(void)
+{
+	for (unsigned int i = 0 ; i < LEVEL_COUNT ; i++)
+		this->levels[i] = Model();
+	this->markDirty();
+}
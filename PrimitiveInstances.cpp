@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "PrimitiveInstances.h"
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <algorithm>
+
+using namespace giselle;
+using namespace giselle::model;
+using namespace giselle::math;
+
+constexpr unsigned int PrimitiveInstances::INSTANCE_FLOATS;
+constexpr unsigned int PrimitiveInstances::DEFAULT_SEGMENTS;
+constexpr unsigned int PrimitiveInstances::MAX_SEGMENTS;
+
+PrimitiveInstances::PrimitiveInstances(Shape shape, unsigned int segments)
+:	shape(shape)
+,	segments(DEFAULT_SEGMENTS)
+,	bounds_valid(false)
+,	buffer(0)
+,	texture(0)
+,	uploaded(false)
+{
+	this->setSegments(segments);
+}
+
+PrimitiveInstances::~PrimitiveInstances(void)
+{
+	if (this->texture != 0)
+		glDeleteTextures(1, &this->texture);
+	if (this->buffer != 0)
+		glDeleteBuffers(1, &this->buffer);
+}
+
+PrimitiveInstances::PrimitiveInstances(const PrimitiveInstances& other)
+:	shape(other.shape)
+,	segments(other.segments)
+,	data(other.data)
+,	bounds_valid(other.bounds_valid)
+,	bounds_min(other.bounds_min)
+,	bounds_max(other.bounds_max)
+,	buffer(0)
+,	texture(0)
+,	uploaded(false)
+{
+}
+
+PrimitiveInstances::Shape PrimitiveInstances::getShape(void) const
+{
+	return this->shape;
+}
+
+void PrimitiveInstances::setSegments(unsigned int segments)
+{
+	// spheres need an even number, for their latitude divisions
+	segments = std::min(std::max(segments, 4u), MAX_SEGMENTS);
+	this->segments = (segments + 1) & ~1u;
+}
+
+unsigned int PrimitiveInstances::getSegments(void) const
+{
+	return this->segments;
+}
+
+unsigned int PrimitiveInstances::add(const Vector4f& position, const Vector4f& scale)
+{
+	unsigned int index = this->getCount();
+	this->data.resize(this->data.size() + INSTANCE_FLOATS);
+	this->set(index, position, scale);
+	return index;
+}
+
+void PrimitiveInstances::set(unsigned int index, const Vector4f& position,
+							const Vector4f& scale)
+{
+	float* p = &this->data[index * INSTANCE_FLOATS];
+	p[0] = position.x();
+	p[1] = position.y();
+	p[2] = position.z();
+	p[3] = scale.x();
+	p[4] = scale.y();
+	p[5] = scale.z();
+	this->bounds_valid = false;
+	this->uploaded = false;
+}
+
+void PrimitiveInstances::clear(void)
+{
+	this->data.clear();
+	this->bounds_valid = false;
+	this->uploaded = false;
+}
+
+void PrimitiveInstances::reserve(unsigned int count)
+{
+	this->data.reserve(count * INSTANCE_FLOATS);
+}
+
+unsigned int PrimitiveInstances::getCount(void) const
+{
+	return this->data.size() / INSTANCE_FLOATS;
+}
+
+const float* PrimitiveInstances::getData(void) const
+{
+	return this->data.data();
+}
+
+unsigned int PrimitiveInstances::getVertexCount(void) const
+{
+	return this->getTriangleCount() * 3;
+}
+
+unsigned int PrimitiveInstances::getTriangleCount(void) const
+{
+	const unsigned int s = this->segments;
+	switch (this->shape)
+	{
+		case BOX: return 12;
+		case SPHERE: return s * s; // s/2 rings of s quads
+		default: return s * 4; // s side quads and two fans of s triangles
+	}
+}
+
+bool PrimitiveInstances::getBounds(Vector4f& min, Vector4f& max) const
+{
+	if (this->data.empty()) return false;
+	if (!this->bounds_valid)
+		this->calcBounds();
+	min = this->bounds_min;
+	max = this->bounds_max;
+	return true;
+}
+
+bool PrimitiveInstances::isUploaded(void) const
+{
+	return this->uploaded;
+}
+
+void PrimitiveInstances::calcBounds(void) const
+{
+	float lo[3] = { 0.0f, 0.0f, 0.0f }, hi[3] = { 0.0f, 0.0f, 0.0f };
+	for (unsigned int i = 0 ; i < this->data.size() ; i += INSTANCE_FLOATS)
+	{
+		const float* p = &this->data[i];
+		for (int k = 0 ; k < 3 ; k++)
+		{
+			// cylinders span [0,1] in Y, everything else [-1,1]
+			float a = (this->shape == CYLINDER && k == 1) ? p[k] : p[k] - p[3+k];
+			float b = p[k] + p[3+k];
+			if (i == 0 || a < lo[k]) lo[k] = a;
+			if (i == 0 || b > hi[k]) hi[k] = b;
+		}
+	}
+	this->bounds_min = Vector4f(lo[0], lo[1], lo[2]);
+	this->bounds_max = Vector4f(hi[0], hi[1], hi[2]);
+	this->bounds_valid = true;
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "ProceduralEntity.h"
+
+using namespace giselle;
+using namespace scene;
+using namespace model;
+using namespace math;
+
+ProceduralEntity::ProceduralEntity( PrimitiveInstances::Shape shape, const Material& material,
+	const Vector4f& pos, const Vector4f& ang, const std::list<Entity*> & children )
+:	Entity(pos,ang,children)
+,	instances(shape)
+,	material(material)
+{
+}
+
+ProceduralEntity::~ProceduralEntity()
+{
+}
+
+ProceduralEntity::ProceduralEntity(const ProceduralEntity& other)
+:	Entity(other)
+,	instances(other.instances)
+,	material(other.material)
+{
+}
+
+Material& ProceduralEntity::getMaterial(void)
+{
+	return this->material;
+}
+
+void ProceduralEntity::setMaterial(const Material& material)
+{
+	this->material = material;
+}
+
+const PrimitiveInstances& ProceduralEntity::getInstances(void) const
+{
+	return this->instances;
+}
+
+void ProceduralEntity::setSegments(unsigned int segments)
+{
+	this->instances.setSegments(segments);
+	this->markDirty();
+}
+
+unsigned int ProceduralEntity::add(const Vector4f& position, const Vector4f& scale)
+{
+	this->markDirty();
+	return this->instances.add(position, scale);
+}
+
+void ProceduralEntity::set(unsigned int index, const Vector4f& position, const Vector4f& scale)
+{
+	this->instances.set(index, position, scale);
+	this->markDirty();
+}
+
+void ProceduralEntity::clear(void)
+{
+	this->instances.clear();
+	this->markDirty();
+}
+
+void ProceduralEntity::reserve(unsigned int count)
+{
+	this->instances.reserve(count);
+}
+
+void ProceduralEntity::render(Renderer& renderer) const
+{
+	renderer.passMaterial(this->material); // pass this entity's material
+	renderer.drawInstances(this->instances); // draw all primitives
+}
+
+bool ProceduralEntity::getBounds(Vector4f& min, Vector4f& max) const
+{
+	return this->instances.getBounds(min, max);
+}
@@ -28,15 +28,27 @@
 #include <GL/gl.h>
 
 #include "MathUtils.h"
+#include "GBuffer.h"
+#include "ShadowMaps.h"
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <memory>
 
 #ifdef _GISELLE_DEBUG
 #include <iostream>
+#include "DebugOutput.h"
 static int _err;
 #define RENDERER_DEBUG(x) std::cout << x
+// errors are reported asynchronously when the debug output is enabled
 #define RENDERER_ERROR_CHECK(x) \
-	_err = glGetError(); \
-	if (_err != GL_NO_ERROR) \
-	{ std::cout << "GL Error @ " << x << " - " << _err << std::endl; }
+	if (!DebugOutput::isEnabled()) \
+	{ \
+		_err = glGetError(); \
+		if (_err != GL_NO_ERROR) \
+		{ std::cout << "GL Error @ " << x << " - " << _err << std::endl; } \
+	}
 #else
 #define RENDERER_DEBUG(x)
 #define RENDERER_ERROR_CHECK(x)
@@ -46,8 +58,108 @@ using namespace giselle;
 using namespace math;
 using namespace model;
 
+// deferred shading state, only allocated when used
+struct Renderer::Deferred
+{
+	ShaderProgram gbuffer_prg;
+	ShaderProgram ambient_prg;
+	ShaderProgram volume_prg;
+
+	// materials of the frame, indexed by the G-buffer: an open addressing table of
+	// material to index, emptied every frame without giving back its storage
+	typedef std::pair<const Material*, unsigned int> MaterialEntry;
+	std::vector<MaterialEntry> material_ids;
+	unsigned int n_materials; // entries in use
+	std::vector<float> material_data; // ambient, diffuse, specular + shininess
+	GLuint material_buffer;
+	GLuint material_texture;
+
+	// lights of the full screen pass
+	std::vector<float> global_pos, global_color;
+	std::vector<int> global_index; // scene light to full screen pass light, or -1
+
+	Deferred(void)
+	:	gbuffer_prg(ShaderProgram::DEFAULT_VERTEX_SHADER, ShaderProgram::GBUFFER_FRAGMENT_SHADER)
+	,	ambient_prg(ShaderProgram::SCREEN_VERTEX_SHADER,
+					ShaderProgram::DEFERRED_AMBIENT_FRAGMENT_SHADER)
+	,	volume_prg(ShaderProgram::DEPTH_VERTEX_SHADER,
+					ShaderProgram::DEFERRED_LIGHT_FRAGMENT_SHADER)
+	,	n_materials(0)
+	,	material_buffer(0)
+	,	material_texture(0)
+	{
+		glGenBuffers(1, &this->material_buffer);
+		glBindBuffer(GL_TEXTURE_BUFFER, this->material_buffer);
+		glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+		glGenTextures(1, &this->material_texture);
+		glBindTexture(GL_TEXTURE_BUFFER, this->material_texture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, this->material_buffer);
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	}
+
+	~Deferred(void)
+	{
+		glDeleteTextures(1, &this->material_texture);
+		glDeleteBuffers(1, &this->material_buffer);
+	}
+
+	/** Forget the materials of the previous frame */
+	void clear_materials(void)
+	{
+		std::fill(this->material_ids.begin(), this->material_ids.end(),
+				MaterialEntry(nullptr, NO_MATERIAL));
+		this->n_materials = 0;
+		this->material_data.clear();
+	}
+
+	/** \return the entry of a material, added with \c NO_MATERIAL if new */
+	MaterialEntry& material_entry(const Material* p_mat)
+	{
+		if (2 * (this->n_materials + 1) > this->material_ids.size())
+		{ // grow at half load
+			const std::size_t size = std::max<std::size_t>(64, 2 * this->material_ids.size());
+			std::vector<MaterialEntry> old(size, MaterialEntry(nullptr, NO_MATERIAL));
+			old.swap(this->material_ids);
+			for (const MaterialEntry& e : old)
+				if (e.first != nullptr) this->find_material(e.first) = e;
+		}
+
+		MaterialEntry& e = this->find_material(p_mat);
+		if (e.first == nullptr)
+		{
+			e.first = p_mat;
+			this->n_materials++;
+		}
+		return e;
+	}
+
+	/** \return the entry of a material, or the empty entry where it belongs */
+	MaterialEntry& find_material(const Material* p_mat)
+	{
+		const std::size_t mask = this->material_ids.size() - 1;
+		std::size_t i = (((std::uintptr_t)p_mat >> 4) * 2654435761u) & mask;
+		while (this->material_ids[i].first != nullptr && this->material_ids[i].first != p_mat)
+			i = (i + 1) & mask;
+		return this->material_ids[i];
+	}
+
+	static constexpr unsigned int NO_MATERIAL = ~0u;
+};
+
+constexpr unsigned int Renderer::Deferred::NO_MATERIAL;
+
 Renderer::Renderer()
 :	p_prg(nullptr)
+,	p_depth_prg(nullptr)
+,	p_current(nullptr)
+,	depth_only(false)
+,	light_ubo(0)
+,	p_clustered_prg(nullptr)
+,	clustered(false)
+,	cluster_buffers{0, 0, 0, 0}
+,	cluster_textures{0, 0, 0, 0}
+,	p_deferred(nullptr)
 {
 }
 
@@ -55,19 +167,59 @@ Renderer::~Renderer()
 {
 	if (p_prg)
 		delete p_prg;
+	if (p_depth_prg)
+		delete p_depth_prg;
+	if (light_ubo != 0)
+		glDeleteBuffers(1, &light_ubo);
+	if (p_clustered_prg)
+		delete p_clustered_prg;
+	if (cluster_textures[0] != 0)
+		glDeleteTextures(4, cluster_textures);
+	if (cluster_buffers[0] != 0)
+		glDeleteBuffers(4, cluster_buffers);
+	if (p_deferred)
+		delete p_deferred;
 }
 
 Renderer::Renderer(Renderer&& other)
 :	p_prg(other.p_prg)
+,	p_depth_prg(other.p_depth_prg)
+,	p_current(other.p_current)
+,	depth_only(other.depth_only)
+,	light_ubo(other.light_ubo)
+,	p_clustered_prg(other.p_clustered_prg)
+,	clustered(other.clustered)
+,	p_deferred(other.p_deferred)
+,	stats(other.stats)
 {
+	for (int i = 0 ; i < 4 ; i++)
+	{
+		this->cluster_buffers[i] = other.cluster_buffers[i];
+		this->cluster_textures[i] = other.cluster_textures[i];
+		other.cluster_buffers[i] = other.cluster_textures[i] = 0;
+	}
 	other.p_prg = nullptr;
+	other.p_depth_prg = nullptr;
+	other.light_ubo = 0;
+	other.p_clustered_prg = nullptr;
+	other.p_deferred = nullptr;
+	other.p_current = nullptr;
 }
 
 Renderer& Renderer::operator=(Renderer&& other)
 {
-    if (this == &other) return *this;
-    this->p_prg = other.p_prg;
-	other.p_prg = nullptr;
+	// other gets this renderer's resources, and releases them when destroyed
+	std::swap(this->p_prg, other.p_prg);
+	std::swap(this->p_depth_prg, other.p_depth_prg);
+	std::swap(this->p_current, other.p_current);
+	std::swap(this->depth_only, other.depth_only);
+	std::swap(this->light_ubo, other.light_ubo);
+	std::swap(this->p_clustered_prg, other.p_clustered_prg);
+	std::swap(this->clustered, other.clustered);
+	std::swap(this->cluster_buffers, other.cluster_buffers);
+	std::swap(this->cluster_textures, other.cluster_textures);
+	std::swap(this->p_deferred, other.p_deferred);
+	std::swap(this->stats, other.stats);
 	return *this;
 }
 
@@ -78,55 +230,264 @@ bool Renderer::operator!(void) const
 
 int Renderer::getAttribute(const std::string& att_name) const
 {
-	if (this->p_prg == nullptr) return -1;
+	return this->getAttribute(att_name.c_str());
+}
+
+int Renderer::getAttribute(const char* att_name) const
+{
+	const ShaderProgram* prg = this->current();
+	if (prg == nullptr) return -1;
 
-	return this->p_prg->getAttribute(att_name);
+	return prg->getAttribute(att_name);
 }
 
 int Renderer::getUniform(const std::string& att_name) const
 {
-	if (this->p_prg == nullptr) return -1;
+	return this->getUniform(att_name.c_str());
+}
+
+int Renderer::getUniform(const char* att_name) const
+{
+	const ShaderProgram* prg = this->current();
+	if (prg == nullptr) return -1;
 
-	return this->p_prg->getUniform(att_name);
+	return prg->getUniform(att_name);
 }
 
 bool Renderer::initShaders(void)
 {
-    try {
-        this->p_prg = new ShaderProgram;
-        return true;
-    } catch (ShaderException& e) {
-        RENDERER_ERROR_CHECK("initShaders()");
-        p_prg = nullptr;
-        return false;
-    }
+	// nothing is kept unless both programs build
+	std::unique_ptr<ShaderProgram> prg, depth_prg;
+	try {
+		prg.reset(new ShaderProgram);
+		depth_prg.reset(new ShaderProgram(ShaderProgram::DEPTH_VERTEX_SHADER,
+										ShaderProgram::DEPTH_FRAGMENT_SHADER));
+	} catch (ShaderException& e) {
+		RENDERER_ERROR_CHECK("initShaders()");
+		return false;
+	}
+	this->p_prg = prg.release();
+	this->p_depth_prg = depth_prg.release();
+	this->init_lights();
+	return true;
 }
 
 void Renderer::use(void)
 {
-	if (this->p_prg == nullptr) return;
-	GLint program = this->p_prg->getProgram();
-	glUseProgram(program);
+	const ShaderProgram* prg = this->clustered ? this->p_clustered_prg : this->p_prg;
+	if (prg == nullptr) return;
+	this->use_program(prg);
 	RENDERER_ERROR_CHECK("use()");
 }
 
-void Renderer::passLightProperties( const math::Vector4f& light_pos,
-				const math::Vector4f& light_color)
+void Renderer::use_program(const ShaderProgram* prg)
 {
-	GLint att_light_pos = this->getUniform("light_pos");
-	GLint att_light_color = this->getUniform("light_color");
+	this->p_current = prg;
+	this->depth_only = (prg == this->p_depth_prg);
+	glUseProgram(prg->getProgram());
+	this->stats.program_binds++;
+}
+
+bool Renderer::setClustered(bool enabled)
+{
+	// the clustered program is only built once needed
+	if (enabled && this->p_clustered_prg == nullptr && this->p_prg != nullptr)
+		this->init_clusters();
+	this->clustered = enabled && this->p_clustered_prg != nullptr;
+	return this->clustered == enabled;
+}
+
+void Renderer::useDepthOnly(void)
+{
+	if (this->p_depth_prg == nullptr) return;
+	this->use_program(this->p_depth_prg);
+	RENDERER_ERROR_CHECK("useDepthOnly()");
+}
 
-	glUniform4fv(att_light_pos, 1, light_pos);
-	RENDERER_ERROR_CHECK("passLightProperties():light_pos");
+void Renderer::useGBuffer(void)
+{
+	if (this->p_deferred == nullptr) return;
+	this->p_deferred->clear_materials();
+	this->use_program(&this->p_deferred->gbuffer_prg);
+	RENDERER_ERROR_CHECK("useGBuffer()");
+}
 
-	glUniform3fv(att_light_color, 1, light_color);
-	RENDERER_ERROR_CHECK("passLightProperties():light_color");
+const ShaderProgram* Renderer::current(void) const
+{
+	return this->p_current;
+}
+
+void Renderer::init_lights(void)
+{
+	glGenBuffers(1, &this->light_ubo);
+	glBindBuffer(GL_UNIFORM_BUFFER, this->light_ubo);
+	glBufferData(GL_UNIFORM_BUFFER, MAX_SCENE_LIGHTS * 2 * 4 * sizeof(float),
+				nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	const GLuint program = this->p_prg->getProgram();
+	GLuint block = glGetUniformBlockIndex(program, "Lights");
+	if (block != GL_INVALID_INDEX)
+		glUniformBlockBinding(program, block, LIGHTS_BINDING);
+	glBindBufferBase(GL_UNIFORM_BUFFER, LIGHTS_BINDING, this->light_ubo);
+	RENDERER_ERROR_CHECK("init_lights()");
+}
+
+void Renderer::passLights(const float* light_pos, const float* light_color, unsigned int n)
+{
+	if (this->light_ubo == 0) return;
+	if (n > MAX_SCENE_LIGHTS) n = MAX_SCENE_LIGHTS;
+	if (n == 0) return;
+
+	// std140: vec4 light_pos[MAX_SCENE_LIGHTS], then vec4 light_color[MAX_SCENE_LIGHTS]
+	const GLsizeiptr array_size = MAX_SCENE_LIGHTS * 4 * sizeof(float);
+	glBindBuffer(GL_UNIFORM_BUFFER, this->light_ubo);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, n * 4 * sizeof(float), light_pos);
+	glBufferSubData(GL_UNIFORM_BUFFER, array_size, n * 4 * sizeof(float), light_color);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	this->stats.buffer_binds++;
+	this->stats.bytes_uploaded += 2 * n * 4 * sizeof(float);
+	RENDERER_ERROR_CHECK("passLights()");
+}
+
+static const char* const CLUSTER_SAMPLERS[4] =
+{
+	"light_pos", "light_color", "cluster_grid", "cluster_lights"
+};
+
+bool Renderer::init_clusters(void)
+{
+	try {
+		this->p_clustered_prg = new ShaderProgram(ShaderProgram::DEFAULT_VERTEX_SHADER,
+										ShaderProgram::CLUSTERED_FRAGMENT_SHADER);
+	} catch (ShaderException& e) {
+		RENDERER_ERROR_CHECK("init_clusters()");
+		return false;
+	}
+
+	static const GLenum formats[4] = { GL_RGBA32F, GL_RGBA32F, GL_RG32UI, GL_R32UI };
+	glGenBuffers(4, this->cluster_buffers);
+	glGenTextures(4, this->cluster_textures);
+
+	const GLuint program = this->p_clustered_prg->getProgram();
+	glUseProgram(program);
+	for (int i = 0 ; i < 4 ; i++)
+	{
+		glBindBuffer(GL_TEXTURE_BUFFER, this->cluster_buffers[i]);
+		glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+		glBindTexture(GL_TEXTURE_BUFFER, this->cluster_textures[i]);
+		glTexBuffer(GL_TEXTURE_BUFFER, formats[i], this->cluster_buffers[i]);
+		glUniform1i(glGetUniformLocation(program, CLUSTER_SAMPLERS[i]),
+					CLUSTER_TEXTURE_UNIT + i);
+	}
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	glUseProgram(0);
+	this->p_current = nullptr;
+	RENDERER_ERROR_CHECK("init_clusters()");
+	return true;
+}
+
+void Renderer::passClusters(const ClusteredLighting& clusters,
+						const float* light_pos, const float* light_color, unsigned int n,
+						int x, int y, int w, int h)
+{
+	if (this->p_current == nullptr || this->p_current != this->p_clustered_prg) return;
+
+	const GLsizeiptr sizes[4] =
+	{
+		(GLsizeiptr)(n * 4 * sizeof(float)),
+		(GLsizeiptr)(n * 4 * sizeof(float)),
+		(GLsizeiptr)(clusters.getClusterCount() * 2 * sizeof(unsigned int)),
+		(GLsizeiptr)(clusters.getIndexCount() * sizeof(unsigned int))
+	};
+	const void* data[4] = { light_pos, light_color, clusters.getGrid(), clusters.getIndices() };
+
+	for (int i = 0 ; i < 4 ; i++)
+	{
+		// orphan the previous contents instead of waiting for the GPU
+		glBindBuffer(GL_TEXTURE_BUFFER, this->cluster_buffers[i]);
+		if (sizes[i] > 0)
+			glBufferData(GL_TEXTURE_BUFFER, sizes[i], data[i], GL_STREAM_DRAW);
+		this->stats.buffer_binds++;
+		this->stats.bytes_uploaded += sizes[i];
+		glActiveTexture(GL_TEXTURE0 + CLUSTER_TEXTURE_UNIT + i);
+		glBindTexture(GL_TEXTURE_BUFFER, this->cluster_textures[i]);
+	}
+	glActiveTexture(GL_TEXTURE0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	glUniform1i(this->getUniform("global_lights"), clusters.getGlobalCount());
+	glUniform3i(this->getUniform("cluster_dims"), clusters.getTilesX(),
+				clusters.getTilesY(), clusters.getSlices());
+	glUniform4f(this->getUniform("cluster_screen"), (float)x, (float)y,
+				(float)clusters.getTilesX() / w, (float)clusters.getTilesY() / h);
+	glUniform2f(this->getUniform("cluster_depth"), clusters.getDepthScale(),
+				clusters.getDepthBias());
+	this->stats.uniform_uploads += 4;
+	RENDERER_ERROR_CHECK("passClusters()");
+}
+
+void Renderer::passLightSelection(const int* indices, int n)
+{
+	// only the default program shades a selection of lights
+	if (this->p_current == nullptr || this->p_current != this->p_prg) return;
+
+	GLint att_count = this->getUniform("light_count");
+	GLint att_index = this->getUniform("light_index");
+
+	glUniform1i(att_count, n);
+	if (n > 0)
+		glUniform1iv(att_index, n, indices);
+	this->stats.uniform_uploads += (n > 0) ? 2 : 1;
+	RENDERER_ERROR_CHECK("passLightSelection()");
+}
+
+void Renderer::passShadows(const ShadowMaps* p_shadows, const int* remap)
+{
+	if (this->p_current == nullptr || this->depth_only) return;
+
+	// the samplers always need units of their own, even when unused
+	glUniform1i(this->getUniform("shadow_static"), SHADOW_TEXTURE_UNIT);
+	glUniform1i(this->getUniform("shadow_dynamic"), SHADOW_TEXTURE_UNIT + 1);
+
+	int count = 0;
+	int light[ShadowMaps::MAX_SHADOWS];
+	float mat[ShadowMaps::MAX_SHADOWS * 16];
+	if (p_shadows != nullptr)
+	{
+		for (unsigned int s = 0 ; s < p_shadows->getCount() ; s++)
+		{
+			int l = p_shadows->getLightIndex(s);
+			if (remap != nullptr) l = remap[l];
+			light[count] = l;
+			std::copy((const float*)p_shadows->getMatrix(s),
+					(const float*)p_shadows->getMatrix(s) + 16, &mat[count * 16]);
+			count++;
+		}
+
+		glActiveTexture(GL_TEXTURE0 + SHADOW_TEXTURE_UNIT);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, p_shadows->getStaticTexture());
+		glActiveTexture(GL_TEXTURE0 + SHADOW_TEXTURE_UNIT + 1);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, p_shadows->getDynamicTexture());
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	glUniform1i(this->getUniform("shadow_count"), count);
+	if (count > 0)
+	{
+		glUniform1iv(this->getUniform("shadow_light"), count, light);
+		glUniformMatrix4fv(this->getUniform("shadow_mat"), count, false, mat);
+	}
+	this->stats.uniform_uploads += (count > 0) ? 5 : 3;
+	RENDERER_ERROR_CHECK("passShadows()");
 }
 
 void Renderer::passProjection(const math::Mat4x4f& proj)
 {
 	GLint att_proj = this->getUniform("proj");
 	glUniformMatrix4fv(att_proj, 1, false, proj);
+	this->stats.uniform_uploads++;
 	RENDERER_ERROR_CHECK("passProjection()");
 }
 
@@ -134,6 +495,7 @@ void Renderer::passViewMatrix(const math::Mat4x4f& view)
 {
 	GLint att_view = this->getUniform("view");
 	glUniformMatrix4fv(att_view, 1, false, view);
+	this->stats.uniform_uploads++;
 	RENDERER_ERROR_CHECK("passViewMatrix()");
 }
 
@@ -142,6 +504,7 @@ void Renderer::passModelMatrix(const math::Mat4x4f& model)
 	this->model = model;
 	GLint att_model = this->getUniform("model");
 	glUniformMatrix4fv(att_model, 1, false, model);
+	this->stats.uniform_uploads++;
 	RENDERER_ERROR_CHECK("passModelMatrix()");
 }
 
@@ -149,11 +512,40 @@ void Renderer::passModelView(const math::Mat4x4f& modelView)
 {
 	GLint att_modelView = this->getUniform("modelView");
 	glUniformMatrix4fv(att_modelView, 1, false, modelView);
+	this->stats.uniform_uploads++;
 	RENDERER_ERROR_CHECK("passModelView()");
 }
 
 void Renderer::passMaterial(const Material& mat)
 {
+	if (this->depth_only) return; // no shading in the depth pre-pass
+
+	if (this->p_deferred != nullptr && this->p_current == &this->p_deferred->gbuffer_prg)
+	{ // the G-buffer only keeps an index to the frame's table of materials
+		Deferred& d = *this->p_deferred;
+		float props[12];
+		for (int i = 0 ; i < 4 ; i++)
+		{
+			props[i] = mat.ambient()[i];
+			props[4 + i] = mat.diffuse()[i];
+			props[8 + i] = mat.specular()[i];
+		}
+		props[11] = mat.shininess();
+
+		// a material at a known address may still be a different temporary
+		Deferred::MaterialEntry& entry = d.material_entry(&mat);
+		if (entry.second == Deferred::NO_MATERIAL
+				|| !std::equal(props, props + 12, &d.material_data[entry.second * 12]))
+		{
+			entry.second = d.material_data.size() / 12;
+			d.material_data.insert(d.material_data.end(), props, props + 12);
+		}
+		glUniform1ui(this->getUniform("material_id"), entry.second);
+		this->stats.uniform_uploads++;
+		RENDERER_ERROR_CHECK("passMaterial():material_id");
+		return;
+	}
+
 	GLint att_amb = this->getUniform("ambient_prod");
 	RENDERER_ERROR_CHECK("passMaterial():ambient_prod");
 
@@ -170,6 +562,7 @@ void Renderer::passMaterial(const Material& mat)
 	glUniform4fv(att_diff, 1, mat.diffuse());
 	glUniform4fv(att_spec, 1, mat.specular());
 	glUniform1f(att_shininess, mat.shininess());
+	this->stats.uniform_uploads += 4;
 }
 
 void Renderer::render(const scene::Entity& ent)
@@ -181,42 +574,439 @@ void Renderer::render(const scene::Entity& ent)
 
 	GLint att_model = this->getUniform("model");
 	glUniformMatrix4fv(att_model, 1, false, m);
+	this->stats.uniform_uploads++;
 
 	ent.render(*this);
 	RENDERER_ERROR_CHECK("render()");
 }
 
+// names of the vertex attributes in the shader programs, by VertexLayout::Attribute
+static const char* const ATTRIBUTE_NAMES[VertexLayout::ATTRIBUTE_COUNT] =
+{
+	"pos", "vnorm", "uv", "vcolor"
+};
+
+static GLenum gl_type(VertexLayout::Format format)
+{
+	switch (format)
+	{
+		case VertexLayout::HALF: return GL_HALF_FLOAT;
+		case VertexLayout::SNORM16:
+		case VertexLayout::OCT16: return GL_SHORT;
+		case VertexLayout::UNORM16:
+		case VertexLayout::BOUNDS16: return GL_UNSIGNED_SHORT;
+		case VertexLayout::SNORM8: return GL_BYTE;
+		case VertexLayout::UNORM8: return GL_UNSIGNED_BYTE;
+		case VertexLayout::SNORM10: return GL_INT_2_10_10_10_REV;
+		default: return GL_FLOAT;
+	}
+}
+
+// number of components GL reads for an attribute
+static GLint gl_components(VertexLayout::Format format, VertexLayout::Attribute attribute)
+{
+	switch (format)
+	{
+		case VertexLayout::OCT16: return 2;
+		case VertexLayout::SNORM10: return 4; // packed types are read whole
+		default: return VertexLayout::components(attribute);
+	}
+}
+
 void Renderer::drawModel(const Model& model )
 {
-	GLint attribute_coord3d = this->getAttribute("pos");
-	GLint attribute_normals = this->getAttribute("vnorm");
+	const MeshData* p_mesh = model.getMesh().get();
+	if (p_mesh == nullptr) return;
+
+	// the mesh is uploaded once, and shared by all models using it
+	if (p_mesh->buffers[0] == 0)
+		this->upload_mesh(*p_mesh);
+	glBindBuffer(GL_ARRAY_BUFFER, p_mesh->buffers[0]);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, p_mesh->buffers[1]);
+	this->stats.buffer_binds += 2;
+
+	// feed the attributes of the layout that the program uses; normals are
+	// not available in the depth-only program
+	const VertexLayout& layout = p_mesh->layout;
+	if (layout.isQuantized())
+		this->pass_decoding(p_mesh);
+	GLint locations[VertexLayout::ATTRIBUTE_COUNT];
+	for (unsigned int a = 0 ; a < VertexLayout::ATTRIBUTE_COUNT ; a++)
+	{
+		const VertexLayout::Attribute attr = (VertexLayout::Attribute)a;
+		locations[a] = layout.has(attr) ? this->getAttribute(ATTRIBUTE_NAMES[a]) : -1;
+		if (locations[a] < 0) continue;
+
+		const VertexLayout::Format format = layout.formats[a];
+		glEnableVertexAttribArray( locations[a] );
+		glVertexAttribPointer( locations[a],
+				gl_components(format, attr),       // number of elements per vertex
+				gl_type(format),                   // the type of each element
+				(format == VertexLayout::FLOAT || format == VertexLayout::HALF)
+						? GL_FALSE : GL_TRUE,      // normalize integers
+				layout.stride(attr),               // bytes between vertices
+				(const GLvoid*)layout.offset(attr, p_mesh->nVertices) ); // offset in the buffer
+	}
+
+	glDrawElements( GL_TRIANGLES, p_mesh->nTriangles*3,
+			(p_mesh->index_size == 2) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, (const GLvoid*)0 );
+	this->stats.draw_calls++;
+	this->stats.triangles += p_mesh->nTriangles;
+
+	// other meshes and draws expect plain positions and normals
+	if (layout.isQuantized())
+		this->pass_decoding(nullptr);
+
+	for (unsigned int a = 0 ; a < VertexLayout::ATTRIBUTE_COUNT ; a++)
+		if (locations[a] >= 0)
+			glDisableVertexAttribArray( locations[a] );
+
+	// other draws source client-side arrays
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	RENDERER_ERROR_CHECK("drawModel()");
+}
+
+void Renderer::pass_decoding(const MeshData* p_mesh)
+{
+	const bool positions = p_mesh != nullptr
+			&& p_mesh->layout.formats[VertexLayout::POSITION] == VertexLayout::BOUNDS16;
+	const bool normals = p_mesh != nullptr
+			&& p_mesh->layout.formats[VertexLayout::NORMAL] == VertexLayout::OCT16;
+
+	// BOUNDS16 positions come normalized to [0,1] in the bounds of the mesh
+	float bounds[6] = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+	if (positions)
+		p_mesh->get_bounds(bounds);
+	glUniform3f(this->getUniform("pos_offset"), bounds[0], bounds[1], bounds[2]);
+	glUniform3f(this->getUniform("pos_scale"),
+			bounds[3] - bounds[0], bounds[4] - bounds[1], bounds[5] - bounds[2]);
+	glUniform1i(this->getUniform("oct_normals"), normals ? 1 : 0);
+	this->stats.uniform_uploads += 3;
+}
+
+void Renderer::upload_mesh(const MeshData& mesh)
+{
+	const VertexLayout& layout = mesh.layout;
+	const VertexLayout planar = layout.planarFloat();
+	const GLsizeiptr vertex_size = layout.size(mesh.nVertices);
+	// 16-bit indices whenever they fit
+	mesh.index_size = (mesh.nVertices <= 65536) ? 2 : 4;
+	const GLsizeiptr index_size = mesh.nTriangles * 3 * mesh.index_size;
+
+	glGenBuffers(2, mesh.buffers);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.buffers[0]);
+	if (layout == planar)
+		glBufferData(GL_ARRAY_BUFFER, vertex_size, mesh.vertex_arr, GL_STATIC_DRAW);
+	else
+	{
+		float bounds[6];
+		mesh.get_bounds(bounds);
+		std::vector<unsigned char> data(vertex_size);
+		VertexLayout::convert(planar, mesh.vertex_arr, layout, data.data(), mesh.nVertices, bounds);
+		glBufferData(GL_ARRAY_BUFFER, vertex_size, data.data(), GL_STATIC_DRAW);
+	}
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.buffers[1]);
+	if (mesh.index_size == 4)
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_size, mesh.index_arr, GL_STATIC_DRAW);
+	else
+	{
+		std::vector<GLushort> indices(mesh.index_arr, mesh.index_arr + mesh.nTriangles*3);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_size, indices.data(), GL_STATIC_DRAW);
+	}
+	this->stats.buffer_binds += 2;
+	this->stats.bytes_uploaded += vertex_size + index_size;
+
+	RENDERER_ERROR_CHECK("upload_mesh()");
+}
+
+void Renderer::drawInstances(const PrimitiveInstances& instances)
+{
+	const unsigned int count = instances.getCount();
+	if (count == 0) return;
+
+	if (!instances.uploaded)
+		this->upload_instances(instances);
+	glActiveTexture(GL_TEXTURE0 + PROCEDURAL_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, instances.texture);
+	glActiveTexture(GL_TEXTURE0);
+
+	// the shader only reads gl_VertexID and gl_InstanceID, but compatibility
+	// contexts draw nothing without array 0: feed it a single element, shared
+	// by all instances
+	static const float unused[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, unused);
+	glVertexAttribDivisor(0, count);
+
+	glUniform1i(this->getUniform("proc_instances"), PROCEDURAL_TEXTURE_UNIT);
+	glUniform1i(this->getUniform("proc_shape"), instances.shape);
+	glUniform1i(this->getUniform("proc_segments"), instances.segments);
+	glDrawArraysInstanced(GL_TRIANGLES, 0, instances.getVertexCount(), count);
+	this->stats.draw_calls++;
+	this->stats.triangles += (std::uint64_t)instances.getTriangleCount() * count;
+
+	// other draws read their vertices from arrays
+	glUniform1i(this->getUniform("proc_shape"), 0);
+	this->stats.uniform_uploads += 4;
+	glVertexAttribDivisor(0, 0);
+	glDisableVertexAttribArray(0);
+
+	RENDERER_ERROR_CHECK("drawInstances()");
+}
+
+void Renderer::upload_instances(const PrimitiveInstances& instances)
+{
+	const bool created = instances.buffer != 0;
+	if (!created)
+		glGenBuffers(1, &instances.buffer);
+	const GLsizeiptr size = instances.data.size() * sizeof(float);
+	glBindBuffer(GL_TEXTURE_BUFFER, instances.buffer);
+	glBufferData(GL_TEXTURE_BUFFER, size, instances.data.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	// the buffer must exist before a texture refers to it
+	if (!created)
+	{
+		glGenTextures(1, &instances.texture);
+		glBindTexture(GL_TEXTURE_BUFFER, instances.texture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, instances.buffer);
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+	}
+	instances.uploaded = true;
+	this->stats.buffer_binds++;
+	this->stats.bytes_uploaded += size;
+
+	RENDERER_ERROR_CHECK("upload_instances()");
+}
 
-	const float* vertex_arr = model.getVertexArray();
-	const float* vertex_normal_arr = model.getVertexNormalArray();
-	const unsigned int* index_arr = model.getIndexArray();
+// vertex i of a box has the maximum X if bit 0 is set, Y if bit 1, Z if bit 2
+static const unsigned int BOUNDS_INDEX_ARRAY[] =
+{
+	4, 6, 2,   4, 2, 0,	// left
+	1, 3, 7,   1, 7, 5,	// right
+	0, 1, 5,   0, 5, 4,	// bottom
+	6, 7, 3,   6, 3, 2,	// top
+	2, 3, 1,   2, 1, 0,	// back
+	4, 5, 7,   4, 7, 6	// front
+};
+
+// draws a world-space box with the current program
+static void draw_box(GLint attribute_coord3d, const float* min, const float* max,
+					FrameStats& stats)
+{
+	float vertex_arr[8*3];
+	for (int i = 0 ; i < 8 ; i++)
+	{
+		vertex_arr[i*3]   = (i & 1) ? max[0] : min[0];
+		vertex_arr[i*3+1] = (i & 2) ? max[1] : min[1];
+		vertex_arr[i*3+2] = (i & 4) ? max[2] : min[2];
+	}
 
 	glEnableVertexAttribArray( attribute_coord3d );
-	glEnableVertexAttribArray( attribute_normals );
-        glVertexAttribPointer( attribute_coord3d,
-                          3,                 // number of elements per vertex
-						  GL_FLOAT,          // the type of each element
-                          GL_FALSE,          // take our values as-is
-                          0,                 // no extra data between each position
-                          vertex_arr );   // pointer to the array
-
-	glVertexAttribPointer( attribute_normals,
-                          3,               // number of elements per vertex
-                          GL_FLOAT,        // the type of each element
-                          GL_FALSE,        // take our values as-is
-                          0,               // no extra data between each position
-                          vertex_normal_arr );  // pointer to the array
-
-	glDrawElements( GL_TRIANGLES, model.getNTriangles()*3, GL_UNSIGNED_INT, index_arr );
+	glVertexAttribPointer( attribute_coord3d, 3, GL_FLOAT, GL_FALSE, 0, vertex_arr );
+	glDrawElements( GL_TRIANGLES, 36, GL_UNSIGNED_INT, BOUNDS_INDEX_ARRAY );
+	glDisableVertexAttribArray( attribute_coord3d );
+	stats.draw_calls++;
+	stats.triangles += 12;
+	stats.bytes_uploaded += sizeof(vertex_arr) + sizeof(BOUNDS_INDEX_ARRAY);
+}
+
+void Renderer::drawBounds(const Vector4f& min, const Vector4f& max)
+{
+	const ShaderProgram* p_previous = this->p_current;
+	if (!this->depth_only)
+		this->useDepthOnly();
+
+	GLint att_model = this->getUniform("model");
+	glUniformMatrix4fv(att_model, 1, false, Mat4x4f::IDENTITY);
+	this->stats.uniform_uploads++;
 
+	draw_box(this->getAttribute("pos"), min, max, this->stats);
+
+	if (p_previous != nullptr && p_previous != this->p_current)
+		this->use_program(p_previous);
+
+	RENDERER_ERROR_CHECK("drawBounds()");
+}
+
+bool Renderer::initDeferred(void)
+{
+	if (this->p_deferred != nullptr) return true;
+
+	try {
+		this->p_deferred = new Deferred;
+	} catch (ShaderException& e) {
+		RENDERER_ERROR_CHECK("initDeferred()");
+		return false;
+	}
+
+	// the G-buffer program writes to two color attachments
+	const GLuint gbuffer = this->p_deferred->gbuffer_prg.getProgram();
+	glBindFragDataLocation(gbuffer, 0, "g_normal");
+	glBindFragDataLocation(gbuffer, 1, "g_material");
+	glLinkProgram(gbuffer);
+
+	static const char* const samplers[4] =
+	{
+		"g_normal", "g_material", "g_depth", "materials"
+	};
+	const ShaderProgram* lighting[2] =
+	{
+		&this->p_deferred->ambient_prg, &this->p_deferred->volume_prg
+	};
+	for (const ShaderProgram* prg : lighting)
+	{
+		const GLuint program = prg->getProgram();
+		glUseProgram(program);
+		for (int i = 0 ; i < 4 ; i++)
+			glUniform1i(glGetUniformLocation(program, samplers[i]), DEFERRED_TEXTURE_UNIT + i);
+	}
+
+	// the full screen pass reads the lights without attenuation from the "Lights" block
+	const GLuint ambient = this->p_deferred->ambient_prg.getProgram();
+	GLuint block = glGetUniformBlockIndex(ambient, "Lights");
+	if (block != GL_INVALID_INDEX)
+		glUniformBlockBinding(ambient, block, LIGHTS_BINDING);
+
+	glUseProgram(0);
+	this->p_current = nullptr;
+	RENDERER_ERROR_CHECK("initDeferred()");
+	return true;
+}
+
+// a triangle covering the whole viewport, in clip space
+static const float SCREEN_TRIANGLE[] =
+{
+	-1.0f, -1.0f, 0.0f,
+	 3.0f, -1.0f, 0.0f,
+	-1.0f,  3.0f, 0.0f
+};
+
+void Renderer::shadeDeferred(const GBuffer& gbuffer,
+							const Mat4x4f& view, const Mat4x4f& proj,
+							const float* light_pos, const float* light_color, unsigned int n,
+							int x, int y, const ShadowMaps* p_shadows)
+{
+	if (this->p_deferred == nullptr) return;
+	Deferred& d = *this->p_deferred;
+
+	Mat4x4f view_proj = proj;
+	view_proj *= view;
+	Mat4x4f inv_view_proj;
+	if (!math::invert(view_proj, inv_view_proj)) return;
+
+	// upload the frame's materials
+	glBindBuffer(GL_TEXTURE_BUFFER, d.material_buffer);
+	if (!d.material_data.empty())
+		glBufferData(GL_TEXTURE_BUFFER, d.material_data.size() * sizeof(float),
+					d.material_data.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	this->stats.buffer_binds++;
+	this->stats.bytes_uploaded += d.material_data.size() * sizeof(float);
+
+	const GLuint textures[3] =
+	{
+		gbuffer.getNormalTexture(), gbuffer.getMaterialTexture(), gbuffer.getDepthTexture()
+	};
+	for (int i = 0 ; i < 3 ; i++)
+	{
+		glActiveTexture(GL_TEXTURE0 + DEFERRED_TEXTURE_UNIT + i);
+		glBindTexture(GL_TEXTURE_2D, textures[i]);
+	}
+	glActiveTexture(GL_TEXTURE0 + DEFERRED_TEXTURE_UNIT + 3);
+	glBindTexture(GL_TEXTURE_BUFFER, d.material_texture);
+	glActiveTexture(GL_TEXTURE0);
+
+	const float screen[4] =
+	{
+		(float)x, (float)y, 1.0f / gbuffer.getWidth(), 1.0f / gbuffer.getHeight()
+	};
+
+	// lights reaching every pixel are shaded in the full screen pass
+	d.global_pos.clear();
+	d.global_color.clear();
+	d.global_index.assign(n, -1);
+	for (unsigned int l = 0 ; l < n ; l++)
+	{
+		if (light_pos[l * 4 + 3] != 0.0f
+				&& ClusteredLighting::lightRange(&light_color[l * 4]) >= 0.0f)
+			continue;
+		d.global_index[l] = d.global_pos.size() / 4;
+		d.global_pos.insert(d.global_pos.end(), &light_pos[l * 4], &light_pos[l * 4 + 4]);
+		d.global_color.insert(d.global_color.end(), &light_color[l * 4], &light_color[l * 4 + 4]);
+	}
+	unsigned int n_global = d.global_pos.size() / 4;
+	if (n_global > MAX_SCENE_LIGHTS) n_global = MAX_SCENE_LIGHTS;
+
+	// full screen pass, also restoring the depth of the scene
+	this->use_program(&d.ambient_prg);
+	this->passLights(d.global_pos.data(), d.global_color.data(), n_global);
+	glUniform1i(this->getUniform("light_count"), n_global);
+	this->passShadows(p_shadows, d.global_index.data());
+	glUniformMatrix4fv(this->getUniform("inv_view_proj"), 1, false, inv_view_proj);
+	glUniformMatrix4fv(this->getUniform("view"), 1, false, view);
+	glUniform4fv(this->getUniform("screen"), 1, screen);
+	this->stats.uniform_uploads += 4;
+
+	glDepthFunc(GL_ALWAYS);
+	GLint attribute_coord3d = this->getAttribute("pos");
+	glEnableVertexAttribArray( attribute_coord3d );
+	glVertexAttribPointer( attribute_coord3d, 3, GL_FLOAT, GL_FALSE, 0, SCREEN_TRIANGLE );
+	glDrawArrays( GL_TRIANGLES, 0, 3 );
+	this->stats.draw_calls++;
+	this->stats.triangles++;
+	this->stats.bytes_uploaded += sizeof(SCREEN_TRIANGLE);
 	glDisableVertexAttribArray( attribute_coord3d );
-	glDisableVertexAttribArray( attribute_normals );
 
-	RENDERER_ERROR_CHECK("drawModel()");
+	// light volumes: the back faces of each light's box, where the scene lies
+	// in front of them, added to the full screen pass
+	this->use_program(&d.volume_prg);
+	glUniformMatrix4fv(this->getUniform("proj"), 1, false, proj);
+	glUniformMatrix4fv(this->getUniform("view"), 1, false, view);
+	glUniformMatrix4fv(this->getUniform("model"), 1, false, Mat4x4f::IDENTITY);
+	glUniformMatrix4fv(this->getUniform("inv_view_proj"), 1, false, inv_view_proj);
+	glUniform4fv(this->getUniform("screen"), 1, screen);
+	this->stats.uniform_uploads += 5;
+	GLint att_light_pos = this->getUniform("light_pos");
+	GLint att_light_color = this->getUniform("light_color");
+	GLint att_light_range = this->getUniform("light_range");
+	GLint att_light_index = this->getUniform("light_index");
+	this->passShadows(p_shadows);
+	attribute_coord3d = this->getAttribute("pos");
+
+	glDepthFunc(GL_GEQUAL);
+	glDepthMask(GL_FALSE);
+	glCullFace(GL_FRONT);
+	glEnable(GL_DEPTH_CLAMP); // keep the back faces beyond the far plane
+	glBlendFunc(GL_ONE, GL_ONE);
+
+	for (unsigned int l = 0 ; l < n ; l++)
+	{
+		const float* pos = &light_pos[l * 4];
+		const float* color = &light_color[l * 4];
+		if (pos[3] == 0.0f) continue;
+		const float r = ClusteredLighting::lightRange(color);
+		if (r <= 0.0f) continue;
+
+		glUniform4fv(att_light_pos, 1, pos);
+		glUniform4fv(att_light_color, 1, color);
+		glUniform1f(att_light_range, r);
+		glUniform1i(att_light_index, l);
+		this->stats.uniform_uploads += 4;
+
+		const float min[3] = { pos[0] - r, pos[1] - r, pos[2] - r };
+		const float max[3] = { pos[0] + r, pos[1] + r, pos[2] + r };
+		draw_box(attribute_coord3d, min, max, this->stats);
+	}
+
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDisable(GL_DEPTH_CLAMP);
+	glCullFace(GL_BACK);
+	glDepthMask(GL_TRUE);
+	glDepthFunc(GL_LESS);
+	RENDERER_ERROR_CHECK("shadeDeferred()");
 }
 
 #ifdef _GISELLE_DEBUG
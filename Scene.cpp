@@ -51,10 +51,30 @@ Entity& Scene::root(void)
 
 void Scene::setLight(Light& light)
 {
-	this->p_light = &light;
+	this->lights.clear();
+	this->lights.push_back(&light);
+}
+
+bool Scene::addLight(Light& light)
+{
+	for (Light* p : this->lights)
+		if (p == &light) return false;
+
+	this->lights.push_back(&light);
+	return true;
+}
+
+void Scene::removeLight(Light& light)
+{
+	this->lights.remove(&light);
 }
 
 const Light& Scene::getLight(void) const
 {
-	return *this->p_light;
+	return *this->lights.front();
+}
+
+const std::list<Light*>& Scene::getLights(void) const
+{
+	return this->lights;
 }
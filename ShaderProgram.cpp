@@ -23,6 +23,7 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 #include "ShaderProgram.h"
+#include "TraceRecorder.h"
 
 #include <GL/glew.h>
 #include <GL/gl.h>
@@ -43,53 +44,360 @@ static char INFO_LOG_BUFFER[1024];
 
 using namespace giselle;
 
+// shadow maps of up to ShadowMaps::MAX_SHADOWS lights, shared by the lighting shaders;
+// shadow(k, W) is the fraction of light k reaching the world position W
+#define SHADOW_GLSL \
+"uniform sampler2DArrayShadow shadow_static;\n" \
+"uniform sampler2DArrayShadow shadow_dynamic;\n" \
+"uniform int shadow_count;\n" \
+"uniform int shadow_light[4];\n" \
+"uniform mat4x4 shadow_mat[4];\n" \
+"float shadow(int k, vec3 W) {\n" \
+	"for (int s = 0; s < shadow_count; s++) {\n" \
+		"if( shadow_light[s] != k ) continue;\n" \
+		"vec4 p = shadow_mat[s] * vec4(W, 1.0);\n" \
+		"p.xyz /= p.w;\n" \
+		"if( any(lessThan(p.xyz, vec3(0.0))) || any(greaterThan(p.xyz, vec3(1.0))) )\n" \
+			"return 1.0;\n" \
+		"vec4 c = vec4(p.xy, float(s), p.z);\n" \
+		"return texture(shadow_static, c) * texture(shadow_dynamic, c);\n" \
+	"}\n" \
+	"return 1.0;\n" \
+"}\n"
+
+// decoding of quantized vertices (see VertexLayout), shared by the mesh vertex shaders;
+// the defaults leave plain positions and normals untouched
+#define DECODE_GLSL \
+"uniform vec3 pos_offset = vec3(0.0);\n" \
+"uniform vec3 pos_scale = vec3(1.0);\n" \
+"uniform bool oct_normals = false;\n" \
+"vec3 decode_normal(vec3 n) {\n" \
+	"if( !oct_normals ) return n;\n" \
+	"vec3 o = vec3(n.xy, 1.0 - abs(n.x) - abs(n.y));\n" \
+	"if( o.z < 0.0 )\n" \
+		"o.xy = (1.0 - abs(o.yx)) * vec2(o.x >= 0.0 ? 1.0 : -1.0, o.y >= 0.0 ? 1.0 : -1.0);\n" \
+	"return normalize(o);\n" \
+"}\n"
+
+// procedural primitives (see PrimitiveInstances), shared by the mesh vertex shaders;
+// with proc_shape 1, 2 or 3 the vertex of a box, sphere or cylinder is computed from
+// gl_VertexID and placed by the position and scale of instance gl_InstanceID; vertices
+// come 6 per quad (or box face), and cylinders have their side quads first, then the
+// triangles of the bottom and top caps
+#define PROCEDURAL_GLSL \
+"uniform int proc_shape = 0;\n" \
+"uniform int proc_segments = 4;\n" \
+"uniform samplerBuffer proc_instances;\n" \
+"const float PI = 3.14159265;\n" \
+"const ivec2 QUAD[6] = ivec2[6](ivec2(0,0), ivec2(1,0), ivec2(1,1), ivec2(0,0), ivec2(1,1), ivec2(0,1));\n" \
+"const vec3 BOX_N[6] = vec3[6](vec3(1,0,0), vec3(-1,0,0), vec3(0,1,0), vec3(0,-1,0), vec3(0,0,1), vec3(0,0,-1));\n" \
+"const vec3 BOX_T[6] = vec3[6](vec3(0,1,0), vec3(0,0,1), vec3(0,0,1), vec3(1,0,0), vec3(1,0,0), vec3(0,1,0));\n" \
+"const vec3 BOX_B[6] = vec3[6](vec3(0,0,1), vec3(0,1,0), vec3(1,0,0), vec3(0,0,1), vec3(0,1,0), vec3(1,0,0));\n" \
+"void procedural(inout vec3 p, inout vec3 n) {\n" \
+	"int v = gl_VertexID, s = proc_segments;\n" \
+	"int c = v / 6;\n" \
+	"ivec2 q = QUAD[v - c * 6];\n" \
+	"if( proc_shape == 1 ) {\n" \
+		"n = BOX_N[c];\n" \
+		"p = n + (2.0 * float(q.x) - 1.0) * BOX_T[c] + (2.0 * float(q.y) - 1.0) * BOX_B[c];\n" \
+	"} else if( proc_shape == 2 ) {\n" \
+		"float theta = PI * float(c / s + q.y) / float(s / 2);\n" \
+		"float phi = 2.0 * PI * float((c + q.x) % s) / float(s);\n" \
+		"n = vec3(sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi));\n" \
+		"p = n;\n" \
+	"} else if( v < 6 * s ) {\n" \
+		"float a = 2.0 * PI * float((c + q.x) % s) / float(s);\n" \
+		"n = vec3(sin(a), 0.0, cos(a));\n" \
+		"p = vec3(n.x, float(q.y), n.z);\n" \
+	"} else {\n" \
+		"int w = v - 6 * s;\n" \
+		"int top = w / (3 * s);\n" \
+		"int t = w - top * 3 * s, k = t % 3;\n" \
+		"int seg = t / 3 + ((k == 1) == (top == 1) ? 0 : 1);\n" \
+		"float a = 2.0 * PI * float(seg % s) / float(s);\n" \
+		"p = k == 0 ? vec3(0.0, float(top), 0.0) : vec3(sin(a), float(top), cos(a));\n" \
+		"n = vec3(0.0, top == 1 ? 1.0 : -1.0, 0.0);\n" \
+	"}\n" \
+	"int i = gl_InstanceID * 6;\n" \
+	"vec3 offset = vec3(texelFetch(proc_instances, i).r, texelFetch(proc_instances, i + 1).r,\n" \
+					"texelFetch(proc_instances, i + 2).r);\n" \
+	"vec3 scale = vec3(texelFetch(proc_instances, i + 3).r, texelFetch(proc_instances, i + 4).r,\n" \
+					"texelFetch(proc_instances, i + 5).r);\n" \
+	"p = offset + scale * p;\n" \
+	"n = n / scale;\n" \
+"}\n"
+
 const char* const ShaderProgram::DEFAULT_VERTEX_SHADER =
-"#version 130\n"
-"attribute vec3 pos;\n"
-"attribute vec3 vnorm;\n"
+"#version 140\n"
+"in vec3 pos;\n"
+"in vec3 vnorm;\n"
 "uniform mat4x4 proj;\n"
 //"uniform mat4x4 modelView;"
 "uniform mat4x4 model;\n"
 "uniform mat4x4 view;\n"
-"out vec3 fN, fE, fL;\n"
-"uniform vec4 light_pos;\n"
+"out vec3 fN, fE, fW;\n"
+"invariant gl_Position;\n" // must match the depth pre-pass exactly
+DECODE_GLSL
+PROCEDURAL_GLSL
 
 "void main() {\n"
 	"mat4x4 modelview = view * model;\n"
-	"vec4 worldpos = model * vec4(pos, 1.0);\n" // world position
+	"vec3 p = pos_offset + pos_scale * pos;\n"
+	"vec3 n = decode_normal(vnorm);\n"
+	"if( proc_shape != 0 ) procedural(p, n);\n"
+	"vec4 worldpos = model * vec4(p, 1.0);\n" // world position
 	"vec4 viewpos = view * worldpos;\n"
-	"fN = (transpose(inverse(model)) * vec4(vnorm,0)).xyz;\n"
+	"fN = (transpose(inverse(model)) * vec4(n,0)).xyz;\n"
 	"fE = vec3(viewpos);\n"
-	"fL = light_pos.xyz;\n"
-	"if( light_pos.w != 0.0 ) fL = light_pos.xyz - worldpos.xyz;\n"
+	"fW = worldpos.xyz;\n"
 	"gl_Position = proj * viewpos;\n"
 "}\n";
 
+// the array sizes match Renderer::MAX_SCENE_LIGHTS and Scene::MAX_LIGHTS
 const char* const ShaderProgram::DEFAULT_FRAGMENT_SHADER =
-"#version 130\n"
-"in vec3 fN, fE, fL;\n"
+"#version 140\n"
+"in vec3 fN, fE, fW;\n"
+"out vec4 frag_color;\n"
 "uniform vec4 ambient_prod, diffuse_prod, specular_prod; \n"
-"uniform vec3 light_color;\n"
 //"uniform mat4 modelView;"
 "uniform float shininess;\n"
+"layout(std140) uniform Lights {\n"
+	"vec4 light_pos[256];\n" // w = 0 for directional lights
+	"vec4 light_color[256];\n" // a = quadratic attenuation
+"};\n"
+"uniform int light_count;\n"
+"uniform int light_index[5];\n" // the lights shading this entity
+SHADOW_GLSL
 
 "void main()\n"
 "{\n"
 	"vec3 N = normalize(fN);\n"
 	"vec3 E = normalize(fE);\n"
-	"vec3 L = normalize(fL);\n"
-	//"vec3 H = normalize(L + E);"
+	"vec4 color = vec4(0.0);\n"
+
+	"for (int i = 0; i < light_count; i++) {\n"
+		"int k = light_index[i];\n"
+		"vec3 l = light_pos[k].xyz;\n"
+		"float att = 1.0;\n"
+		"if( light_pos[k].w != 0.0 ) {\n"
+			"l -= fW;\n"
+			"att = 1.0 / (1.0 + light_color[k].a * dot(l, l));\n"
+		"}\n"
+		"vec3 L = normalize(l);\n"
+		//"vec3 H = normalize(L + E);"
+		"vec3 R = reflect(L, N);\n"
+
+		"float Kd = max(dot(L, N), 0.0);\n"
+		"float Ks = pow(max(dot(E, R), 0.0), shininess);\n"
+		"if( dot(L, N) < 0.0 ) Ks = 0.0;\n"
+		"color += (Kd * diffuse_prod + Ks * specular_prod)\n"
+				"* vec4(light_color[k].rgb, 1.0) * att * shadow(k, fW);\n"
+	"}\n"
+
+	"frag_color = ambient_prod + color;\n"
+	"frag_color.a = ambient_prod.a;\n"
+"}\n";
+
+const char* const ShaderProgram::CLUSTERED_FRAGMENT_SHADER =
+"#version 140\n"
+"in vec3 fN, fE, fW;\n"
+"out vec4 frag_color;\n"
+"uniform vec4 ambient_prod, diffuse_prod, specular_prod; \n"
+"uniform float shininess;\n"
+"uniform samplerBuffer light_pos;\n" // w = 0 for directional lights
+"uniform samplerBuffer light_color;\n" // a = quadratic attenuation
+"uniform usamplerBuffer cluster_grid;\n" // offset and count of each cluster
+"uniform usamplerBuffer cluster_lights;\n" // light indices, global ones first
+"uniform int global_lights;\n"
+"uniform ivec3 cluster_dims;\n"
+"uniform vec4 cluster_screen;\n" // region origin, tiles per pixel
+"uniform vec2 cluster_depth;\n" // slice = log(depth) * x + y
+SHADOW_GLSL
+
+"vec4 shade(int k, vec3 N, vec3 E) {\n"
+	"vec4 pos = texelFetch(light_pos, k);\n"
+	"vec4 color = texelFetch(light_color, k);\n"
+	"vec3 l = pos.xyz;\n"
+	"float att = 1.0;\n"
+	"if( pos.w != 0.0 ) {\n"
+		"l -= fW;\n"
+		"att = 1.0 / (1.0 + color.a * dot(l, l));\n"
+	"}\n"
+	"vec3 L = normalize(l);\n"
 	"vec3 R = reflect(L, N);\n"
 
-	"vec4 ambient = ambient_prod;\n"
 	"float Kd = max(dot(L, N), 0.0);\n"
-	"vec4 diffuse = Kd * diffuse_prod;\n"
 	"float Ks = pow(max(dot(E, R), 0.0), shininess);\n"
-	"vec4 specular = Ks * specular_prod;\n"
-	"if( dot(L, N) < 0.0 ) specular = vec4(0.0, 0.0, 0.0, 1.0);\n"
+	"if( dot(L, N) < 0.0 ) Ks = 0.0;\n"
+	"return (Kd * diffuse_prod + Ks * specular_prod) * vec4(color.rgb, 1.0)\n"
+			"* att * shadow(k, fW);\n"
+"}\n"
+
+"void main()\n"
+"{\n"
+	"vec3 N = normalize(fN);\n"
+	"vec3 E = normalize(fE);\n"
+	"vec4 color = vec4(0.0);\n"
+
+	"for (int i = 0; i < global_lights; i++)\n"
+		"color += shade(int(texelFetch(cluster_lights, i).r), N, E);\n"
 
-	"gl_FragColor = ambient + (diffuse + specular) * vec4(light_color, 1.0);\n"
-	"gl_FragColor.a = ambient.a;\n"
+	"ivec2 tile = ivec2((gl_FragCoord.xy - cluster_screen.xy) * cluster_screen.zw);\n"
+	"tile = clamp(tile, ivec2(0), cluster_dims.xy - 1);\n"
+	"int slice = int(floor(log(-fE.z) * cluster_depth.x + cluster_depth.y));\n"
+	"slice = clamp(slice, 0, cluster_dims.z - 1);\n"
+	"int c = (slice * cluster_dims.y + tile.y) * cluster_dims.x + tile.x;\n"
+	"uvec2 cell = texelFetch(cluster_grid, c).rg;\n"
+	"for (int i = 0; i < int(cell.y); i++)\n"
+		"color += shade(int(texelFetch(cluster_lights, int(cell.x) + i).r), N, E);\n"
+
+	"frag_color = ambient_prod + color;\n"
+	"frag_color.a = ambient_prod.a;\n"
+"}\n";
+
+const char* const ShaderProgram::GBUFFER_FRAGMENT_SHADER =
+"#version 140\n"
+"in vec3 fN, fE, fW;\n"
+"out vec4 g_normal;\n"
+"out uint g_material;\n"
+"uniform uint material_id;\n"
+
+"void main()\n"
+"{\n"
+	"g_normal = vec4(normalize(fN), 1.0);\n"
+	"g_material = material_id;\n"
+"}\n";
+
+const char* const ShaderProgram::SCREEN_VERTEX_SHADER =
+"#version 140\n"
+"in vec3 pos;\n" // already in clip space
+
+"void main() {\n"
+	"gl_Position = vec4(pos, 1.0);\n"
+"}\n";
+
+// the array size matches Renderer::MAX_SCENE_LIGHTS
+const char* const ShaderProgram::DEFERRED_AMBIENT_FRAGMENT_SHADER =
+"#version 140\n"
+"out vec4 frag_color;\n"
+"uniform sampler2D g_normal;\n"
+"uniform usampler2D g_material;\n"
+"uniform sampler2D g_depth;\n"
+"uniform samplerBuffer materials;\n" // ambient, diffuse, specular + shininess
+"uniform mat4x4 inv_view_proj;\n"
+"uniform mat4x4 view;\n"
+"uniform vec4 screen;\n" // region origin, 1 / region size
+"layout(std140) uniform Lights {\n"
+	"vec4 light_pos[256];\n" // w = 0 for directional lights
+	"vec4 light_color[256];\n" // a = quadratic attenuation
+"};\n"
+"uniform int light_count;\n"
+SHADOW_GLSL
+
+"void main()\n"
+"{\n"
+	"ivec2 texel = ivec2(gl_FragCoord.xy - screen.xy);\n"
+	"float depth = texelFetch(g_depth, texel, 0).r;\n"
+	"if( depth == 1.0 ) discard;\n" // nothing was drawn here
+	"gl_FragDepth = depth;\n" // restore the depth buffer of the window
+
+	"vec2 uv = (gl_FragCoord.xy - screen.xy) * screen.zw;\n"
+	"vec4 p = inv_view_proj * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);\n"
+	"vec3 W = p.xyz / p.w;\n"
+	"vec3 N = normalize(texelFetch(g_normal, texel, 0).xyz);\n"
+	"vec3 E = normalize((view * vec4(W, 1.0)).xyz);\n"
+	"int m = int(texelFetch(g_material, texel, 0).r) * 3;\n"
+	"vec4 ambient_prod = texelFetch(materials, m);\n"
+	"vec4 diffuse_prod = texelFetch(materials, m + 1);\n"
+	"vec4 specular_prod = texelFetch(materials, m + 2);\n"
+	"float shininess = specular_prod.a;\n"
+	"specular_prod.a = 1.0;\n"
+
+	"vec4 color = vec4(0.0);\n"
+	"for (int i = 0; i < light_count; i++) {\n"
+		"vec3 l = light_pos[i].xyz;\n"
+		"if( light_pos[i].w != 0.0 ) l -= W;\n"
+		"vec3 L = normalize(l);\n"
+		"vec3 R = reflect(L, N);\n"
+		"float Kd = max(dot(L, N), 0.0);\n"
+		"float Ks = pow(max(dot(E, R), 0.0), shininess);\n"
+		"if( dot(L, N) < 0.0 ) Ks = 0.0;\n"
+		"color += (Kd * diffuse_prod + Ks * specular_prod)\n"
+				"* vec4(light_color[i].rgb, 1.0) * shadow(i, W);\n"
+	"}\n"
+
+	"frag_color = ambient_prod + color;\n"
+	"frag_color.a = ambient_prod.a;\n"
+"}\n";
+
+const char* const ShaderProgram::DEFERRED_LIGHT_FRAGMENT_SHADER =
+"#version 140\n"
+"out vec4 frag_color;\n"
+"uniform sampler2D g_normal;\n"
+"uniform usampler2D g_material;\n"
+"uniform sampler2D g_depth;\n"
+"uniform samplerBuffer materials;\n" // ambient, diffuse, specular + shininess
+"uniform mat4x4 inv_view_proj;\n"
+"uniform mat4x4 view;\n"
+"uniform vec4 screen;\n" // region origin, 1 / region size
+"uniform vec4 light_pos;\n"
+"uniform vec4 light_color;\n" // a = quadratic attenuation
+"uniform float light_range;\n"
+"uniform int light_index;\n" // the light's index in the scene
+SHADOW_GLSL
+
+"void main()\n"
+"{\n"
+	"ivec2 texel = ivec2(gl_FragCoord.xy - screen.xy);\n"
+	"float depth = texelFetch(g_depth, texel, 0).r;\n"
+	"if( depth == 1.0 ) discard;\n"
+
+	"vec2 uv = (gl_FragCoord.xy - screen.xy) * screen.zw;\n"
+	"vec4 p = inv_view_proj * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);\n"
+	"vec3 W = p.xyz / p.w;\n"
+	"vec3 l = light_pos.xyz - W;\n"
+	"if( dot(l, l) > light_range * light_range ) discard;\n"
+
+	"vec3 N = normalize(texelFetch(g_normal, texel, 0).xyz);\n"
+	"vec3 E = normalize((view * vec4(W, 1.0)).xyz);\n"
+	"int m = int(texelFetch(g_material, texel, 0).r) * 3;\n"
+	"vec4 diffuse_prod = texelFetch(materials, m + 1);\n"
+	"vec4 specular_prod = texelFetch(materials, m + 2);\n"
+	"float shininess = specular_prod.a;\n"
+
+	"float att = 1.0 / (1.0 + light_color.a * dot(l, l));\n"
+	"vec3 L = normalize(l);\n"
+	"vec3 R = reflect(L, N);\n"
+	"float Kd = max(dot(L, N), 0.0);\n"
+	"float Ks = pow(max(dot(E, R), 0.0), shininess);\n"
+	"if( dot(L, N) < 0.0 ) Ks = 0.0;\n"
+	"frag_color = vec4((Kd * diffuse_prod.rgb + Ks * specular_prod.rgb)\n"
+					"* light_color.rgb * att * shadow(light_index, W), 0.0);\n" // added to the ambient pass
+"}\n";
+
+const char* const ShaderProgram::DEPTH_VERTEX_SHADER =
+"#version 140\n"
+"in vec3 pos;\n"
+"uniform mat4x4 proj;\n"
+"uniform mat4x4 model;\n"
+"uniform mat4x4 view;\n"
+"invariant gl_Position;\n"
+DECODE_GLSL
+PROCEDURAL_GLSL
+
+"void main() {\n"
+	"vec3 p = pos_offset + pos_scale * pos;\n"
+	"vec3 n = vec3(0.0);\n"
+	"if( proc_shape != 0 ) procedural(p, n);\n"
+	"vec4 worldpos = model * vec4(p, 1.0);\n"
+	"vec4 viewpos = view * worldpos;\n"
+	"gl_Position = proj * viewpos;\n"
+"}\n";
+
+const char* const ShaderProgram::DEPTH_FRAGMENT_SHADER =
+"#version 140\n"
+"void main()\n"
+"{\n"
 "}\n";
 
 ShaderProgram::ShaderProgram( const char* vertex_shader_source,
@@ -124,6 +432,7 @@ ShaderProgram::~ShaderProgram()
 
 bool ShaderProgram::loadShaders(const char* vertex_shader, const char* fragment_shader)
 {
+	TraceRecorder::Scope trace("compile shaders", "shaders");
 	int status;
 
 	// create vertex shader
@@ -166,6 +475,7 @@ bool ShaderProgram::loadShaders(const char* vertex_shader, const char* fragment_
 	this->program = glCreateProgram();
 	glAttachShader(this->program, vs);
 	glAttachShader(this->program, fs);
+	glBindFragDataLocation(this->program, 0, "frag_color");
 
 	// link program
 	glLinkProgram(program);
@@ -198,16 +508,26 @@ int ShaderProgram::getFragmentShader(void) const
 { return this->fs; }
 
 int ShaderProgram::getAttribute(const std::string& att_name) const
+{
+	return this->getAttribute(att_name.c_str());
+}
+
+int ShaderProgram::getAttribute(const char* att_name) const
 {
 	if (program == 0) return -1;
-	int att = glGetAttribLocation(program, att_name.c_str());
+	int att = glGetAttribLocation(program, att_name);
 	return att;
 }
 
 int ShaderProgram::getUniform(const std::string& att_name) const
+{
+	return this->getUniform(att_name.c_str());
+}
+
+int ShaderProgram::getUniform(const char* att_name) const
 {
 	if (program == 0) return -1;
-	int att = glGetUniformLocation(program, att_name.c_str());
+	int att = glGetUniformLocation(program, att_name);
 	return att;
 }
 
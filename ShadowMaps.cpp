@@ -0,0 +1,357 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "ShadowMaps.h"
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include <cmath>
+#include <algorithm>
+
+using namespace giselle;
+using namespace scene;
+using namespace math;
+
+// growth of the sphere a projection is fitted to, over the scene's bounding sphere
+static const float FIT_SLACK = 1.25f;
+
+ShadowMaps::ShadowMaps(unsigned int size)
+:	size(size)
+,	fbo(0)
+,	textures{0, 0}
+,	n_layers(0)
+,	updates(0)
+{
+	for (Layer& l : this->layers)
+		l.valid = false;
+
+	glGenTextures(2, this->textures);
+	for (int i = 0 ; i < 2 ; i++)
+	{
+		glBindTexture(GL_TEXTURE_2D_ARRAY, this->textures[i]);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, size, size, MAX_SHADOWS,
+					0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+		// hardware filtered depth comparisons
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE,
+						GL_COMPARE_REF_TO_TEXTURE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	}
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	glGenFramebuffers(1, &this->fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, this->fbo);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, this->textures[0], 0, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		glDeleteFramebuffers(1, &this->fbo);
+		this->fbo = 0;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+ShadowMaps::~ShadowMaps()
+{
+	if (this->fbo != 0)
+		glDeleteFramebuffers(1, &this->fbo);
+	glDeleteTextures(2, this->textures);
+}
+
+bool ShadowMaps::operator!(void) const
+{
+	return this->fbo == 0;
+}
+
+unsigned int ShadowMaps::getCount(void) const
+{
+	return this->n_layers;
+}
+
+int ShadowMaps::getLightIndex(unsigned int layer) const
+{
+	return this->layers[layer].light_index;
+}
+
+const Mat4x4f& ShadowMaps::getMatrix(unsigned int layer) const
+{
+	return this->layers[layer].shadow_mat;
+}
+
+unsigned int ShadowMaps::getStaticTexture(void) const
+{
+	return this->textures[0];
+}
+
+unsigned int ShadowMaps::getDynamicTexture(void) const
+{
+	return this->textures[1];
+}
+
+unsigned int ShadowMaps::getUpdates(void) const
+{
+	return this->updates;
+}
+
+void ShadowMaps::update(Renderer& renderer, const std::vector<RenderItem>& items,
+						const std::list<Light*>& lights, const float* light_pos, unsigned int n)
+{
+	this->updates = 0;
+	this->n_layers = 0;
+	if (this->fbo == 0 || items.empty()) return;
+
+	// a change to an entity also changes its whole subtree
+	this->versions.resize(items.size());
+	for (unsigned int i = 0 ; i < items.size() ; i++)
+	{
+		this->versions[i] = items[i].p_ent->getVersion();
+		if (items[i].parent >= 0)
+			this->versions[i] += this->versions[items[i].parent];
+	}
+
+	// bounding sphere of the scene
+	const RenderItem& root = items[0];
+	float c[3], r = 0.0f;
+	for (int i = 0 ; i < 3 && root.has_sub_bounds ; i++)
+	{
+		c[i] = 0.5f * (root.sub_min[i] + root.sub_max[i]);
+		float e = 0.5f * (root.sub_max[i] - root.sub_min[i]);
+		r += e * e;
+	}
+	r = std::sqrt(r);
+
+	unsigned int l = 0;
+	for (auto it = lights.begin() ; it != lights.end() && l < n && r > 0.0f ; ++it, l++)
+	{
+		if (this->n_layers == MAX_SHADOWS) break;
+		if (!(*it)->getCastShadows()) continue;
+
+		// keep the sphere of the light's last projection while it still fits the scene
+		Layer& layer = this->layers[this->n_layers];
+		float center[3] = { c[0], c[1], c[2] }, radius = r * FIT_SLACK;
+		if (layer.valid && layer.light_index == (int)l
+				&& r * FIT_SLACK * FIT_SLACK >= layer.radius)
+		{
+			const float d[3] = { c[0] - layer.center[0], c[1] - layer.center[1],
+								c[2] - layer.center[2] };
+			if (std::sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]) + r <= layer.radius)
+			{
+				std::copy(layer.center, layer.center + 3, center);
+				radius = layer.radius;
+			}
+		}
+
+		Mat4x4f view_proj;
+		if (!this->light_matrix(&light_pos[l * 4], center, radius, view_proj)) continue;
+
+		const unsigned int j = this->n_layers++;
+		const bool moved = !layer.valid || layer.light_index != (int)l
+				|| !std::equal((const float*)view_proj, (const float*)view_proj + 16,
+								(const float*)layer.view_proj);
+
+		if (moved)
+		{
+			layer.light_index = l;
+			layer.view_proj = view_proj;
+			std::copy(center, center + 3, layer.center);
+			layer.radius = radius;
+
+			// [-1,1] to [0,1]
+			static const float bias[16] =
+			{
+				0.5f, 0.0f, 0.0f, 0.0f,
+				0.0f, 0.5f, 0.0f, 0.0f,
+				0.0f, 0.0f, 0.5f, 0.0f,
+				0.5f, 0.5f, 0.5f, 1.0f
+			};
+			layer.shadow_mat = Mat4x4f(bias);
+			layer.shadow_mat *= view_proj;
+		}
+
+		static const Entity::ShadowCasting kinds[2] =
+				{ Entity::STATIC_SHADOWS, Entity::DYNAMIC_SHADOWS };
+		for (int k = 0 ; k < 2 ; k++)
+		{
+			std::uint64_t key = this->gather(items, view_proj, kinds[k]);
+			if (!moved && key == layer.keys[k]) continue;
+
+			this->draw(renderer, items, this->textures[k], j, view_proj);
+			layer.keys[k] = key;
+			this->updates++;
+		}
+		layer.valid = true;
+	}
+
+	// layers left unused lose their cache
+	for (unsigned int j = this->n_layers ; j < MAX_SHADOWS ; j++)
+		this->layers[j].valid = false;
+}
+
+// column-major view matrix of an eye looking at a point
+static Mat4x4f look_at(const float* eye, const float* center)
+{
+	float f[3] = { center[0] - eye[0], center[1] - eye[1], center[2] - eye[2] };
+	float len = std::sqrt(f[0]*f[0] + f[1]*f[1] + f[2]*f[2]);
+	for (int i = 0 ; i < 3 ; i++) f[i] /= len;
+
+	// any up vector not parallel to the view direction
+	const float up[3] = { std::fabs(f[1]) > 0.99f ? 1.0f : 0.0f,
+						std::fabs(f[1]) > 0.99f ? 0.0f : 1.0f, 0.0f };
+	float s[3] = { f[1]*up[2] - f[2]*up[1], f[2]*up[0] - f[0]*up[2], f[0]*up[1] - f[1]*up[0] };
+	len = std::sqrt(s[0]*s[0] + s[1]*s[1] + s[2]*s[2]);
+	for (int i = 0 ; i < 3 ; i++) s[i] /= len;
+	const float u[3] = { s[1]*f[2] - s[2]*f[1], s[2]*f[0] - s[0]*f[2], s[0]*f[1] - s[1]*f[0] };
+
+	const float m[16] =
+	{
+		s[0], u[0], -f[0], 0.0f,
+		s[1], u[1], -f[1], 0.0f,
+		s[2], u[2], -f[2], 0.0f,
+		-(s[0]*eye[0] + s[1]*eye[1] + s[2]*eye[2]),
+		-(u[0]*eye[0] + u[1]*eye[1] + u[2]*eye[2]),
+		f[0]*eye[0] + f[1]*eye[1] + f[2]*eye[2], 1.0f
+	};
+	return Mat4x4f(m);
+}
+
+bool ShadowMaps::light_matrix(const float* light_pos, const float* c, float r,
+							Mat4x4f& view_proj) const
+{
+	float proj[16] = { 0 };
+	Mat4x4f view;
+	if (light_pos[3] == 0.0f)
+	{ // orthographic, from outside the sphere along the light's direction
+		float len = std::sqrt(light_pos[0]*light_pos[0] + light_pos[1]*light_pos[1]
+							+ light_pos[2]*light_pos[2]);
+		if (len == 0.0f) return false;
+		const float eye[3] = { c[0] + light_pos[0] / len * 2 * r,
+							c[1] + light_pos[1] / len * 2 * r,
+							c[2] + light_pos[2] / len * 2 * r };
+		view = look_at(eye, c);
+
+		const float near = r, far = 3 * r;
+		proj[0] = 1.0f / r;
+		proj[5] = 1.0f / r;
+		proj[10] = -2.0f / (far - near);
+		proj[14] = -(far + near) / (far - near);
+		proj[15] = 1.0f;
+	}
+	else
+	{ // perspective, enclosing the sphere
+		const float d[3] = { c[0] - light_pos[0], c[1] - light_pos[1], c[2] - light_pos[2] };
+		const float dist = std::sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+		if (dist <= r * 1.01f) return false; // would need a cube map
+
+		view = look_at(light_pos, c);
+
+		const float t = 1.0f / std::tan(std::asin(r / dist));
+		const float near = dist - r, far = dist + r;
+		proj[0] = t;
+		proj[5] = t;
+		proj[10] = -(far + near) / (far - near);
+		proj[11] = -1.0f;
+		proj[14] = -2.0f * far * near / (far - near);
+	}
+
+	view_proj = Mat4x4f(proj);
+	view_proj *= view;
+	return true;
+}
+
+// whether a box is entirely on the outer side of a clip plane
+static bool outside_frustum(const Mat4x4f& m, const Vector4f& min, const Vector4f& max)
+{
+	int out[6] = { 0, 0, 0, 0, 0, 0 };
+	for (int i = 0 ; i < 8 ; i++)
+	{
+		const float p[3] = { (i & 1) ? max[0] : min[0], (i & 2) ? max[1] : min[1],
+							(i & 4) ? max[2] : min[2] };
+		float clip[4];
+		for (int row = 0 ; row < 4 ; row++)
+			clip[row] = m.get(row, 0) * p[0] + m.get(row, 1) * p[1]
+						+ m.get(row, 2) * p[2] + m.get(row, 3);
+		for (int a = 0 ; a < 3 ; a++)
+		{
+			if (clip[a] < -clip[3]) out[a * 2]++;
+			if (clip[a] > clip[3]) out[a * 2 + 1]++;
+		}
+	}
+	for (int k = 0 ; k < 6 ; k++)
+		if (out[k] == 8) return true;
+	return false;
+}
+
+std::uint64_t ShadowMaps::gather(const std::vector<RenderItem>& items,
+								const Mat4x4f& view_proj, Entity::ShadowCasting kind)
+{
+	// FNV-1a over the casters, their versions and their levels of detail
+	std::uint64_t key = 14695981039346656037ULL;
+	this->casters.clear();
+	for (unsigned int i = 0 ; i < items.size() ; i++)
+	{
+		const RenderItem& item = items[i];
+		if (!item.has_bounds || item.p_ent->getShadowCasting() != kind) continue;
+		if (outside_frustum(view_proj, item.bmin, item.bmax)) continue;
+
+		this->casters.push_back(i);
+		const std::uint64_t words[3] = { (std::uint64_t)(std::uintptr_t)item.p_ent,
+										this->versions[i], item.p_ent->getCurrentLevel() };
+		for (std::uint64_t w : words)
+		{
+			key ^= w;
+			key *= 1099511628211ULL;
+		}
+	}
+	return key;
+}
+
+void ShadowMaps::draw(Renderer& renderer, const std::vector<RenderItem>& items,
+					unsigned int texture, unsigned int layer, const Mat4x4f& view_proj)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, this->fbo);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, layer);
+	glViewport(0, 0, this->size, this->size);
+	glClear(GL_DEPTH_BUFFER_BIT);
+
+	renderer.useDepthOnly();
+	renderer.passProjection(view_proj);
+	renderer.passViewMatrix(Mat4x4f::IDENTITY);
+
+	// keep the lit surfaces from shadowing themselves
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(2.0f, 4.0f);
+	for (unsigned int i : this->casters)
+	{
+		renderer.passModelMatrix(items[i].mat);
+		items[i].p_ent->render(renderer);
+	}
+	glDisable(GL_POLYGON_OFFSET_FILL);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
@@ -35,6 +35,7 @@ SimpleModelEntity::SimpleModelEntity( const Model& model,
 	const Vector4f& pos, const Vector4f& ang, const std::list<Entity*> & children )
 :	Entity(pos,ang,children)
 ,	model(model)
+,	occluder(false)
 {
 }
 
@@ -45,6 +46,7 @@ SimpleModelEntity::~SimpleModelEntity()
 SimpleModelEntity::SimpleModelEntity(const SimpleModelEntity& other)
 :	Entity(other)
 ,	model(other.model)
+,	occluder(other.occluder)
 {
 }
 
@@ -53,3 +55,23 @@ void SimpleModelEntity::render(Renderer& renderer) const
 	renderer.passMaterial(this->model.getMaterial()); // pass this model's material
 	renderer.drawModel(model); //draw the model
 }
+
+bool SimpleModelEntity::getBounds(Vector4f& min, Vector4f& max) const
+{
+	return this->model.getBounds(min, max);
+}
+
+void SimpleModelEntity::setOccluder(bool occluder)
+{
+	this->occluder = occluder;
+}
+
+bool SimpleModelEntity::isOccluder(void) const
+{
+	return this->occluder;
+}
+
+const Model* SimpleModelEntity::getOccluder(void) const
+{
+	return this->occluder ? &this->model : nullptr;
+}
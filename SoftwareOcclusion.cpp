@@ -0,0 +1,254 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "SoftwareOcclusion.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include "JobSystem.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace giselle;
+using namespace model;
+using namespace math;
+
+// minimum clip space W of a vertex to be projected
+static constexpr float MIN_W = 1e-5f;
+
+SoftwareOcclusion::SoftwareOcclusion(unsigned int width, unsigned int height)
+:	width((width + 3) & ~3u)
+,	height(height)
+,	depth(this->width * height, 1.0f)
+,	view_proj(Mat4x4f::IDENTITY)
+{
+}
+
+unsigned int SoftwareOcclusion::getWidth(void) const
+{ return this->width; }
+
+unsigned int SoftwareOcclusion::getHeight(void) const
+{ return this->height; }
+
+unsigned int SoftwareOcclusion::getTriangleCount(void) const
+{ return this->triangles.size(); }
+
+const float* SoftwareOcclusion::getDepthBuffer(void) const
+{ return this->depth.data(); }
+
+void SoftwareOcclusion::begin(const Mat4x4f& view_proj)
+{
+	this->view_proj = view_proj;
+	this->triangles.clear();
+	std::fill(this->depth.begin(), this->depth.end(), 1.0f);
+}
+
+void SoftwareOcclusion::addOccluder(const Model& model, const Mat4x4f& model_mat)
+{
+	const float* vertex_arr = model.getVertexArray();
+	const unsigned int* index_arr = model.getIndexArray();
+	if (vertex_arr == nullptr || index_arr == nullptr) return;
+
+	Mat4x4f mvp = this->view_proj;
+	mvp *= model_mat;
+	const float* m = mvp; // column-major
+
+	// transform all vertices to screen space once
+	const unsigned int n = model.getNVertices();
+	this->clip.resize(n * 4);
+	for (unsigned int i = 0 ; i < n ; i++)
+	{
+		const float* v = vertex_arr + i*3;
+		float c[4];
+		for (int r = 0 ; r < 4 ; r++)
+			c[r] = m[r]*v[0] + m[4+r]*v[1] + m[8+r]*v[2] + m[12+r];
+
+		float* out = &this->clip[i*4];
+		out[3] = c[3];
+		if (c[3] < MIN_W) continue;
+		out[0] = (c[0] / c[3] * 0.5f + 0.5f) * this->width;
+		out[1] = (c[1] / c[3] * 0.5f + 0.5f) * this->height;
+		out[2] = c[2] / c[3] * 0.5f + 0.5f;
+	}
+
+	for (unsigned int t = 0 ; t < model.getNTriangles() ; t++)
+	{
+		const float* p0 = &this->clip[index_arr[t*3] * 4];
+		const float* p1 = &this->clip[index_arr[t*3+1] * 4];
+		const float* p2 = &this->clip[index_arr[t*3+2] * 4];
+		if (p0[3] < MIN_W || p1[3] < MIN_W || p2[3] < MIN_W)
+			continue; // crosses the camera plane, dropping it is conservative
+
+		const float x0 = p0[0], y0 = p0[1], z0 = p0[2];
+		const float x1 = p1[0], y1 = p1[1], z1 = p1[2];
+		const float x2 = p2[0], y2 = p2[1], z2 = p2[2];
+
+		// counter-clockwise triangles face the camera
+		const float area = (x1-x0)*(y2-y0) - (x2-x0)*(y1-y0);
+		if (area <= 0.0f) continue;
+
+		Triangle tri;
+		tri.min_x = std::max(0, (int)std::floor(std::min(x0, std::min(x1, x2))));
+		tri.max_x = std::min((int)this->width - 1, (int)std::floor(std::max(x0, std::max(x1, x2))));
+		tri.min_y = std::max(0, (int)std::floor(std::min(y0, std::min(y1, y2))));
+		tri.max_y = std::min((int)this->height - 1, (int)std::floor(std::max(y0, std::max(y1, y2))));
+		if (tri.min_x > tri.max_x || tri.min_y > tri.max_y) continue;
+
+		const float xs[3] = {x0, x1, x2};
+		const float ys[3] = {y0, y1, y2};
+		for (int k = 0 ; k < 3 ; k++)
+		{
+			const int j = (k + 1) % 3;
+			tri.ex[k] = ys[k] - ys[j];
+			tri.ey[k] = xs[j] - xs[k];
+			tri.ec[k] = (ys[j] - ys[k]) * xs[k] - (xs[j] - xs[k]) * ys[k];
+		}
+
+		tri.zx = ((z1-z0)*(y2-y0) - (z2-z0)*(y1-y0)) / area;
+		tri.zy = ((z2-z0)*(x1-x0) - (z1-z0)*(x2-x0)) / area;
+		tri.zc = z0 - tri.zx * x0 - tri.zy * y0;
+
+		this->triangles.push_back(tri);
+	}
+}
+
+void SoftwareOcclusion::rasterize(void)
+{
+	if (this->triangles.empty()) return;
+
+	const unsigned int n_bands = (this->height + BAND_ROWS - 1) / BAND_ROWS;
+	JobSystem::shared().parallelFor(0, n_bands, 1,
+		[this](unsigned int band_begin, unsigned int band_end)
+		{
+			this->rasterizeBand(band_begin * BAND_ROWS,
+								std::min(this->height, band_end * BAND_ROWS));
+		});
+}
+
+void SoftwareOcclusion::rasterizeBand(unsigned int row_begin, unsigned int row_end)
+{
+	for (const Triangle& tri : this->triangles)
+	{
+		const int y_begin = std::max(tri.min_y, (int)row_begin);
+		const int y_end = std::min(tri.max_y + 1, (int)row_end);
+
+		for (int y = y_begin ; y < y_end ; y++)
+		{
+			const float py = y + 0.5f;
+			const float e0 = tri.ey[0] * py + tri.ec[0];
+			const float e1 = tri.ey[1] * py + tri.ec[1];
+			const float e2 = tri.ey[2] * py + tri.ec[2];
+			const float ez = tri.zy * py + tri.zc;
+			float* row = &this->depth[y * this->width];
+
+			// rows are a multiple of 4 wide, so aligned groups never overflow
+			int x = tri.min_x & ~3;
+#ifdef __SSE2__
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 ex0 = _mm_set1_ps(tri.ex[0]), ev0 = _mm_set1_ps(e0);
+			const __m128 ex1 = _mm_set1_ps(tri.ex[1]), ev1 = _mm_set1_ps(e1);
+			const __m128 ex2 = _mm_set1_ps(tri.ex[2]), ev2 = _mm_set1_ps(e2);
+			const __m128 zx = _mm_set1_ps(tri.zx), zv = _mm_set1_ps(ez);
+			for ( ; x <= tri.max_x ; x += 4)
+			{
+				const __m128 px = _mm_set_ps(x + 3.5f, x + 2.5f, x + 1.5f, x + 0.5f);
+				__m128 mask = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(ex0, px), ev0), zero);
+				mask = _mm_and_ps(mask, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(ex1, px), ev1), zero));
+				mask = _mm_and_ps(mask, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(ex2, px), ev2), zero));
+				if (_mm_movemask_ps(mask) == 0) continue;
+
+				const __m128 z = _mm_add_ps(_mm_mul_ps(zx, px), zv);
+				const __m128 d = _mm_loadu_ps(row + x);
+				const __m128 nd = _mm_min_ps(d, z);
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(mask, nd), _mm_andnot_ps(mask, d)));
+			}
+#else
+			for ( ; x <= tri.max_x ; x++)
+			{
+				const float px = x + 0.5f;
+				if (tri.ex[0] * px + e0 < 0.0f || tri.ex[1] * px + e1 < 0.0f
+						|| tri.ex[2] * px + e2 < 0.0f)
+					continue;
+				const float z = tri.zx * px + ez;
+				if (z < row[x]) row[x] = z;
+			}
+#endif
+		}
+	}
+}
+
+bool SoftwareOcclusion::isVisible(const Vector4f& min, const Vector4f& max) const
+{
+	const float* m = this->view_proj;
+
+	float lo_x = 1e30f, hi_x = -1e30f, lo_y = 1e30f, hi_y = -1e30f, lo_z = 1e30f;
+	for (int i = 0 ; i < 8 ; i++)
+	{
+		const float v[3] = {
+			(i & 1) ? max.x() : min.x(),
+			(i & 2) ? max.y() : min.y(),
+			(i & 4) ? max.z() : min.z() };
+
+		float c[4];
+		for (int r = 0 ; r < 4 ; r++)
+			c[r] = m[r]*v[0] + m[4+r]*v[1] + m[8+r]*v[2] + m[12+r];
+		if (c[3] < MIN_W) return true; // box crosses the camera plane
+
+		const float sx = (c[0] / c[3] * 0.5f + 0.5f) * this->width;
+		const float sy = (c[1] / c[3] * 0.5f + 0.5f) * this->height;
+		const float sz = c[2] / c[3] * 0.5f + 0.5f;
+		lo_x = std::min(lo_x, sx); hi_x = std::max(hi_x, sx);
+		lo_y = std::min(lo_y, sy); hi_y = std::max(hi_y, sy);
+		lo_z = std::min(lo_z, sz);
+	}
+
+	// outside of the view volume
+	if (hi_x < 0.0f || hi_y < 0.0f || lo_x >= this->width || lo_y >= this->height
+			|| lo_z > 1.0f)
+		return false;
+	if (lo_z <= 0.0f) return true;
+
+	const int x_begin = std::max(0, (int)std::floor(lo_x));
+	const int x_end = std::min((int)this->width, (int)std::floor(hi_x) + 1);
+	const int y_begin = std::max(0, (int)std::floor(lo_y));
+	const int y_end = std::min((int)this->height, (int)std::floor(hi_y) + 1);
+
+	for (int y = y_begin ; y < y_end ; y++)
+	{
+		const float* row = &this->depth[y * this->width];
+		int x = x_begin;
+#ifdef __SSE2__
+		const __m128 z = _mm_set1_ps(lo_z);
+		for ( ; x + 4 <= x_end ; x += 4)
+			if (_mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(row + x), z)) != 0)
+				return true;
+#endif
+		for ( ; x < x_end ; x++)
+			if (row[x] > lo_z) return true;
+	}
+	return false;
+}
@@ -23,9 +23,14 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 #include "Sphere.h"
+#include "ModelBuilder.h"
+#include "MeshOptimizer.h"
+#include "MeshCache.h"
 
 #include <math.h>
 #include "MathUtils.h"
+#include "JobSystem.h"
+#include "TraceRecorder.h"
 
 #ifdef _GISELLE_DEBUG
 #include <iostream>
@@ -38,17 +43,19 @@ using namespace giselle;
 using namespace model;
 using namespace math;
 
-Model model::Sphere(float radius, int lat, int lon)
-{
-	if (radius <= 0 || lat < 1 || lon < 3)
-		return Model();
+// minimum number of vertices per mesh generation task
+static constexpr unsigned int VERTEX_GRAIN = 4096;
 
+static std::shared_ptr<const MeshData> generate_sphere(float radius, int lat, int lon)
+{
+	TraceRecorder::Scope trace("sphere", "assets");
 	unsigned int nVertices = 2 + lat * lon;
 	unsigned int nTriangles = 2 * lat * lon;
 
-	float* vertex_array = new float[nVertices*3];
-	float* vertex_normal_array = new float[nVertices*3];
-	unsigned int* index_array = new unsigned int[nTriangles*3];
+	ModelBuilder builder(nVertices, nTriangles);
+	float* vertex_array = builder.getVertexArray();
+	float* vertex_normal_array = builder.getVertexNormalArray();
+	unsigned int* index_array = builder.getIndexArray();
 
 	int i = 0;
 
@@ -66,26 +73,34 @@ Model model::Sphere(float radius, int lat, int lon)
 	// build rings of vertices [1 ; nVertices-1]
 	// each ring has (lon) vertices
 
-	for (int row = 0 ; row < lat ; row++)
-	{
-		float beta = PI/2 - (row+1) * (PI/(lat+1));
-		float y = radius * sin(beta);
-		float r = radius * cos(beta);
-		for (int col = 0 ; col < lon ; col++)
+	// rings are independent of each other, large spheres build them in parallel
+	const unsigned int row_grain = (VERTEX_GRAIN + lon - 1) / lon;
+	JobSystem::shared().parallelFor(0, lat, row_grain,
+		[=](unsigned int row_begin, unsigned int row_end)
 		{
-			float alpha = col * 2 * PI / lon;
-			float cos_alpha = cos(alpha);
-			float sin_alpha = sin(alpha);
-			Vector4f v = {r*cos_alpha, y, r * sin_alpha, 0};
-			vertex_array[i] = v.x();
-			vertex_array[i+1] = v.y();
-			vertex_array[i+2] = v.z();
-			v *= (1/v.length());
-			vertex_normal_array[i++] = v.x();
-			vertex_normal_array[i++] = v.y();
-			vertex_normal_array[i++] = v.z();
-		}
-	}
+			for (int row = row_begin ; row < (int)row_end ; row++)
+			{
+				int k = 3 * (1 + row*lon);
+				float beta = PI/2 - (row+1) * (PI/(lat+1));
+				float y = radius * sin(beta);
+				float r = radius * cos(beta);
+				for (int col = 0 ; col < lon ; col++)
+				{
+					float alpha = col * 2 * PI / lon;
+					float cos_alpha = cos(alpha);
+					float sin_alpha = sin(alpha);
+					Vector4f v = {r*cos_alpha, y, r * sin_alpha, 0};
+					vertex_array[k] = v.x();
+					vertex_array[k+1] = v.y();
+					vertex_array[k+2] = v.z();
+					v *= (1/v.length());
+					vertex_normal_array[k++] = v.x();
+					vertex_normal_array[k++] = v.y();
+					vertex_normal_array[k++] = v.z();
+				}
+			}
+		});
+	i += 3 * lat * lon;
 
 	// build last vertex : bottom of sphere
 	vertex_array[i] = 0.0f;
@@ -145,11 +160,18 @@ Model model::Sphere(float radius, int lat, int lon)
 
 	Sphere_D( "SPHERE: " << i/3 << " triangles built" << std::endl);
 
-	// construct model
-	Model m(nVertices, nTriangles, vertex_array, vertex_normal_array, index_array);
+	// hand the arrays over to the mesh data
+	return builder.buildMesh();
+}
+
+Model model::Sphere(float radius, int lat, int lon)
+{
+	if (radius <= 0 || lat < 1 || lon < 3)
+		return Model();
 
-	delete[] vertex_array;
-	delete[] vertex_normal_array;
-	delete[] index_array;
-	return m;
+	// optimized meshes have another order, keep them apart
+	MeshCache::Key key(MeshCache::SPHERE, {radius, (float)lat, (float)lon,
+			MeshOptimizer::isAutomatic() ? 1.0f : 0.0f});
+	return Model(MeshCache::shared().get(key,
+			[=]() { return generate_sphere(radius, lat, lon); }));
 }
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "SphereEntity.h"
+#include "Sphere.h"
+
+using namespace giselle;
+using namespace scene;
+using namespace model;
+using namespace math;
+
+SphereEntity::SphereEntity( float radius, const Material& material,
+	const Vector4f& pos, const Vector4f& ang, const std::list<Entity*> & children )
+:	PrimitiveEntity(material,pos,ang,children)
+,	radius(radius > 0.0f ? radius : 1.0f)
+{
+}
+
+SphereEntity::~SphereEntity()
+{
+}
+
+void SphereEntity::setRadius(float radius)
+{
+	if (radius <= 0.0f || radius == this->radius) return;
+	this->radius = radius;
+	this->invalidate();
+}
+
+float SphereEntity::getRadius(void) const
+{
+	return this->radius;
+}
+
+bool SphereEntity::getBounds(Vector4f& min, Vector4f& max) const
+{
+	min = Vector4f(-this->radius, -this->radius, -this->radius);
+	max = Vector4f(this->radius, this->radius, this->radius);
+	return true;
+}
+
+Model SphereEntity::generate(unsigned int segments) const
+{
+	return Sphere(this->radius, segments / 2 - 1, segments);
+}
+
+float SphereEntity::curve_radius(void) const
+{
+	return this->radius;
+}
@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "StatsExporter.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstring>
+#include <new>
+
+using namespace giselle;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2,
+		"the ring is shared between processes, its atomics must be lock-free");
+
+static const std::uint32_t RING_MAGIC = 0x47535452; // "GSTR"
+static const std::uint32_t RING_VERSION = 1;
+
+struct StatsExporter::Header
+{
+	std::uint32_t magic;
+	std::uint32_t version;
+	std::uint32_t capacity;
+	std::uint32_t record_size;
+	std::atomic<std::uint64_t> written; // records published
+};
+
+struct StatsExporter::Slot
+{
+	// 2n+1 while record n is being written, 2n+2 once it is complete
+	std::atomic<std::uint64_t> sequence;
+	Record record;
+};
+
+std::size_t StatsExporter::ring_size(unsigned int capacity)
+{
+	return sizeof(Header) + capacity * sizeof(Slot);
+}
+
+StatsExporter::StatsExporter(void)
+:	p_map(nullptr)
+,	map_size(0)
+,	written(0)
+{}
+
+StatsExporter::~StatsExporter(void)
+{
+	this->close();
+}
+
+bool StatsExporter::open(const std::string& name, unsigned int capacity)
+{
+	this->close();
+	if (capacity == 0) return false;
+
+	shm_unlink(name.c_str());
+	int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	if (fd < 0) return false;
+
+	const std::size_t size = ring_size(capacity);
+	void* p = MAP_FAILED;
+	if (ftruncate(fd, size) == 0)
+		p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (p == MAP_FAILED)
+	{
+		shm_unlink(name.c_str());
+		return false;
+	}
+
+	Header* p_header = new (p) Header;
+	p_header->version = RING_VERSION;
+	p_header->capacity = capacity;
+	p_header->record_size = sizeof(Record);
+	p_header->written.store(0, std::memory_order_relaxed);
+	Slot* slots = reinterpret_cast<Slot*>(p_header + 1);
+	for (unsigned int i = 0 ; i < capacity ; i++)
+		new (slots + i) Slot;
+	for (unsigned int i = 0 ; i < capacity ; i++)
+		slots[i].sequence.store(0, std::memory_order_relaxed);
+	// readers only accept the ring once it is complete
+	std::atomic_thread_fence(std::memory_order_release);
+	p_header->magic = RING_MAGIC;
+
+	this->p_map = p;
+	this->map_size = size;
+	this->name = name;
+	this->written = 0;
+	return true;
+}
+
+void StatsExporter::close(void)
+{
+	if (this->p_map == nullptr) return;
+	munmap(this->p_map, this->map_size);
+	shm_unlink(this->name.c_str());
+	this->p_map = nullptr;
+	this->map_size = 0;
+	this->name.clear();
+	this->written = 0;
+}
+
+bool StatsExporter::isOpen(void) const
+{
+	return this->p_map != nullptr;
+}
+
+void StatsExporter::publish(const FrameStats& stats, const FrameProfiler::FrameTimes& times)
+{
+	if (this->p_map == nullptr) return;
+
+	Header* p_header = static_cast<Header*>(this->p_map);
+	Slot* slots = reinterpret_cast<Slot*>(p_header + 1);
+	const std::uint64_t n = this->written;
+	Slot& slot = slots[n % p_header->capacity];
+
+	slot.sequence.store(2 * n + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	Record& r = slot.record;
+	r.frame = n;
+	r.time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	for (unsigned int c = 0 ; c < FrameStats::COUNTER_COUNT ; c++)
+		r.counters[c] = stats.get(static_cast<FrameStats::Counter>(c));
+	r.timed_frame = times.frame;
+	for (unsigned int z = 0 ; z < FrameProfiler::ZONE_COUNT ; z++)
+	{
+		r.cpu_ms[z] = times.cpu_ms[z];
+		r.gpu_ms[z] = times.gpu_ms[z];
+	}
+	r.cpu_total_ms = times.cpu_total_ms;
+	r.gpu_total_ms = times.gpu_total_ms;
+	r.gpu_valid = times.gpu_valid ? 1 : 0;
+
+	slot.sequence.store(2 * n + 2, std::memory_order_release);
+	p_header->written.store(n + 1, std::memory_order_release);
+	this->written = n + 1;
+}
+
+const std::string& StatsExporter::getName(void) const
+{
+	return this->name;
+}
+
+StatsExporter::Reader::Reader(void)
+:	p_map(nullptr)
+,	map_size(0)
+,	next(0)
+,	lost(0)
+{}
+
+StatsExporter::Reader::~Reader(void)
+{
+	this->close();
+}
+
+bool StatsExporter::Reader::open(const std::string& name)
+{
+	this->close();
+	int fd = shm_open(name.c_str(), O_RDONLY, 0);
+	if (fd < 0) return false;
+
+	struct stat st;
+	void* p = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && (std::size_t)st.st_size >= sizeof(Header))
+		p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (p == MAP_FAILED) return false;
+
+	const Header* p_header = static_cast<const Header*>(p);
+	const bool valid = p_header->magic == RING_MAGIC
+			&& p_header->version == RING_VERSION
+			&& p_header->record_size == sizeof(Record)
+			&& p_header->capacity > 0
+			&& ring_size(p_header->capacity) <= (std::size_t)st.st_size;
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (!valid)
+	{
+		munmap(p, st.st_size);
+		return false;
+	}
+
+	this->p_map = p;
+	this->map_size = st.st_size;
+	const std::uint64_t written = p_header->written.load(std::memory_order_acquire);
+	this->next = (written > p_header->capacity) ? written - p_header->capacity : 0;
+	this->lost = 0;
+	return true;
+}
+
+void StatsExporter::Reader::close(void)
+{
+	if (this->p_map == nullptr) return;
+	munmap(this->p_map, this->map_size);
+	this->p_map = nullptr;
+	this->map_size = 0;
+}
+
+bool StatsExporter::Reader::isOpen(void) const
+{
+	return this->p_map != nullptr;
+}
+
+bool StatsExporter::Reader::read(Record& record)
+{
+	if (this->p_map == nullptr) return false;
+
+	const Header* p_header = static_cast<const Header*>(this->p_map);
+	const Slot* slots = reinterpret_cast<const Slot*>(p_header + 1);
+	const std::uint64_t capacity = p_header->capacity;
+
+	for (;;)
+	{
+		const std::uint64_t written = p_header->written.load(std::memory_order_acquire);
+		if (this->next >= written) return false;
+		if (written - this->next > capacity)
+		{ // lapped by the writer, skip to the oldest record left
+			this->lost += written - capacity - this->next;
+			this->next = written - capacity;
+		}
+
+		const Slot& slot = slots[this->next % capacity];
+		const std::uint64_t expected = 2 * this->next + 2;
+		if (slot.sequence.load(std::memory_order_acquire) == expected)
+		{
+			std::memcpy(&record, &slot.record, sizeof(Record));
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.sequence.load(std::memory_order_relaxed) == expected)
+			{
+				this->next++;
+				return true;
+			}
+		}
+		// overwritten before or while it was read
+		this->lost++;
+		this->next++;
+	}
+}
+
+std::uint64_t StatsExporter::Reader::getLost(void) const
+{
+	return this->lost;
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "TraceRecorder.h"
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+using namespace giselle;
+
+typedef std::chrono::steady_clock Clock;
+
+struct TraceRecorder::Event
+{
+	const char* name;
+	const char* category;
+	std::uint64_t ts_ns;
+	char phase; // 'B' or 'E'
+};
+
+// single producer (the owning thread), single consumer (flush)
+struct TraceRecorder::ThreadBuffer
+{
+	unsigned int tid;
+	std::atomic<std::uint64_t> head; // next event to write
+	std::atomic<std::uint64_t> tail; // next event to flush
+	Event events[THREAD_CAPACITY];
+
+	ThreadBuffer(unsigned int tid)
+	:	tid(tid)
+	,	head(0)
+	,	tail(0)
+	{}
+};
+
+std::atomic<bool> TraceRecorder::enabled(false);
+
+static const Clock::time_point origin = Clock::now();
+static std::atomic<std::uint64_t> dropped(0);
+
+static std::mutex registry_mutex;
+
+void TraceRecorder::setEnabled(bool enabled)
+{
+	TraceRecorder::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void TraceRecorder::begin(const char* name, const char* category)
+{
+	record(name, category, 'B');
+}
+
+void TraceRecorder::end(const char* name, const char* category)
+{
+	record(name, category, 'E');
+}
+
+std::uint64_t TraceRecorder::getDroppedEvents(void)
+{
+	return dropped.load(std::memory_order_relaxed);
+}
+
+std::vector<TraceRecorder::ThreadBuffer*>& TraceRecorder::registry(void)
+{
+	// buffers live as long as the program: threads may exit before the next flush
+	static std::vector<ThreadBuffer*> buffers;
+	return buffers;
+}
+
+TraceRecorder::ThreadBuffer& TraceRecorder::thread_buffer(void)
+{
+	static thread_local ThreadBuffer* p_buffer = nullptr;
+	if (p_buffer == nullptr)
+	{
+		std::lock_guard<std::mutex> lock(registry_mutex);
+		p_buffer = new ThreadBuffer(registry().size());
+		registry().push_back(p_buffer);
+	}
+	return *p_buffer;
+}
+
+void TraceRecorder::record(const char* name, const char* category, char phase)
+{
+	ThreadBuffer& b = thread_buffer();
+	const std::uint64_t h = b.head.load(std::memory_order_relaxed);
+	if (h - b.tail.load(std::memory_order_acquire) >= THREAD_CAPACITY)
+	{
+		dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	Event& e = b.events[h % THREAD_CAPACITY];
+	e.name = name;
+	e.category = category;
+	e.ts_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			Clock::now() - origin).count();
+	e.phase = phase;
+	b.head.store(h + 1, std::memory_order_release);
+}
+
+// write a JSON string, escaping what needs to be
+static void write_string(std::ostream& out, const char* s)
+{
+	out << '"';
+	for ( ; *s != '\0' ; s++)
+	{
+		const char c = *s;
+		if (c == '"' || c == '\\')
+			out << '\\' << c;
+		else if ((unsigned char)c < 0x20)
+			out << ' ';
+		else
+			out << c;
+	}
+	out << '"';
+}
+
+bool TraceRecorder::flush(std::ostream& out)
+{
+	std::lock_guard<std::mutex> lock(registry_mutex);
+
+	out << "{\"traceEvents\":[";
+	bool first = true;
+	for (ThreadBuffer* p_b : registry())
+	{
+		const std::uint64_t h = p_b->head.load(std::memory_order_acquire);
+		const std::uint64_t t = p_b->tail.load(std::memory_order_relaxed);
+		for (std::uint64_t i = t ; i < h ; i++)
+		{
+			const Event& e = p_b->events[i % THREAD_CAPACITY];
+			out << (first ? "\n" : ",\n") << "{\"name\":";
+			write_string(out, e.name);
+			out << ",\"cat\":";
+			write_string(out, e.category);
+			// timestamps in microseconds
+			out << ",\"ph\":\"" << e.phase << "\",\"ts\":" << e.ts_ns / 1000
+				<< '.' << (char)('0' + e.ts_ns / 100 % 10) << (char)('0' + e.ts_ns / 10 % 10)
+				<< (char)('0' + e.ts_ns % 10)
+				<< ",\"pid\":1,\"tid\":" << p_b->tid << '}';
+			first = false;
+		}
+		p_b->tail.store(h, std::memory_order_release);
+	}
+	out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+	return out.good();
+}
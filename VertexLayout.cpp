@@ -0,0 +1,443 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "VertexLayout.h"
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+using namespace giselle::model;
+
+const VertexLayout VertexLayout::INTERLEAVED(VertexLayout::FLOAT, VertexLayout::FLOAT,
+		VertexLayout::NONE, VertexLayout::NONE, true);
+const VertexLayout VertexLayout::PLANAR(VertexLayout::FLOAT, VertexLayout::FLOAT,
+		VertexLayout::NONE, VertexLayout::NONE, false);
+const VertexLayout VertexLayout::COMPACT(VertexLayout::FLOAT, VertexLayout::SNORM8,
+		VertexLayout::NONE, VertexLayout::NONE, true);
+const VertexLayout VertexLayout::QUANTIZED(VertexLayout::BOUNDS16, VertexLayout::OCT16,
+		VertexLayout::NONE, VertexLayout::NONE, true);
+
+static const unsigned int COMPONENTS[VertexLayout::ATTRIBUTE_COUNT] = { 3, 3, 2, 4 };
+
+// default value of the components of absent attributes
+static const float DEFAULTS[VertexLayout::ATTRIBUTE_COUNT][4] =
+{
+	{ 0.0f, 0.0f, 0.0f, 0.0f },
+	{ 0.0f, 0.0f, 1.0f, 0.0f },
+	{ 0.0f, 0.0f, 0.0f, 0.0f },
+	{ 1.0f, 1.0f, 1.0f, 1.0f }
+};
+
+// bytes of an attribute value, before padding
+static unsigned int value_size(VertexLayout::Format format, unsigned int components)
+{
+	switch (format)
+	{
+		case VertexLayout::FLOAT: return 4 * components;
+		case VertexLayout::HALF:
+		case VertexLayout::SNORM16:
+		case VertexLayout::UNORM16:
+		case VertexLayout::BOUNDS16: return 2 * components;
+		case VertexLayout::SNORM8:
+		case VertexLayout::UNORM8: return components;
+		case VertexLayout::OCT16:
+		case VertexLayout::SNORM10: return 4;
+		default: return 0;
+	}
+}
+
+static std::uint16_t float_to_half(float f)
+{
+	std::uint32_t x;
+	memcpy(&x, &f, sizeof(x));
+	const std::uint16_t sign = (x >> 16) & 0x8000;
+	const int exp = (int)((x >> 23) & 0xff) - 127 + 15;
+	std::uint32_t mant = x & 0x7fffff;
+
+	if (((x >> 23) & 0xff) == 0xff) // infinity or NaN
+		return sign | 0x7c00 | (mant ? 0x200 : 0);
+	if (exp >= 31) // overflow, to infinity
+		return sign | 0x7c00;
+	if (exp <= 0)
+	{ // subnormal or zero
+		if (exp < -10) return sign;
+		mant |= 0x800000;
+		const unsigned int shift = 14 - exp;
+		std::uint16_t h = (std::uint16_t)(mant >> shift);
+		if ((mant >> (shift - 1)) & 1) h++; // round
+		return sign | h;
+	}
+	std::uint16_t h = sign | (std::uint16_t)(exp << 10) | (std::uint16_t)(mant >> 13);
+	if (mant & 0x1000) h++; // round, carrying into the exponent if needed
+	return h;
+}
+
+static float half_to_float(std::uint16_t h)
+{
+	const std::uint32_t sign = (std::uint32_t)(h & 0x8000) << 16;
+	const int exp = (h >> 10) & 0x1f;
+	const std::uint32_t mant = h & 0x3ff;
+	std::uint32_t x;
+	if (exp == 0)
+	{
+		if (mant == 0) x = sign;
+		else
+		{ // subnormal, normalize it
+			float f = std::ldexp((float)mant, -24);
+			return (h & 0x8000) ? -f : f;
+		}
+	}
+	else if (exp == 31)
+		x = sign | 0x7f800000 | (mant << 13);
+	else
+		x = sign | ((std::uint32_t)(exp - 15 + 127) << 23) | (mant << 13);
+	float f;
+	memcpy(&f, &x, sizeof(f));
+	return f;
+}
+
+static float clamp(float v, float lo, float hi)
+{
+	return (v < lo) ? lo : ((v > hi) ? hi : v);
+}
+
+static float sign_not_zero(float v)
+{
+	return (v >= 0.0f) ? 1.0f : -1.0f;
+}
+
+static void encode_component(VertexLayout::Format format, float v, unsigned char* p)
+{
+	switch (format)
+	{
+		case VertexLayout::FLOAT:
+			memcpy(p, &v, 4);
+			break;
+		case VertexLayout::HALF:
+		{
+			std::uint16_t h = float_to_half(v);
+			memcpy(p, &h, 2);
+			break;
+		}
+		case VertexLayout::SNORM16:
+		{
+			std::int16_t s = (std::int16_t)std::lround(clamp(v, -1.0f, 1.0f) * 32767.0f);
+			memcpy(p, &s, 2);
+			break;
+		}
+		case VertexLayout::UNORM16:
+		case VertexLayout::BOUNDS16:
+		{
+			std::uint16_t u = (std::uint16_t)std::lround(clamp(v, 0.0f, 1.0f) * 65535.0f);
+			memcpy(p, &u, 2);
+			break;
+		}
+		case VertexLayout::SNORM8:
+			*(std::int8_t*)p = (std::int8_t)std::lround(clamp(v, -1.0f, 1.0f) * 127.0f);
+			break;
+		case VertexLayout::UNORM8:
+			*p = (unsigned char)std::lround(clamp(v, 0.0f, 1.0f) * 255.0f);
+			break;
+		default:
+			break;
+	}
+}
+
+static float decode_component(VertexLayout::Format format, const unsigned char* p)
+{
+	switch (format)
+	{
+		case VertexLayout::FLOAT:
+		{
+			float f;
+			memcpy(&f, p, 4);
+			return f;
+		}
+		case VertexLayout::HALF:
+		{
+			std::uint16_t h;
+			memcpy(&h, p, 2);
+			return half_to_float(h);
+		}
+		case VertexLayout::SNORM16:
+		{
+			std::int16_t s;
+			memcpy(&s, p, 2);
+			return (s < -32767) ? -1.0f : s / 32767.0f;
+		}
+		case VertexLayout::UNORM16:
+		case VertexLayout::BOUNDS16:
+		{
+			std::uint16_t u;
+			memcpy(&u, p, 2);
+			return u / 65535.0f;
+		}
+		case VertexLayout::SNORM8:
+		{
+			std::int8_t s = *(const std::int8_t*)p;
+			return (s < -127) ? -1.0f : s / 127.0f;
+		}
+		case VertexLayout::UNORM8:
+			return *p / 255.0f;
+		default:
+			return 0.0f;
+	}
+}
+
+// encodes the n components of an attribute value
+static void encode(VertexLayout::Format format, const float* v, unsigned int n,
+		const float* bounds, unsigned char* p)
+{
+	switch (format)
+	{
+		case VertexLayout::BOUNDS16:
+			for (unsigned int c = 0 ; c < n ; c++)
+			{
+				const float extent = bounds[3+c] - bounds[c];
+				const float t = (extent > 0.0f) ? (v[c] - bounds[c]) / extent : 0.0f;
+				encode_component(format, t, p + 2*c);
+			}
+			break;
+		case VertexLayout::OCT16:
+		{ // project on the octahedron, then fold the lower half over the upper
+			const float l1 = std::fabs(v[0]) + std::fabs(v[1]) + std::fabs(v[2]);
+			float x = (l1 > 0.0f) ? v[0] / l1 : 0.0f;
+			float y = (l1 > 0.0f) ? v[1] / l1 : 0.0f;
+			if (v[2] < 0.0f)
+			{
+				const float fx = (1.0f - std::fabs(y)) * sign_not_zero(x);
+				const float fy = (1.0f - std::fabs(x)) * sign_not_zero(y);
+				x = fx;
+				y = fy;
+			}
+			encode_component(VertexLayout::SNORM16, x, p);
+			encode_component(VertexLayout::SNORM16, y, p + 2);
+			break;
+		}
+		case VertexLayout::SNORM10:
+		{
+			std::uint32_t packed = 0;
+			for (unsigned int c = 0 ; c < n && c < 3 ; c++)
+			{
+				const std::int32_t q = (std::int32_t)std::lround(clamp(v[c], -1.0f, 1.0f) * 511.0f);
+				packed |= ((std::uint32_t)q & 0x3ff) << (10*c);
+			}
+			memcpy(p, &packed, 4);
+			break;
+		}
+		default:
+		{
+			const unsigned int size = value_size(format, 1);
+			for (unsigned int c = 0 ; c < n ; c++)
+				encode_component(format, v[c], p + size*c);
+			break;
+		}
+	}
+}
+
+// decodes the n components of an attribute value
+static void decode(VertexLayout::Format format, const unsigned char* p, unsigned int n,
+		const float* bounds, float* v)
+{
+	switch (format)
+	{
+		case VertexLayout::BOUNDS16:
+			for (unsigned int c = 0 ; c < n ; c++)
+				v[c] = bounds[c] + decode_component(format, p + 2*c) * (bounds[3+c] - bounds[c]);
+			break;
+		case VertexLayout::OCT16:
+		{
+			float x = decode_component(VertexLayout::SNORM16, p);
+			float y = decode_component(VertexLayout::SNORM16, p + 2);
+			const float z = 1.0f - std::fabs(x) - std::fabs(y);
+			if (z < 0.0f)
+			{
+				const float fx = (1.0f - std::fabs(y)) * sign_not_zero(x);
+				const float fy = (1.0f - std::fabs(x)) * sign_not_zero(y);
+				x = fx;
+				y = fy;
+			}
+			const float len = std::sqrt(x*x + y*y + z*z);
+			v[0] = x / len;
+			v[1] = y / len;
+			v[2] = z / len;
+			for (unsigned int c = 3 ; c < n ; c++)
+				v[c] = 0.0f;
+			break;
+		}
+		case VertexLayout::SNORM10:
+		{
+			std::uint32_t packed;
+			memcpy(&packed, p, 4);
+			for (unsigned int c = 0 ; c < n ; c++)
+			{
+				std::int32_t q = (c < 3) ? (std::int32_t)((packed >> (10*c)) & 0x3ff) : 0;
+				if (q & 0x200) q -= 0x400; // sign extension
+				v[c] = (q < -511) ? -1.0f : q / 511.0f;
+			}
+			break;
+		}
+		default:
+		{
+			const unsigned int size = value_size(format, 1);
+			for (unsigned int c = 0 ; c < n ; c++)
+				v[c] = decode_component(format, p + size*c);
+			break;
+		}
+	}
+}
+
+VertexLayout::VertexLayout(void)
+:	interleaved(true)
+{
+	this->formats[POSITION] = FLOAT;
+	this->formats[NORMAL] = FLOAT;
+	this->formats[TEXCOORD] = NONE;
+	this->formats[COLOR] = NONE;
+}
+
+VertexLayout::VertexLayout(Format position, Format normal, Format texcoord, Format color,
+		bool interleaved)
+:	interleaved(interleaved)
+{
+	this->formats[POSITION] = position;
+	this->formats[NORMAL] = normal;
+	this->formats[TEXCOORD] = texcoord;
+	this->formats[COLOR] = color;
+}
+
+bool VertexLayout::has(Attribute attribute) const
+{
+	return this->formats[attribute] != NONE;
+}
+
+unsigned int VertexLayout::components(Attribute attribute)
+{
+	return COMPONENTS[attribute];
+}
+
+unsigned int VertexLayout::elementSize(Attribute attribute) const
+{
+	const unsigned int bytes = value_size(this->formats[attribute], COMPONENTS[attribute]);
+	return (bytes + 3) & ~3u;
+}
+
+unsigned int VertexLayout::stride(Attribute attribute) const
+{
+	if (!this->interleaved)
+		return this->elementSize(attribute);
+
+	unsigned int total = 0;
+	for (unsigned int a = 0 ; a < ATTRIBUTE_COUNT ; a++)
+		total += this->elementSize((Attribute)a);
+	return total;
+}
+
+std::size_t VertexLayout::offset(Attribute attribute, unsigned int nVertices) const
+{
+	std::size_t total = 0;
+	for (unsigned int a = 0 ; a < (unsigned int)attribute ; a++)
+	{
+		const std::size_t size = this->elementSize((Attribute)a);
+		total += this->interleaved ? size : size * nVertices;
+	}
+	return total;
+}
+
+std::size_t VertexLayout::size(unsigned int nVertices) const
+{
+	std::size_t total = 0;
+	for (unsigned int a = 0 ; a < ATTRIBUTE_COUNT ; a++)
+		total += this->elementSize((Attribute)a);
+	return total * nVertices;
+}
+
+VertexLayout VertexLayout::planarFloat(void) const
+{
+	VertexLayout layout(*this);
+	layout.interleaved = false;
+	for (unsigned int a = 0 ; a < ATTRIBUTE_COUNT ; a++)
+		if (layout.formats[a] != NONE) layout.formats[a] = FLOAT;
+	return layout;
+}
+
+bool VertexLayout::isQuantized(void) const
+{
+	return this->formats[POSITION] == BOUNDS16 || this->formats[NORMAL] == OCT16;
+}
+
+bool VertexLayout::operator==(const VertexLayout& other) const
+{
+	for (unsigned int a = 0 ; a < ATTRIBUTE_COUNT ; a++)
+		if (this->formats[a] != other.formats[a]) return false;
+	return this->interleaved == other.interleaved;
+}
+
+bool VertexLayout::operator!=(const VertexLayout& other) const
+{
+	return !(*this == other);
+}
+
+void VertexLayout::convert(const VertexLayout& from, const void* src,
+		const VertexLayout& to, void* dst, unsigned int nVertices, const float* bounds)
+{
+	if (from == to)
+	{
+		memcpy(dst, src, to.size(nVertices));
+		return;
+	}
+
+	const unsigned char* in = static_cast<const unsigned char*>(src);
+	unsigned char* out = static_cast<unsigned char*>(dst);
+	for (unsigned int a = 0 ; a < ATTRIBUTE_COUNT ; a++)
+	{
+		const Attribute attr = (Attribute)a;
+		if (!to.has(attr)) continue;
+
+		const Format in_format = from.formats[a];
+		const Format out_format = to.formats[a];
+		const unsigned int n = COMPONENTS[a];
+		const unsigned int in_stride = from.stride(attr);
+		const unsigned int out_stride = to.stride(attr);
+		const unsigned char* p_in = in + from.offset(attr, nVertices);
+		unsigned char* p_out = out + to.offset(attr, nVertices);
+		const unsigned int used = value_size(out_format, n);
+		const unsigned int padding = to.elementSize(attr) - used;
+
+		float value[4];
+		for (unsigned int v = 0 ; v < nVertices ; v++)
+		{
+			if (in_format != NONE)
+				decode(in_format, p_in, n, bounds, value);
+			else
+				memcpy(value, DEFAULTS[a], sizeof(value));
+			encode(out_format, value, n, bounds, p_out);
+			if (padding > 0)
+				memset(p_out + used, 0, padding);
+			p_in += in_stride;
+			p_out += out_stride;
+		}
+	}
+}
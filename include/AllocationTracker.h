@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file AllocationTracker.h
+ * \class giselle::AllocationTracker
+ *
+ * \brief Counting of heap allocations
+ *
+ * When the library is built with \c GISELLE_TRACK_ALLOCATIONS defined, it replaces the
+ * global \c operator \c new and \c operator \c delete with versions that count every
+ * allocation of the process, and report it to an optional listener. Without it, the
+ * tracker is inert and its counters stay at zero (see \c isTracking() ).
+ *
+ * A <b>GContext</b> reports the allocations made during each \c render() call in its
+ * \c FrameStats, on all threads. Rendering a scene that does not change is meant to
+ * allocate nothing once the first frames have sized the context's buffers.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace giselle
+{
+
+	class AllocationTracker
+	{
+		public:
+			/** Totals since the start of the process */
+			struct Counters
+			{
+				/** number of allocations */
+				std::uint64_t allocations;
+				/** number of deallocations */
+				std::uint64_t deallocations;
+				/** number of bytes allocated */
+				std::uint64_t bytes;
+			};
+
+			/**
+			 * \brief Receives the allocations of the process
+			 *
+			 * The listener is called from within \c operator \c new and
+			 * \c operator \c delete, on the allocating thread. Allocations made by
+			 * the listener itself are counted but not reported to it.
+			 */
+			class Listener
+			{
+				public:
+					virtual ~Listener(void) {}
+
+					/**
+					 * Called after each allocation.
+					 * \param size the number of bytes allocated
+					 */
+					virtual void allocated(std::size_t size) = 0;
+
+					/** Called before each deallocation of a non-null pointer */
+					virtual void deallocated(void) = 0;
+			};
+
+			/** \return whether the library was built to count allocations */
+			static bool isTracking(void);
+
+			/** \return the totals since the start of the process */
+			static Counters getCounters(void);
+
+			/**
+			 * Sets the listener of the allocations. The listener must outlive its
+			 * use, and be thread-safe if threads other than the caller allocate.
+			 * \param p_listener the listener, or null for none
+			 */
+			static void setListener(Listener* p_listener);
+	};
+
+};
@@ -58,7 +58,8 @@ namespace giselle
 	namespace model
 	{
 		/**
-		 * Builds a model with the shape of a box.
+		 * Builds a model with the shape of a box. Boxes with the same arguments
+		 * share their mesh data (see \c MeshCache ).
 		 * \param x1 the X position of the box's left face
 		 * \param x2 the X position of the box's right face
 		 * \param y1 the Y position of the box's bottom face
@@ -138,6 +138,13 @@ class Camera : public scene::Entity
 		 */
 		bool setRange(float near, float far);
 
+		/**
+		 * Gets the view volume range of the camera.
+		 * \param near output reference to the near factor of the view volume
+		 * \param far output reference to the far factor of the view volume
+		 */
+		void getRange(float& near, float& far) const;
+
 		/**
 		 * Redefines the aspect ratio of the camera. The resulting aspect
 		 * ratio value of \c w/h is used.
@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file ClusteredLighting.h
+ * \class giselle::ClusteredLighting
+ *
+ * \brief CPU light assignment for clustered forward shading
+ *
+ * The view frustum of the camera is divided into a grid of clusters: tiles of the
+ * screen, each split in slices of view depth with exponentially growing thickness.
+ * Every frame, each point light is assigned to the clusters its sphere of influence
+ * touches, and a list of light indices is built per cluster. Fragments then only
+ * shade the lights of their own cluster, instead of every light of the scene.
+ *
+ * The slices are assigned in parallel on the shared job system. The distance tests
+ * of a light against four tiles at a time use SSE2 when available.
+ *
+ * The sphere of influence of a light ends where its attenuated intensity falls
+ * below \c LIGHT_CUTOFF. Directional lights and lights without attenuation reach
+ * every cluster; they are kept at the beginning of the index list instead of
+ * being repeated in every cluster (see \c getGlobalCount() ).
+ *
+ * A <b>GContext</b> uses it when enabled with \c setClusteredLighting().
+ */
+#pragma once
+
+#include <vector>
+
+#include "Mat4x4f.h"
+
+namespace giselle
+{
+
+	class ClusteredLighting
+	{
+		private:
+			struct ViewLight
+			{
+				float x, y, d, r;  // view-space center (d = depth), radius
+				unsigned int index;
+				int s0, s1;        // range of slices touched
+			};
+
+			unsigned int tiles_x, tiles_y, slices;
+			unsigned int stride_x; // tiles_x rounded up to a multiple of 4
+			float depth_scale, depth_bias;
+			bool perspective;
+			float scale_x, scale_y; // projection scale of x and y
+
+			std::vector<ViewLight> lights;     // reused across frames
+			std::vector<float> col_min, col_max; // per slice and column
+			std::vector<float> row_min, row_max; // per slice and row
+			std::vector<float> slice_near, slice_far;
+			std::vector<std::vector<unsigned int>> pairs; // per slice: (tile, light)
+			std::vector<unsigned int> slice_offset;
+			std::vector<unsigned int> grid;
+			std::vector<unsigned int> indices;
+			unsigned int n_global;
+
+		public:
+			/**
+			 * Builds a cluster grid.
+			 * \param tiles_x the number of columns of screen tiles, at most \c MAX_TILES
+			 * \param tiles_y the number of rows of screen tiles, at most \c MAX_TILES
+			 * \param slices the number of depth slices
+			 */
+			ClusteredLighting(unsigned int tiles_x = ClusteredLighting::DEFAULT_TILES_X,
+							unsigned int tiles_y = ClusteredLighting::DEFAULT_TILES_Y,
+							unsigned int slices = ClusteredLighting::DEFAULT_SLICES);
+
+			/**
+			 * Assigns the lights of a frame to the clusters.
+			 * \param view the view matrix of the camera
+			 * \param proj the projection matrix of the camera
+			 * \param perspective whether the projection is a perspective one
+			 * \param near the distance of the camera's near plane
+			 * \param far the distance of the camera's far plane
+			 * \param light_pos 4 floats per light: the world position, or the
+			 * direction with \c w = 0 for directional lights
+			 * \param light_color 4 floats per light: the color, and the quadratic
+			 * attenuation in the 4th component
+			 * \param n the number of lights
+			 */
+			void build(const math::Mat4x4f& view, const math::Mat4x4f& proj, bool perspective,
+						float near, float far,
+						const float* light_pos, const float* light_color, unsigned int n);
+
+			/** \return the number of columns of screen tiles */
+			unsigned int getTilesX(void) const;
+
+			/** \return the number of rows of screen tiles */
+			unsigned int getTilesY(void) const;
+
+			/** \return the number of depth slices */
+			unsigned int getSlices(void) const;
+
+			/** \return the number of clusters */
+			unsigned int getClusterCount(void) const;
+
+			/**
+			 * The slice of a fragment at view depth \c d is
+			 * <tt>log(d) * getDepthScale() + getDepthBias()</tt>
+			 * \return the scale of the depth slicing
+			 */
+			float getDepthScale(void) const;
+
+			/** \return the bias of the depth slicing (see \c getDepthScale() ) */
+			float getDepthBias(void) const;
+
+			/**
+			 * \return the grid of clusters: for each cluster, the offset and the
+			 * number of its lights in the index list. Cluster <tt>(x, y, z)</tt>
+			 * is at <tt>(z * getTilesY() + y) * getTilesX() + x</tt>, tile rows
+			 * starting from the bottom of the screen.
+			 */
+			const unsigned int* getGrid(void) const;
+
+			/** \return the list of light indices of all clusters */
+			const unsigned int* getIndices(void) const;
+
+			/** \return the size of the index list */
+			unsigned int getIndexCount(void) const;
+
+			/** \return the number of lights reaching every cluster, stored at the
+			 * beginning of the index list */
+			unsigned int getGlobalCount(void) const;
+
+			/**
+			 * Gets the distance at which a light's intensity falls below
+			 * \c LIGHT_CUTOFF.
+			 * \param color the light's color, with the quadratic attenuation in
+			 * the 4th component
+			 * \return the radius of the light's sphere of influence, a negative
+			 * value if the light is never attenuated
+			 */
+			static float lightRange(const float* color);
+
+			static constexpr unsigned int DEFAULT_TILES_X = 16;
+			static constexpr unsigned int DEFAULT_TILES_Y = 8;
+			static constexpr unsigned int DEFAULT_SLICES = 24;
+			static constexpr unsigned int MAX_TILES = 64;
+
+			/** Maximum number of lights, directional lights included */
+			static constexpr unsigned int MAX_LIGHTS = 65536;
+
+			/** Intensity under which a light is considered not to reach a point */
+			static constexpr float LIGHT_CUTOFF = 1.0f / 256;
+
+		private:
+			/** Calculate the view-space bounds of the clusters */
+			void calc_bounds(const math::Mat4x4f& proj, bool perspective, float near, float far);
+
+			/** Find the (tile, light) pairs of a slice */
+			void assign_slice(unsigned int s);
+	};
+
+};
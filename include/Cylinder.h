@@ -38,6 +38,7 @@ namespace model
 	 * precision</b>.
 	 *
 	 * The resulting cylinder will stand on the origin (the bottom base will contain it).
+	 * Cylinders with the same arguments share their mesh data (see \c MeshCache ).
 	 * \param radius the radius of the cylinder's bases
 	 * \param height the height of the cylinder
 	 * \param longitude_precision precision of the longitude of the cylinder
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file CylinderEntity.h
+ * \class giselle::scene::CylinderEntity
+ * \brief A cylinder tessellated to its size on screen
+ *
+ * The cylinder stands on the entity's position, as made by \c model::Cylinder(), with
+ * its segments around the bases (see <b>PrimitiveEntity</b>).
+ */
+#pragma once
+
+#include "PrimitiveEntity.h"
+
+namespace giselle
+{
+
+namespace scene
+{
+
+class CylinderEntity : public PrimitiveEntity
+{
+	private:
+		float radius;
+		float height;
+
+	public:
+		/**
+		 * The one constructor to rule them all.
+		 * \param radius the radius of the cylinder's bases, more than 0
+		 * \param height the height of the cylinder, more than 0
+		 * \param material the material of the cylinder
+		 * \param pos position
+		 * \param ang orientation
+		 * \param children list of pointers to all children entities
+		 */
+		CylinderEntity(float radius, float height,
+				const model::Material& material = model::Material::BASE,
+				const math::Vector4f& pos = math::Vector4f(),
+				const math::Vector4f& ang = math::Vector4f(),
+				const std::list<Entity*> & children = std::list<Entity*>() );
+
+		/** Default destructor */
+		virtual ~CylinderEntity();
+
+		/**
+		 * Redefines the dimensions of the cylinder.
+		 * \param radius the radius of the bases, more than 0
+		 * \param height the height, more than 0
+		 */
+		void setDimensions(float radius, float height);
+
+		/** Getter for the radius of the cylinder's bases */
+		float getRadius(void) const;
+
+		/** Getter for the height of the cylinder */
+		float getHeight(void) const;
+
+		/**
+		 * Gets the bounding box of the cylinder.
+		 * \param min output reference to the box's minimum corner
+		 * \param max output reference to the box's maximum corner
+		 * \return true
+		 */
+		virtual bool getBounds(math::Vector4f& min, math::Vector4f& max) const;
+
+	protected:
+		virtual model::Model generate(unsigned int segments) const;
+		virtual float curve_radius(void) const;
+};
+
+};
+
+};
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file DebugOutput.h
+ * \class giselle::DebugOutput
+ *
+ * \brief OpenGL debug messages routed to an application sink
+ *
+ * With the \c KHR_debug extension, the GL driver reports errors, performance warnings
+ * and other diagnostics through a callback, instead of leaving them to be polled with
+ * \c glGetError(), which stalls the driver on every call. The debug output forwards
+ * these messages to a sink of the application, and counts them by type.
+ *
+ * In the default asynchronous mode the driver may call the sink from any of its
+ * threads, some time after the offending call; calls to the sink are serialized. The
+ * synchronous mode reports each message from within the GL call that caused it,
+ * which makes the sink a good place for a breakpoint, but costs some performance.
+ *
+ * Messages can be filtered by severity and by type. The filters are applied by the
+ * driver, so filtered out messages cost nothing.
+ *
+ * While the debug output is enabled, the \c glGetError() checks of debug builds
+ * (\c _GISELLE_DEBUG ) are skipped.
+ *
+ * The debug output applies to the current GL context, which must have been
+ * initialized by a <b>GContext</b>. Drivers only guarantee messages with a debug
+ * context, but most also report them otherwise.
+ */
+#pragma once
+
+#include <functional>
+#include <atomic>
+#include <cstdint>
+
+namespace giselle
+{
+
+	class DebugOutput
+	{
+		public:
+			/** Origin of a message */
+			enum Source
+			{
+				API,
+				WINDOW_SYSTEM,
+				SHADER_COMPILER,
+				THIRD_PARTY,
+				APPLICATION,
+				OTHER_SOURCE
+			};
+
+			/** Kind of a message */
+			enum Type
+			{
+				/** an error, as \c glGetError() would report */
+				API_ERROR,
+				DEPRECATED_BEHAVIOR,
+				UNDEFINED_BEHAVIOR,
+				PORTABILITY,
+				/** the driver found a performance issue, e.g. a stall or a copy */
+				PERFORMANCE,
+				MARKER,
+				OTHER
+			};
+
+			/** Number of message types */
+			static constexpr unsigned int TYPE_COUNT = 7;
+
+			/** Importance of a message, from the least to the most important */
+			enum Severity
+			{
+				NOTIFICATION,
+				LOW,
+				MEDIUM,
+				HIGH
+			};
+
+			/** A message of the driver */
+			struct Message
+			{
+				Source source;
+				Type type;
+				Severity severity;
+				/** the driver's identifier of the message */
+				unsigned int id;
+				/** the text of the message, only valid during the call to the sink */
+				const char* text;
+			};
+
+			/** Receives the messages of the driver */
+			typedef std::function<void(const Message& message)> Sink;
+
+			/**
+			 * Starts forwarding the messages of the driver to a sink.
+			 * \param sink the sink
+			 * \param synchronous whether to report messages from within the GL
+			 * call that caused them
+			 * \return whether the GL context supports debug output
+			 */
+			static bool enable(const Sink& sink, bool synchronous = false);
+
+			/** Stops forwarding messages */
+			static void disable(void);
+
+			/** \return whether messages are being forwarded */
+			static bool isEnabled(void)
+			{
+				return enabled.load(std::memory_order_relaxed);
+			}
+
+			/**
+			 * Filters out the messages below a severity. By default, only
+			 * notifications are filtered out.
+			 * \param severity the lowest severity to forward
+			 */
+			static void setMinSeverity(Severity severity);
+
+			/**
+			 * Filters in or out the messages of a type. All types are forwarded
+			 * by default.
+			 * \param type the type of messages
+			 * \param forward whether to forward them
+			 */
+			static void setTypeEnabled(Type type, bool forward);
+
+			/**
+			 * \param type the type of messages
+			 * \return the number of messages of the type forwarded so far
+			 */
+			static std::uint64_t getMessageCount(Type type);
+
+			/** Sets the message counts back to zero */
+			static void resetCounts(void);
+
+		private:
+			static std::atomic<bool> enabled;
+
+			static void apply_filters(void);
+	};
+
+};
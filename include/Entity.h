@@ -51,12 +51,34 @@ namespace giselle
 	class GContext;
 	class Renderer;
 
+namespace model
+{
+	class Model;
+};
+
+namespace math
+{
+	class Mat4x4f;
+};
+
 namespace scene
 {
 	class Entity
 	{
 		friend class giselle::GContext;
 
+		public:
+			/** How an entity takes part in shadow mapping */
+			enum ShadowCasting
+			{
+				/** the entity casts no shadows */
+				NO_SHADOWS,
+				/** the entity casts shadows and rarely changes (the default) */
+				STATIC_SHADOWS,
+				/** the entity casts shadows and changes often */
+				DYNAMIC_SHADOWS
+			};
+
 		protected:
 			math::Vector4f pos;
 			math::Vector4f ang;
@@ -64,6 +86,8 @@ namespace scene
 		private:
 			Entity* parent;
 			std::list<Entity*> children;
+			unsigned int version;
+			ShadowCasting shadow_casting;
 
 		public:
 			/**
@@ -156,12 +180,77 @@ namespace scene
 
 			virtual void render(Renderer& renderer) const;
 
+			/**
+			 * Gets the bounding box of what the entity renders, in the entity's
+			 * own coordinate space (children not included). Entities that render
+			 * nothing have no bounds. Culling relies on these bounds, so entities
+			 * which render something should override this method.
+			 * \param min output reference to the box's minimum corner
+			 * \param max output reference to the box's maximum corner
+			 * \return whether the entity has bounds
+			 */
+			virtual bool getBounds(math::Vector4f& min, math::Vector4f& max) const;
+
+			/**
+			 * Gets the model this entity contributes as an occluder to software
+			 * occlusion culling, in the entity's own coordinate space.
+			 * \return pointer to the occluder model, \c nullptr if the entity is
+			 * not an occluder (the default)
+			 */
+			virtual const model::Model* getOccluder(void) const;
+
+			/**
+			 * Lets the entity adapt what it renders to its size on screen, such as
+			 * choosing a level of detail. \c GContext::render() calls it once per
+			 * frame, before drawing, for each entity with bounds that was not
+			 * culled; calls for different entities may run concurrently. Does
+			 * nothing by default.
+			 * \param pixels the height of the entity's bounding sphere on screen,
+			 * in pixels
+			 */
+			virtual void selectDetail(float pixels) const;
+
+			/** \return the level of detail chosen by the last \c selectDetail(),
+			 * 0 by default; data cached from the entity's geometry (such as shadow
+			 * maps) is regenerated when it changes */
+			virtual unsigned int getCurrentLevel(void) const;
+
+			/**
+			 * Flags the entity as changed, so that the data cached from it (such as
+			 * shadow maps) is regenerated. Moving or rotating the entity flags it
+			 * automatically; subclasses must call this when they change what they
+			 * render, or their position and orientation directly.
+			 */
+			void markDirty(void);
+
+			/**
+			 * \return a counter of the changes of the entity, increased by
+			 * \c markDirty()
+			 */
+			unsigned int getVersion(void) const;
+
+			/**
+			 * Defines how the entity casts shadows. Static and dynamic casters are
+			 * kept in separate shadow maps, so that changes to dynamic casters do not
+			 * regenerate the shadows of static ones.
+			 * \param mode the shadow casting mode
+			 */
+			void setShadowCasting(ShadowCasting mode);
+
+			/**
+			 * \return how the entity casts shadows
+			 */
+			ShadowCasting getShadowCasting(void) const;
+
 		protected:
 			virtual void setParent(Entity& parent_ent);
 			void setParent(std::nullptr_t);
 
 		private:
 			const Entity* getParent(void) const;
+
+			/** Accumulate the transformations from the root down to this entity */
+			void absolute_rec(math::Mat4x4f& mat, math::Vector4f& ang) const;
 	};
 };
 };
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file FrameProfiler.h
+ * \class giselle::FrameProfiler
+ *
+ * \brief CPU and GPU timing of the stages of a frame
+ *
+ * The profiler splits each frame in a few zones, one per stage of the rendering
+ * pipeline, and measures both the CPU time spent in each zone and the GPU time of
+ * the commands the zone submitted, with \c GL_TIME_ELAPSED queries.
+ *
+ * Query results are never waited for: every frame uses its own set of queries, out of
+ * a ring of \c LATENCY sets, and the results of a frame are collected once the GPU has
+ * them ready, usually one or two frames later. The timings of a frame are published
+ * as a whole (see \c getFrameTimes() ) only when its GPU times are in. When the GPU
+ * falls more than \c LATENCY frames behind, the GPU times of the oldest frame are
+ * dropped rather than waited for.
+ *
+ * Zones must not nest, and each zone is entered at most once per frame. The GPU times
+ * of the zones do not include the GPU work submitted outside of them.
+ *
+ * The zones and frames are also recorded as events of the \c TraceRecorder, in the
+ * "render" category, whenever it is recording, even with profiling disabled.
+ *
+ * One is automatically created in a <b>GContext</b>, and it is disabled by default.
+ */
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace giselle
+{
+
+	class FrameProfiler
+	{
+		public:
+			/** Stages of a frame */
+			enum Zone
+			{
+				/** flattening the scene and calculating transformations and bounds */
+				TRAVERSAL,
+				/** software and hardware occlusion culling */
+				CULLING,
+				/** packing the lights and assigning them to entities or clusters */
+				LIGHTING,
+				/** updating the shadow maps */
+				SHADOWS,
+				/** submitting the draws, from the depth pre-pass to the
+				 * occlusion queries of the next frames */
+				SUBMIT
+			};
+
+			/** Number of zones */
+			static constexpr unsigned int ZONE_COUNT = 5;
+
+			/** Timings of a frame, in milliseconds */
+			struct FrameTimes
+			{
+				/** index of the frame, counted from the first profiled frame */
+				std::uint64_t frame;
+				/** CPU time of each zone */
+				double cpu_ms[ZONE_COUNT];
+				/** CPU time of the whole frame */
+				double cpu_total_ms;
+				/** GPU time of each zone */
+				double gpu_ms[ZONE_COUNT];
+				/** sum of the GPU times of the zones */
+				double gpu_total_ms;
+				/** whether the GPU times are available; they are not when the
+				 * GPU lacks timer queries or fell too far behind */
+				bool gpu_valid;
+			};
+
+			/** Default constructor, profiling disabled */
+			FrameProfiler(void);
+
+			/** Destructor, releases all queries */
+			~FrameProfiler(void);
+
+			/** Copy constructor deleted */
+			FrameProfiler(const FrameProfiler& other) = delete;
+
+			/** Move constructor
+			 * \param other profiler to move from
+			 */
+			FrameProfiler(FrameProfiler&& other);
+
+			/** Move assignment
+			 * \param other profiler to move from
+			 */
+			FrameProfiler& operator=(FrameProfiler&& other);
+
+			/**
+			 * Enables or disables profiling. Pending results are discarded.
+			 * \param enabled whether to profile the next frames
+			 */
+			void setEnabled(bool enabled);
+
+			/** \return whether profiling is enabled */
+			bool isEnabled(void) const;
+
+			/** Starts a new frame, and collects the GPU times that came in */
+			void beginFrame(void);
+
+			/** Ends the current frame */
+			void endFrame(void);
+
+			/**
+			 * Starts measuring a zone of the current frame.
+			 * \param zone the zone
+			 */
+			void begin(Zone zone);
+
+			/**
+			 * Stops measuring a zone of the current frame.
+			 * \param zone the zone, as given to \c begin()
+			 */
+			void end(Zone zone);
+
+			/**
+			 * \return the timings of the last frame with complete results, or
+			 * all zeros (with \c frame set to \c UINT64_MAX ) if none yet
+			 */
+			const FrameTimes& getFrameTimes(void) const;
+
+			/** Number of frames of queries in flight */
+			static constexpr unsigned int LATENCY = 4;
+
+		private:
+			typedef std::chrono::steady_clock Clock;
+
+			struct Slot
+			{
+				unsigned int queries[ZONE_COUNT];
+				bool used[ZONE_COUNT]; // zones entered in the slot's frame
+				bool pending;          // waiting for the GPU times
+				FrameTimes times;
+			};
+
+			bool enabled;
+			bool timer_queries; // whether the GPU supports GL_TIME_ELAPSED
+			std::uint64_t frame;
+			int active; // zone being measured, -1 if none
+			int traced; // zone whose trace event is open, -1 if none
+			bool traced_frame; // whether the frame's trace event is open
+			Clock::time_point frame_start;
+			Clock::time_point zone_start;
+			Slot slots[LATENCY];
+			FrameTimes last;
+
+			Slot& current(void);
+			bool collect(Slot& slot);
+			void release(void);
+	};
+
+};
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file FrameStats.h
+ * \class giselle::FrameStats
+ *
+ * \brief Counters of the work submitted in a frame
+ *
+ * The counters tell the size of the scene (entities visited and culled, triangles)
+ * apart from the overhead of the renderer (draw calls, uniform uploads, program and
+ * buffer binds, bytes uploaded), so that a regression of the frame time can be traced
+ * to one or the other. All draws of the frame count, including the shadow maps, the
+ * depth pre-pass and the boxes of occlusion queries.
+ *
+ * A <b>GContext</b> collects them on every call to \c render(), and keeps the last
+ * frames in a \c FrameStatsHistory.
+ */
+#pragma once
+
+#include <cstdint>
+
+namespace giselle
+{
+
+	struct FrameStats
+	{
+		/** Identifies a counter, see \c get() */
+		enum Counter
+		{
+			DRAW_CALLS,
+			TRIANGLES,
+			ENTITIES_VISITED,
+			ENTITIES_CULLED,
+			UNIFORM_UPLOADS,
+			PROGRAM_BINDS,
+			BUFFER_BINDS,
+			BYTES_UPLOADED,
+			ALLOCATIONS,
+			ALLOCATED_BYTES
+		};
+
+		/** Number of counters */
+		static constexpr unsigned int COUNTER_COUNT = 10;
+
+		/** number of draw calls */
+		std::uint64_t draw_calls;
+		/** number of triangles drawn (see \c Model::getNTriangles() ) */
+		std::uint64_t triangles;
+		/** number of entities in the scene's tree */
+		std::uint64_t entities_visited;
+		/** number of entities skipped by occlusion culling */
+		std::uint64_t entities_culled;
+		/** number of uniform values set */
+		std::uint64_t uniform_uploads;
+		/** number of shader program switches */
+		std::uint64_t program_binds;
+		/** number of buffer object binds */
+		std::uint64_t buffer_binds;
+		/** bytes sent to the GPU: buffer contents, including the meshes
+		 * of the models drawn for the first time */
+		std::uint64_t bytes_uploaded;
+		/** number of heap allocations, on all threads; always 0 unless the
+		 * library counts them (see \c AllocationTracker ) */
+		std::uint64_t allocations;
+		/** number of bytes allocated on the heap, on all threads */
+		std::uint64_t allocated_bytes;
+
+		/** Builds a set of counters at zero */
+		FrameStats(void);
+
+		/** Sets all counters to zero */
+		void reset(void);
+
+		/**
+		 * \param counter the counter
+		 * \return the counter's value
+		 */
+		std::uint64_t get(Counter counter) const;
+	};
+
+	/**
+	 * \class giselle::FrameStatsHistory
+	 * \brief The counters of the last frames, with their averages and percentiles
+	 */
+	class FrameStatsHistory
+	{
+		public:
+			/** Builds an empty history */
+			FrameStatsHistory(void);
+
+			/**
+			 * Adds the counters of a frame, dropping the oldest frame if the
+			 * history is full.
+			 * \param stats the counters of the frame
+			 */
+			void push(const FrameStats& stats);
+
+			/** Removes all frames */
+			void clear(void);
+
+			/** \return the number of frames in the history, at most \c WINDOW */
+			unsigned int getCount(void) const;
+
+			/**
+			 * \param counter the counter
+			 * \return the average of the counter over the frames in the history,
+			 * 0 if empty
+			 */
+			double getAverage(FrameStats::Counter counter) const;
+
+			/**
+			 * Gets a percentile of a counter over the frames in the history,
+			 * with the nearest-rank method.
+			 * \param counter the counter
+			 * \param p the percentile, in [0, 100]
+			 * \return the smallest value that is not below \b p percent of the
+			 * frames' values, 0 if empty
+			 */
+			std::uint64_t getPercentile(FrameStats::Counter counter, float p) const;
+
+			/** Number of frames kept */
+			static constexpr unsigned int WINDOW = 120;
+
+		private:
+			FrameStats frames[WINDOW];
+			unsigned int next;
+			unsigned int count;
+	};
+
+};
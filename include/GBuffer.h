@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file GBuffer.h
+ * \class giselle::GBuffer
+ *
+ * \brief The geometry buffer of deferred shading
+ *
+ * The G-buffer is an off-screen framebuffer holding, for every pixel of a context's
+ * region, what the lighting passes of deferred shading need: the surface normal, the
+ * identifier of the surface's material and its depth.
+ *
+ * It is created by a <b>GContext</b> built with the \c GContext::DEFERRED shading path.
+ * Direct usage of this class is unadvised.
+ */
+#pragma once
+
+namespace giselle
+{
+
+	class GBuffer
+	{
+		private:
+			unsigned int fbo;
+			unsigned int textures[3]; // normal, material, depth
+			int width, height;
+
+		public:
+			/**
+			 * Creates the framebuffer and its textures.
+			 * \param width the width of the buffer
+			 * \param height the height of the buffer
+			 */
+			GBuffer(int width, int height);
+
+			/** Destructor. Releases the framebuffer and its textures. */
+			~GBuffer();
+
+			/** Copy constructor deleted */
+			GBuffer(const GBuffer& other) = delete;
+
+			/** \return whether the framebuffer could not be completed */
+			bool operator!(void) const;
+
+			/** \return the width of the buffer */
+			int getWidth(void) const;
+
+			/** \return the height of the buffer */
+			int getHeight(void) const;
+
+			/**
+			 * Makes the G-buffer the target of drawing and clears it. The viewport
+			 * is set to the whole buffer.
+			 */
+			void bind(void);
+
+			/** Makes the window the target of drawing again. The viewport is left
+			 * to the caller. */
+			void unbind(void);
+
+			/** \return the texture of world-space normals (RGBA16F) */
+			unsigned int getNormalTexture(void) const;
+
+			/** \return the texture of material identifiers (R32UI) */
+			unsigned int getMaterialTexture(void) const;
+
+			/** \return the depth texture */
+			unsigned int getDepthTexture(void) const;
+	};
+
+};
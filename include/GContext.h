@@ -63,6 +63,18 @@
 #include "Model.h"
 #include "Entity.h"
 #include "Renderer.h"
+#include "JobSystem.h"
+#include "RenderItem.h"
+#include "OcclusionCuller.h"
+#include "SoftwareOcclusion.h"
+#include "ClusteredLighting.h"
+#include "GBuffer.h"
+#include "ShadowMaps.h"
+#include "FrameProfiler.h"
+#include "PerfCounters.h"
+#include "FrameStats.h"
+#include "StatsExporter.h"
+#include "AllocationTracker.h"
 
 namespace giselle
 {
@@ -70,6 +82,17 @@ namespace giselle
 	class GContext
 	{
 
+	public:
+		/** Shading paths of a context, chosen at creation time */
+		enum Shading
+		{
+			/** each entity is shaded as it is drawn */
+			FORWARD,
+			/** entities are drawn to a G-buffer, and lighting is computed
+			 * in screen space afterwards (see \c GBuffer ) */
+			DEFERRED
+		};
+
 	private:
 		int error;
 		int x, y, w, h;
@@ -77,6 +100,43 @@ namespace giselle
 		scene::Camera* p_camera;
 		Renderer renderer;
 
+		std::vector<RenderItem> items; // reused across frames
+		OcclusionCuller culler;
+
+		// the camera's view of the current frame, for the level of detail tasks
+		math::Vector4f detail_eye; // absolute position
+		float detail_scale; // pixels per unit of length
+		bool detail_perspective;
+
+		bool depth_prepass;
+		// samples shaded in the shading pass, counted in segments split around
+		// the occlusion tests of the pass
+		std::vector<GLuint> overdraw_queries;
+		unsigned int overdraw_segments; // segments of the last measure
+		bool overdraw_active; // whether a segment is running
+		bool overdraw_pending;
+		float overdraw;
+
+		SoftwareOcclusion* p_occlusion; // null when disabled
+		std::vector<bool> occluder_sub; // whether each subtree has occluders
+		unsigned int sw_culled;
+
+		// the scene's lights, packed as in the renderer's "Lights" block
+		std::vector<float> light_pos, light_color, light_weight;
+
+		ClusteredLighting* p_clusters; // null when disabled
+
+		Shading shading;
+		GBuffer* p_gbuffer; // only with deferred shading
+
+		ShadowMaps* p_shadows; // null when disabled
+
+		FrameProfiler profiler;
+		PerfCounters perf_counters;
+		FrameStats frame_stats; // counters of the last frame
+		FrameStatsHistory stats_history;
+		StatsExporter* p_exporter; // null when not exporting
+
 		void init(void);
 
 	public:
@@ -98,16 +158,19 @@ namespace giselle
 		 * \param width the width of the region
 		 * \param height the height of the region
 		 * \param scene reference to the scene
+		 * \param shading the shading path of the context
 		 */
-		GContext(int x, int y, int width, int height, scene::Scene& scene);
+		GContext(int x, int y, int width, int height, scene::Scene& scene,
+				Shading shading = FORWARD);
 		/**
 		 * Builds a new graphical context using a window region and a scene,
 		 * defined in the origin: (x,y) = (0,0)
 		 * \param width the width of the region
 		 * \param height the height of the region
 		 * \param scene reference to the scene
+		 * \param shading the shading path of the context
 		 */
-		GContext(int width, int height, scene::Scene& scene);
+		GContext(int width, int height, scene::Scene& scene, Shading shading = FORWARD);
 
 		/**
 		 * Default Destructor
@@ -146,6 +209,194 @@ namespace giselle
 		 */
 		void render(bool clear = true);
 
+		/**
+		 * \return the shading path of the context
+		 */
+		Shading getShading(void) const;
+
+		/**
+		 * Enables or disables the depth pre-pass. When enabled, the scene is
+		 * first drawn with a position-only program and color writes off, then
+		 * shaded with an \c GL_EQUAL depth test, so that each pixel is shaded
+		 * at most once. This pays off in scenes with a lot of overdraw.
+		 * The setting applies from the next call to \c render() and may be
+		 * changed between frames. It has no effect with deferred shading.
+		 * Disabled by default.
+		 * \param enabled whether to render with a depth pre-pass
+		 */
+		void setDepthPrePass(bool enabled);
+
+		/**
+		 * \return whether the depth pre-pass is enabled
+		 */
+		bool getDepthPrePass(void) const;
+
+		/**
+		 * Gets the overdraw of the shading pass: the number of shaded fragments
+		 * per pixel of the context's region. The value is measured with an
+		 * occlusion query and is only read back once the GPU has it ready, so
+		 * it may lag a few frames behind.
+		 * \return the last measured overdraw, \c 0 if none is available yet
+		 */
+		float getOverdraw(void) const;
+
+		/**
+		 * Sets the occlusion culling mode of the context (see \c OcclusionCuller ).
+		 * Disabled by default.
+		 * \param mode the occlusion culling mode
+		 */
+		void setOcclusionCulling(OcclusionCuller::Mode mode);
+
+		/**
+		 * \return the occlusion culling mode of the context
+		 */
+		OcclusionCuller::Mode getOcclusionCulling(void) const;
+
+		/**
+		 * Enables or disables software occlusion culling (see
+		 * \c SoftwareOcclusion ). When enabled, the entities flagged as occluders
+		 * are rasterized on the CPU every frame, and the subtrees found hidden
+		 * behind them are not submitted for drawing. It can be combined with
+		 * hardware occlusion culling. Disabled by default.
+		 * \param enabled whether to use software occlusion culling
+		 * \param width the width of the depth buffer; its height follows the
+		 * context's aspect ratio
+		 */
+		void setSoftwareOcclusion(bool enabled,
+							unsigned int width = SoftwareOcclusion::DEFAULT_WIDTH);
+
+		/**
+		 * \return whether software occlusion culling is enabled
+		 */
+		bool getSoftwareOcclusion(void) const;
+
+		/**
+		 * \return the number of draws skipped by occlusion culling in the
+		 * last frame, both in software and in hardware
+		 * (see \c OcclusionCuller::getCulledDraws() )
+		 */
+		unsigned int getCulledDraws(void) const;
+
+		/**
+		 * Enables or disables clustered forward lighting (see
+		 * \c ClusteredLighting ). When enabled, the lights of the scene are
+		 * assigned to a grid of clusters of the view frustum every frame, and
+		 * each fragment is shaded by the lights reaching its own cluster,
+		 * rather than by the \c Scene::MAX_LIGHTS lights chosen for its entity.
+		 * This scales to hundreds of attenuated lights. It has no effect with
+		 * deferred shading, which lights each pixel once anyway. Disabled by
+		 * default. The clustered shader program is built the first time it is
+		 * enabled; \c getClusteredLighting() tells whether it could be.
+		 * \param enabled whether to use clustered lighting
+		 * \param tiles_x the number of columns of screen tiles
+		 * \param tiles_y the number of rows of screen tiles
+		 * \param slices the number of depth slices
+		 */
+		void setClusteredLighting(bool enabled,
+						unsigned int tiles_x = ClusteredLighting::DEFAULT_TILES_X,
+						unsigned int tiles_y = ClusteredLighting::DEFAULT_TILES_Y,
+						unsigned int slices = ClusteredLighting::DEFAULT_SLICES);
+
+		/**
+		 * \return whether clustered lighting is enabled
+		 */
+		bool getClusteredLighting(void) const;
+
+		/**
+		 * Enables or disables shadows (see \c ShadowMaps ). When enabled, the
+		 * lights flagged with \c Light::setCastShadows() get a shadow map, up to
+		 * \c ShadowMaps::MAX_SHADOWS of them. Shadow maps are cached and only
+		 * rendered again when their light or casters change, with static and
+		 * dynamic casters kept apart (see \c Entity::setShadowCasting() ).
+		 * Disabled by default.
+		 * \param enabled whether to render shadows
+		 * \param size the width and height of each shadow map
+		 * \return whether the shadow maps could be created, \b true when disabling
+		 */
+		bool setShadows(bool enabled, unsigned int size = ShadowMaps::DEFAULT_SIZE);
+
+		/**
+		 * \return whether shadows are enabled
+		 */
+		bool getShadows(void) const;
+
+		/**
+		 * \return the number of shadow maps rendered in the last frame, the
+		 * others being reused from previous frames
+		 */
+		unsigned int getShadowMapUpdates(void) const;
+
+		/**
+		 * Enables or disables profiling of the frames (see \c FrameProfiler ).
+		 * When enabled, each call to \c render() measures the CPU and GPU time
+		 * of its stages: traversal, culling, lighting, shadows and submission.
+		 * GPU times are read back a few frames later, without stalling.
+		 * Disabled by default.
+		 * \param enabled whether to profile the frames
+		 */
+		void setProfiling(bool enabled);
+
+		/**
+		 * \return whether profiling is enabled
+		 */
+		bool getProfiling(void) const;
+
+		/**
+		 * Gets the timings of the last profiled frame whose results are complete,
+		 * which is usually a couple of frames behind the last rendered one.
+		 * \return the timings of the frame, see \c FrameProfiler::getFrameTimes()
+		 */
+		const FrameProfiler::FrameTimes& getFrameTimes(void) const;
+
+		/**
+		 * Enables or disables the hardware performance counters of the CPU
+		 * phases of the frames (see \c PerfCounters ): scene traversal,
+		 * matrix composition and submission. Only available on Linux, and
+		 * must be called from the rendering thread. Disabled by default.
+		 * \param enabled whether to count the frames
+		 * \return whether the counters are in the requested state
+		 */
+		bool setPerfCounters(bool enabled);
+
+		/**
+		 * \return whether the hardware performance counters are enabled
+		 */
+		bool getPerfCounters(void) const;
+
+		/**
+		 * \return the hardware counts of the last rendered frame, see
+		 * \c PerfCounters::getFrameCounters()
+		 */
+		const PerfCounters::FrameCounters& getFrameCounters(void) const;
+
+		/**
+		 * \return the counters of the last rendered frame (see \c FrameStats )
+		 */
+		const FrameStats& getFrameStats(void) const;
+
+		/**
+		 * \return the counters of the last \c FrameStatsHistory::WINDOW frames,
+		 * with their rolling averages and percentiles
+		 */
+		const FrameStatsHistory& getFrameStatsHistory(void) const;
+
+		/**
+		 * Starts or stops publishing the statistics of each frame to a ring in
+		 * POSIX shared memory (see \c StatsExporter ), for other processes to
+		 * follow. Publishing never blocks the rendering. Disabled by default.
+		 * \param name the name of the shared memory object, such as
+		 * "/giselle-stats"; an empty name stops the export
+		 * \param capacity the number of frames kept in the ring
+		 * \return whether the ring could be created, \b true when stopping
+		 */
+		bool setStatsExport(const std::string& name,
+				unsigned int capacity = StatsExporter::DEFAULT_CAPACITY);
+
+		/**
+		 * \return whether the statistics of the frames are being exported
+		 */
+		bool getStatsExport(void) const;
+
 		/**
 		 * Sets the camera used for rendering in the context. This must be done before
 		 * any rendering. It is recommended that the camera entity being set is
@@ -165,12 +416,58 @@ namespace giselle
 		static constexpr int VAL_ERROR = 1;
 		static constexpr int GLEW_ERROR = 2;
 		static constexpr int SHADER_ERROR = 3;
+		static constexpr int GBUFFER_ERROR = 4;
 
 	private:
-		/** Recursively render an entity (and child entities) */
-		void render_entity_rec(const scene::Entity* p_ent, const math::Mat4x4f& mat);
+		/** Recursively flatten an entity (and child entities) into the render list */
+		void collect_rec(const scene::Entity* p_ent, int parent);
+
+		/** Calculate the model transformations of all items in the render list */
+		void update_transforms(void);
+
+		/** Rasterize the occluders and cull the render list's hidden subtrees
+		 * \param view the view matrix */
+		void software_cull(const math::Mat4x4f& view);
+
+		/** Tell the visible items of the render list their size on screen
+		 * \param cam_pos the camera's absolute position */
+		void select_detail(const math::Vector4f& cam_pos);
+
+		/** Pack the scene's lights for the renderer */
+		void pack_lights(void);
+
+		/** Choose the most influential lights of each item in the render list */
+		void select_lights(void);
+
+		/** Draw the render list to the G-buffer, then light it onto the window
+		 * \param view the view matrix */
+		void render_deferred(const math::Mat4x4f& view);
+
+		/** Render all items in the render list with the current program
+		 * \param first_pass whether this is the first pass of the frame */
+		void draw_items(bool first_pass);
+
+		/** Render the items of the render list in [begin, end[ which were not culled */
+		void draw_range(unsigned int begin, unsigned int end);
+
+		/** Collect the last overdraw measure and start a new one if possible
+		 * \return whether a query was started */
+		bool begin_overdraw_query(void);
+
+		/** End the running segment of the overdraw measure, if any */
+		void suspend_overdraw_query(void);
+
+		/** Start a new segment of the overdraw measure */
+		void resume_overdraw_query(void);
+
+		/** Publish the counters of the frame
+		 * \param allocs the allocation totals at the start of the frame */
+		void end_stats(const AllocationTracker::Counters& allocs);
+
+		/** Minimum number of entities per transformation update task */
+		static constexpr unsigned int TRANSFORM_GRAIN = 64;
 
-		static const char* const ERROR_MSGS[4];
+		static const char* const ERROR_MSGS[5];
 
 		static bool Glew_Init;
 	};
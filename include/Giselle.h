@@ -55,9 +55,10 @@
  * \subsection step3 Step 3: Linking the library with the program
  *
  * The dependencies with \a GLEW and \a GL libraries must be present, in this order, after
- * the Giselle library. This can be done in gcc using the following flags:
+ * the Giselle library. Giselle also uses threads for its job system. This can be done
+ * in gcc using the following flags:
  *
- * \c -lGiselle \c -lGLEW \c -lGL
+ * \c -lGiselle \c -lGLEW \c -lGL \c -pthread
  *
  * \subsection license License
  *
@@ -68,16 +69,41 @@
 // context
 #include "GContext.h"
 #include "Renderer.h"
+#include "JobSystem.h"
+#include "OcclusionCuller.h"
+#include "SoftwareOcclusion.h"
+#include "ClusteredLighting.h"
+#include "GBuffer.h"
+#include "ShadowMaps.h"
+#include "FrameProfiler.h"
+#include "PerfCounters.h"
+#include "TraceRecorder.h"
+#include "FrameStats.h"
+#include "StatsExporter.h"
+#include "DebugOutput.h"
+#include "AllocationTracker.h"
 
 // scene
 #include "Scene.h"
 #include "Entity.h"
 #include "SimpleModelEntity.h"
+#include "LODModelEntity.h"
+#include "PrimitiveEntity.h"
+#include "SphereEntity.h"
+#include "CylinderEntity.h"
+#include "ProceduralEntity.h"
 #include "Camera.h"
 #include "Light.h"
 
 // model
+#include "VertexLayout.h"
+#include "MeshData.h"
 #include "Model.h"
+#include "ModelBuilder.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshCache.h"
+#include "PrimitiveInstances.h"
 #include "Box.h"
 #include "Sphere.h"
 #include "Cylinder.h"
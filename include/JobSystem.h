@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file JobSystem.h
+ * \class giselle::JobSystem
+ *
+ * \brief A small work-stealing thread pool
+ *
+ * The job system owns a fixed number of worker threads, each with its own task deque.
+ * Workers take tasks from the back of their own deque and, when it runs dry, steal
+ * from the front of the other workers' deques.
+ *
+ * Tasks may depend on previously submitted tasks: a task only becomes runnable once
+ * all of its dependencies have finished. Threads waiting on a task help executing
+ * pending tasks instead of blocking.
+ *
+ * The ranges of \c parallelFor() are not split in tasks: they are published to all
+ * threads at once, and each thread claims chunks of the range until none is left.
+ * Unlike \c submit(), \c parallelFor() does not allocate.
+ *
+ * A job system with no workers is valid: every task is then executed on the thread
+ * that makes it runnable.
+ *
+ * The library uses the shared instance (see \c shared() ) for its own CPU work, such
+ * as transformation updates and primitive mesh generation. The number of workers of
+ * the shared instance can be configured before its first use with
+ * \c setSharedWorkerCount().
+ */
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstdint>
+
+namespace giselle
+{
+
+	class JobSystem
+	{
+		private:
+			struct Job;
+			struct Worker;
+			struct Range;
+
+		public:
+			/** A task to be executed by the job system */
+			typedef std::function<void(void)> Task;
+
+			/** A task over the range of indices [begin, end[ */
+			typedef std::function<void(unsigned int begin, unsigned int end)> RangeTask;
+
+			/**
+			 * \brief Handle to a submitted task
+			 *
+			 * Handles can be copied freely, and be used as dependencies of
+			 * other tasks or waited for with \c JobSystem::wait().
+			 * An empty handle is always considered done.
+			 */
+			class Handle
+			{
+				friend class giselle::JobSystem;
+				std::shared_ptr<Job> p_job;
+
+				public:
+					/** Builds an empty handle */
+					Handle(void);
+
+					/** \return whether the task has finished */
+					bool done(void) const;
+			};
+
+			/** Utilization counters of a single worker */
+			struct WorkerStats
+			{
+				/** number of tasks executed by the worker */
+				std::uint64_t tasks_executed;
+				/** number of those tasks that were stolen from another worker */
+				std::uint64_t tasks_stolen;
+				/** time spent executing tasks, in nanoseconds */
+				std::uint64_t busy_ns;
+				/** time spent waiting for tasks, in nanoseconds */
+				std::uint64_t idle_ns;
+
+				/** \return busy time over total time, in [0,1] */
+				float utilization(void) const;
+			};
+
+			/**
+			 * Builds a job system and launches its workers.
+			 * \param n_workers the number of worker threads
+			 */
+			explicit JobSystem(unsigned int n_workers = JobSystem::defaultWorkerCount());
+
+			/** Destructor. Stops and joins all workers, then runs the tasks still
+			 * queued on the calling thread. */
+			~JobSystem();
+
+			/** Copy constructor deleted */
+			JobSystem(const JobSystem& other) = delete;
+
+			/** \return the number of worker threads */
+			unsigned int getWorkerCount(void) const;
+
+			/**
+			 * Submits a new task.
+			 * \param task the task to execute
+			 * \param deps tasks that must finish before this one starts
+			 * \return a handle to the new task
+			 */
+			Handle submit(const Task& task, const std::vector<Handle>& deps = std::vector<Handle>());
+
+			/**
+			 * Waits for a task to finish. The calling thread executes other
+			 * pending tasks in the meantime.
+			 * \param handle the task to wait for
+			 */
+			void wait(const Handle& handle);
+
+			/**
+			 * Runs a task over the range [begin, end[, split in chunks of at least
+			 * \b grain indices, and waits for all of them to finish. The calling
+			 * thread takes part in the work, but only in the chunks of this range:
+			 * it never runs unrelated work that could wait on the caller itself.
+			 * Ranges no larger than \b grain are run directly on the calling thread.
+			 * \param begin the first index
+			 * \param end one past the last index
+			 * \param grain the minimum number of indices per chunk
+			 * \param task the task to run on each chunk
+			 */
+			void parallelFor(unsigned int begin, unsigned int end, unsigned int grain,
+							const RangeTask& task);
+
+			/**
+			 * Gets the utilization counters of a worker.
+			 * \param worker the worker index, in [0, getWorkerCount()[
+			 * \return a snapshot of the worker's counters
+			 */
+			WorkerStats getWorkerStats(unsigned int worker) const;
+
+			/** Resets the utilization counters of all workers. */
+			void resetStats(void);
+
+			/** \return the job system shared by the library's subsystems */
+			static JobSystem& shared(void);
+
+			/**
+			 * Defines the number of workers of the shared job system. Only
+			 * effective before the first call to \c shared().
+			 * \param n_workers the number of worker threads
+			 * \return whether the value was accepted
+			 */
+			static bool setSharedWorkerCount(unsigned int n_workers);
+
+			/** \return the number of hardware threads minus one, at least 1 */
+			static unsigned int defaultWorkerCount(void);
+
+		private:
+			std::vector<std::unique_ptr<Worker>> workers;
+			std::atomic<unsigned int> n_queued;
+			std::atomic<unsigned int> next_worker;
+			std::atomic<bool> running;
+			std::mutex sleep_mutex;
+			std::condition_variable sleep_cv;
+			std::mutex range_mutex;
+			Range* p_ranges; // ranges of parallelFor() with unclaimed chunks
+			std::atomic<unsigned int> n_ranges;
+
+			void enqueue(const std::shared_ptr<Job>& job);
+			void execute(const std::shared_ptr<Job>& job);
+			std::shared_ptr<Job> take(int self, bool& stolen);
+			void workerLoop(unsigned int index);
+
+			/** Claim a chunk of a range, the given one or else any open range
+			 * \return whether a chunk was claimed */
+			bool claim(Range*& p_range, unsigned int& chunk);
+			void run_chunk(Range& range, unsigned int chunk);
+
+			/** Run a chunk of any open range
+			 * \return whether there was one */
+			bool help(void);
+
+			static unsigned int shared_workers;
+			static std::atomic<bool> shared_created;
+			static std::mutex shared_mutex; // guards the shared instance's configuration
+	};
+
+};
@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file LODModelEntity.h
+ * \class giselle::scene::LODModelEntity
+ * \brief An Entity with several levels of detail of a model
+ *
+ * This class defines an entity which holds a chain of models, from the most detailed
+ * to the coarsest, and renders the one matching its size on screen. Each level has a
+ * threshold: it is used while the entity's bounding sphere covers at least that many
+ * pixels of height on screen (see \c Entity::selectDetail() ), and the coarsest level
+ * is used below all thresholds.
+ *
+ * To avoid popping back and forth between two levels, the entity only switches once
+ * its size gets past the threshold by a margin (see \c setHysteresis() ).
+ *
+ * Chains made by \c MeshSimplifier::simplifyChain() can be given to the constructor,
+ * which derives the thresholds from the triangle counts of the levels.
+ */
+#pragma once
+
+#include "Entity.h"
+#include "Model.h"
+#include "Renderer.h"
+
+#include <vector>
+
+namespace giselle
+{
+
+namespace scene
+{
+
+class LODModelEntity : public Entity
+{
+	private:
+		struct Level
+		{
+			model::Model model;
+			float min_pixels;
+		};
+
+		std::vector<Level> levels; // most detailed first
+		float hysteresis;
+		mutable unsigned int current;
+		bool occluder;
+
+	public:
+		/** Default height on screen of the triangles of the automatic thresholds,
+		 * in pixels */
+		static constexpr float DEFAULT_TRIANGLE_PIXELS = 8.0f;
+
+		/** Default margin of the level switches, relative to the thresholds */
+		static constexpr float DEFAULT_HYSTERESIS = 0.15f;
+
+		/**
+		 * Creates an entity with no levels; add them with \c addLevel().
+		 * \param pos position
+		 * \param ang orientation
+		 * \param children list of pointers to all children entities
+		 */
+		LODModelEntity(	const math::Vector4f& pos = math::Vector4f(),
+				const math::Vector4f& ang = math::Vector4f(),
+				const std::list<Entity*> & children = std::list<Entity*>() );
+
+		/**
+		 * Creates an entity from a chain of levels of detail. A level is used while
+		 * its triangles would stay under \b triangle_pixels in height on screen
+		 * if the next level were used instead.
+		 * \param chain the levels, most detailed first, such as the result of
+		 * \c MeshSimplifier::simplifyChain()
+		 * \param triangle_pixels the largest height of the triangles on screen,
+		 * in pixels
+		 * \param pos position
+		 * \param ang orientation
+		 * \param children list of pointers to all children entities
+		 */
+		LODModelEntity(	const std::vector<model::Model>& chain,
+				float triangle_pixels = LODModelEntity::DEFAULT_TRIANGLE_PIXELS,
+				const math::Vector4f& pos = math::Vector4f(),
+				const math::Vector4f& ang = math::Vector4f(),
+				const std::list<Entity*> & children = std::list<Entity*>() );
+
+		/** Default destructor */
+		virtual ~LODModelEntity();
+
+		/** Copy constructor
+		 *  \param other entity to copy from
+		 */
+		LODModelEntity(const LODModelEntity& other);
+
+		/**
+		 * Adds a level of detail. Levels are kept sorted by threshold, the most
+		 * detailed one first.
+		 * \param model the level's model
+		 * \param min_pixels the height on screen, in pixels, down to which the
+		 * level is used
+		 */
+		void addLevel(const model::Model& model, float min_pixels);
+
+		/** \return the number of levels */
+		unsigned int getLevelCount(void) const;
+
+		/** Getter for a level's model
+		 * \param level the level, in [0, getLevelCount()[
+		 * \return reference to the level's model
+		 */
+		model::Model& getLevel(unsigned int level);
+
+		/** \param level the level, in [0, getLevelCount()[
+		 * \return the level's threshold, in pixels */
+		float getThreshold(unsigned int level) const;
+
+		/** \return the level rendered in the last frame */
+		virtual unsigned int getCurrentLevel(void) const;
+
+		/**
+		 * Defines how far past a threshold the size on screen must get before the
+		 * level switches: up to \c (1-hysteresis) times the threshold the entity
+		 * keeps the more detailed level, and from \c (1+hysteresis) times the
+		 * threshold it keeps the coarser one.
+		 * \param hysteresis the margin, in [0,1[
+		 */
+		void setHysteresis(float hysteresis);
+
+		/** \return the margin of the level switches */
+		float getHysteresis(void) const;
+
+		/**
+		 * Flags the entity as an occluder for software occlusion culling. The
+		 * coarsest level is rasterized as the occluder.
+		 * \param occluder whether the entity is an occluder
+		 */
+		void setOccluder(bool occluder);
+
+		/** \return whether the entity is flagged as an occluder */
+		bool isOccluder(void) const;
+
+		/**
+		 * Renders the entity. It will draw the current level's model.
+		 * \param renderer
+		 */
+		virtual void render(Renderer& renderer) const;
+
+		/**
+		 * Gets the bounding box of the most detailed level.
+		 * \param min output reference to the box's minimum corner
+		 * \param max output reference to the box's maximum corner
+		 * \return whether the entity has a non-empty level
+		 */
+		virtual bool getBounds(math::Vector4f& min, math::Vector4f& max) const;
+
+		/**
+		 * \return pointer to the coarsest level if the entity is flagged as an
+		 * occluder, \c nullptr otherwise
+		 */
+		virtual const model::Model* getOccluder(void) const;
+
+		/**
+		 * Chooses the level to render.
+		 * \param pixels the height of the entity on screen, in pixels
+		 */
+		virtual void selectDetail(float pixels) const;
+};
+
+};
+
+};
@@ -28,8 +28,8 @@
  * \brief Describes an entity for illuminating the scene
  *
  * A light is an entity for illuminating the whole scene. Once the light is set to the
- * scene using \c setLight() (not just attached), its properties will be used in the
- * rendering process of all entities.
+ * scene using \c setLight() or \c addLight() (not just attached), its properties will
+ * be used in the rendering process of the entities it influences the most.
  *
  * Like in other entities, the light is affected by transformations of its parent entity,
  * and its absolute position is considered in the rendering process.
@@ -49,6 +49,8 @@ namespace scene
 	{
 		private:
 			math::Vector4f color;
+			float attenuation;
+			bool cast_shadows;
 
 		public:
 			/**
@@ -80,6 +82,29 @@ namespace scene
 			 */
 			const math::Vector4f& getColor(void) const;
 
+			/** Setter for the light's quadratic attenuation. The intensity of a
+			 * positional light at distance \c d is divided by
+			 * <tt>1 + attenuation * d * d</tt>. Directional lights are not
+			 * attenuated. The default is \c 0 (no attenuation).
+			 * \param attenuation the quadratic attenuation factor, non-negative
+			 */
+			void setAttenuation(float attenuation);
+
+			/** Getter for the light's quadratic attenuation
+			 * \return the quadratic attenuation factor
+			 */
+			float getAttenuation(void) const;
+
+			/** Defines whether the light casts shadows. Directional lights, and
+			 * positional lights outside the bounds of the scene, can cast shadows
+			 * (see \c GContext::setShadows() ). Disabled by default.
+			 * \param cast_shadows whether the light casts shadows
+			 */
+			void setCastShadows(bool cast_shadows);
+
+			/** \return whether the light casts shadows */
+			bool getCastShadows(void) const;
+
 		protected:
 		private:
 	};
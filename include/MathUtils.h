@@ -126,6 +126,26 @@ namespace giselle
 		 */
 		Mat4x4f& rotate(Mat4x4f& mat, float pitch, float yaw, float roll);
 
+		/**
+		 * Calculates the axis-aligned bounding box of a transformed box.
+		 * \param mat the transformation matrix (affine)
+		 * \param min the minimum corner of the box to transform
+		 * \param max the maximum corner of the box to transform
+		 * \param out_min output reference to the minimum corner of the resulting box
+		 * \param out_max output reference to the maximum corner of the resulting box
+		 */
+		void transformBounds(const Mat4x4f& mat, const Vector4f& min, const Vector4f& max,
+							Vector4f& out_min, Vector4f& out_max);
+
+		/**
+		 * Calculates the inverse of a matrix.
+		 * \param mat the matrix to invert
+		 * \param out output reference to the inverse matrix, left untouched if
+		 * the matrix is singular
+		 * \return whether the matrix could be inverted
+		 */
+		bool invert(const Mat4x4f& mat, Mat4x4f& out);
+
 		/**
 		 * Prints a simple textual presentation of a matrix to an output stream.
 		 * The elements are arranged in a 4x4 grid, containing a full row in each line
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file MeshCache.h
+ * \class giselle::model::MeshCache
+ *
+ * \brief A cache of generated meshes, shared by the models made from them.
+ *
+ * The cache maps the arguments of a mesh generator (see \c Key ) to the mesh data it
+ * generated, so that calling a generator again with the same arguments returns the
+ * same mesh data instead of building a copy of it. The primitives \c Box(),
+ * \c Sphere() and \c Cylinder() go through the shared instance (see \c shared() ).
+ *
+ * The cache keeps the meshes it holds under a budget of bytes, evicting the least
+ * recently used ones first. Evicting a mesh only drops the cache's reference to it:
+ * the models using it keep it alive. A budget of 0 disables caching.
+ *
+ * Cached meshes keep their buffer objects once drawn, and the shared cache serves
+ * every <b>GContext</b>: the GL contexts drawing cached meshes must all belong to one
+ * share group. Meshes dropped by the cache, on any thread, queue their buffers for
+ * deletion by the next frame (see \c MeshData::deleteReleasedBuffers() ).
+ *
+ * The cache is thread-safe. A thread asking for a mesh that another thread is
+ * generating waits for it rather than generating it again.
+ */
+#pragma once
+
+#include "MeshData.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <initializer_list>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace giselle
+{
+namespace model
+{
+
+	class MeshCache
+	{
+		public:
+			/** Identifiers of the library's generators; applications may use
+			 * identifiers from \c USER_GENERATOR onwards for their own */
+			enum Generator
+			{
+				BOX,
+				SPHERE,
+				CYLINDER,
+				USER_GENERATOR = 0x100
+			};
+
+			/** Maximum number of parameters of a key */
+			static constexpr unsigned int MAX_PARAMS = 8;
+
+			/** Default budget, in bytes */
+			static constexpr std::size_t DEFAULT_BUDGET = 64u << 20;
+
+			/** A generator and its parameters. Parameters are compared bit by bit. */
+			struct Key
+			{
+				unsigned int generator;
+				unsigned int n_params;
+				float params[MAX_PARAMS];
+
+				/**
+				 * Builds a key.
+				 * \param generator the generator's identifier
+				 * \param params the parameters, at most \c MAX_PARAMS (extra ones
+				 * are ignored)
+				 */
+				Key(unsigned int generator, std::initializer_list<float> params);
+
+				bool operator==(const Key& other) const;
+			};
+
+			/** Generates a mesh on a cache miss */
+			typedef std::function<std::shared_ptr<const MeshData>(void)> Generate;
+
+			/** Counters of the cache's activity */
+			struct Stats
+			{
+				/** number of requests served from the cache */
+				std::uint64_t hits;
+				/** number of requests that generated a mesh */
+				std::uint64_t misses;
+				/** number of meshes evicted to stay within the budget */
+				std::uint64_t evictions;
+				/** number of meshes held */
+				unsigned int entries;
+				/** bytes of the meshes held */
+				std::size_t bytes;
+			};
+
+			/**
+			 * Creates an empty cache.
+			 * \param budget the largest size of the meshes held, in bytes
+			 */
+			explicit MeshCache(std::size_t budget = MeshCache::DEFAULT_BUDGET);
+
+			/** Copy constructor deleted */
+			MeshCache(const MeshCache& other) = delete;
+
+			/**
+			 * Gets the mesh of a key, generating and caching it on a miss.
+			 * \param key the generator and its parameters
+			 * \param generate the function generating the mesh of \b key
+			 * \return the mesh data, or null if the generator returned null
+			 * \throw the exception thrown by \b generate, which is also thrown to
+			 * the threads waiting for the mesh; the key is not cached then
+			 */
+			std::shared_ptr<const MeshData> get(const Key& key, const Generate& generate);
+
+			/**
+			 * Redefines the budget, evicting meshes if needed.
+			 * \param budget the largest size of the meshes held, in bytes
+			 */
+			void setBudget(std::size_t budget);
+
+			/** \return the budget, in bytes */
+			std::size_t getBudget(void) const;
+
+			/** Drops all the meshes held, and resets the counters */
+			void clear(void);
+
+			/** \return a snapshot of the cache's counters */
+			Stats getStats(void) const;
+
+			/** \return the cache shared by the library's generators */
+			static MeshCache& shared(void);
+
+			/** \return the bytes used by a mesh's arrays */
+			static std::size_t byteSize(const MeshData& mesh);
+
+		private:
+			typedef std::shared_future<std::shared_ptr<const MeshData>> Future;
+
+			struct KeyHash
+			{
+				std::size_t operator()(const Key& key) const;
+			};
+
+			struct Entry
+			{
+				Future mesh;
+				std::size_t bytes; // 0 while generating
+				std::list<Key>::iterator lru;
+			};
+
+			mutable std::mutex mutex;
+			std::unordered_map<Key, Entry, KeyHash> entries;
+			std::list<Key> lru; // most recently used first
+			std::size_t budget;
+			Stats stats;
+			unsigned int clears; // calls to clear(), telling entries apart across them
+
+			/** Evict the least recently used meshes until within budget */
+			void evict(void);
+	};
+
+};
+};
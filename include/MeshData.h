@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+/**
+ * \file MeshData.h
+ * \class giselle::model::MeshData
+ *
+ * \brief The immutable triangle mesh of one or more models.
+ *
+ * Mesh data holds the vertex positions, vertex normals and vertex indices of a
+ * triangle mesh, in the layout described in <b>Model</b>, along with their bounds.
+ * It never changes once built, so that any number of models can share it: copying a
+ * <b>Model</b> only copies a reference to its mesh data, which is released along with
+ * the last model using it.
+ *
+ * Besides positions and normals, a mesh may have texture coordinates and colors. All
+ * the attributes are kept in a single block of planar floats, and the vertex layout
+ * of the mesh (see \c VertexLayout ) tells which attributes it has, and how they are
+ * stored on the GPU.
+ *
+ * The mesh is uploaded to GL buffer objects, in its vertex layout, the first time a
+ * <b>Renderer</b> draws it, and is drawn from them afterwards, by every model sharing
+ * it. Meshes of fewer than 65536 vertices get 16-bit indices on the GPU. With a
+ * quantized layout (see \c VertexLayout::isQuantized() ), \c getQuantizationError()
+ * tells how far the GPU copy strays from the original vertices.
+ */
+#include "Vector4f.h"
+#include "VertexLayout.h"
+
+#include <memory>
+
+namespace giselle
+{
+	class Renderer;
+
+namespace model
+{
+
+	class MeshData
+	{
+		friend class ModelBuilder;
+		friend class giselle::Renderer;
+
+		private:
+			unsigned int nVertices;
+			unsigned int nTriangles;
+			VertexLayout layout;
+			float* vertex_arr; // all attributes, in layout.planarFloat()
+			unsigned int* index_arr;
+			math::Vector4f bounds_min, bounds_max;
+
+			// vertex and index buffer objects, 0 until first drawn
+			mutable unsigned int buffers[2];
+			mutable unsigned int index_size; // bytes per index in the buffer
+
+			MeshData(void);
+
+		public:
+			/** Largest errors of the vertex layout of a mesh */
+			struct QuantizationError
+			{
+				/** largest distance between a position and its encoding, in
+				 * model units */
+				float position;
+				/** largest angle between a normal and its encoding, in
+				 * degrees */
+				float normal;
+			};
+
+			/**
+			 * Creates mesh data with a copy of the given arrays. The arrays are
+			 * expected to be valid (see \c Model ). Texture coordinates and colors
+			 * of the layout get default values, see \c VertexLayout::convert().
+			 */
+			MeshData(unsigned int nVertices, unsigned int nTriangles, const float* vertex_array,
+					const float* vertex_normal_array, const unsigned int* index_array,
+					const VertexLayout& layout = VertexLayout());
+
+			/** Destructor, releases the arrays and queues the buffer objects for
+			 * deletion (see \c deleteReleasedBuffers() ) */
+			~MeshData(void);
+
+			/** Copy constructor deleted */
+			MeshData(const MeshData& other) = delete;
+
+			/** Copy assignment deleted */
+			MeshData& operator=(const MeshData& other) = delete;
+
+			/**
+			 * Deletes the buffer objects of the meshes destroyed since the last call.
+			 * Meshes may be destroyed on any thread, such as a worker evicting them
+			 * from a <b>MeshCache</b>, so their buffers are only queued for deletion;
+			 * a <b>GContext</b> calls this at the start of each frame. A GL context
+			 * of the meshes' share group must be current.
+			 */
+			static void deleteReleasedBuffers(void);
+
+			/** Getter for the number of vertices */
+			unsigned int getNVertices(void) const;
+
+			/** Getter for the number of triangles */
+			unsigned int getNTriangles(void) const;
+
+			/** Getter for the vertex array */
+			const float* getVertexArray(void) const;
+
+			/** Getter for the vertex normal array */
+			const float* getVertexNormalArray(void) const;
+
+			/** Getter for the texture coordinate array, 2 floats per vertex,
+			 * or null if the mesh has none */
+			const float* getTexCoordArray(void) const;
+
+			/** Getter for the color array, 4 floats per vertex, or null if the
+			 * mesh has none */
+			const float* getColorArray(void) const;
+
+			/** Getter for the index array */
+			const unsigned int* getIndexArray(void) const;
+
+			/**
+			 * Gets the axis-aligned bounding box of the vertices.
+			 * \param min output reference to the box's minimum corner
+			 * \param max output reference to the box's maximum corner
+			 */
+			void getBounds(math::Vector4f& min, math::Vector4f& max) const;
+
+			/** Getter for the mesh's vertex layout */
+			const VertexLayout& getLayout(void) const;
+
+			/**
+			 * Creates a copy of the mesh with another vertex layout. Attributes
+			 * the mesh lacks get default values, see \c VertexLayout::convert().
+			 * \param layout the layout of the copy
+			 * \return the new mesh data
+			 */
+			std::shared_ptr<const MeshData> withLayout(const VertexLayout& layout) const;
+
+			/**
+			 * Measures the error of the mesh's vertex layout, by encoding and
+			 * decoding all of its vertices; not meant for every frame.
+			 * \return the largest errors, zero for float layouts
+			 */
+			QuantizationError getQuantizationError(void) const;
+
+			/** \return whether the mesh was uploaded to buffer objects */
+			bool isUploaded(void) const;
+
+		private:
+			/** Writes the bounds as 3 floats of minimum and 3 of maximum,
+			 * see \c VertexLayout::convert() */
+			void get_bounds(float* bounds) const;
+
+			const float* attribute(VertexLayout::Attribute attribute) const;
+			void calcBounds(void);
+	};
+
+};
+};
@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file MeshOptimizer.h
+ * \class giselle::model::MeshOptimizer
+ *
+ * \brief Reorders the triangles and vertices of meshes for faster drawing.
+ *
+ * The optimizer applies three passes to the index array of a mesh, in this order:
+ * - vertex cache optimization, which orders triangles so that consecutive triangles
+ * share vertices still in the GPU's post-transform cache (Forsyth's algorithm);
+ * - overdraw optimization, which splits that order in clusters and sorts them so that
+ * the clusters facing outwards, likely to occlude the others, are drawn first
+ * (the clustering of Sander et al.'s Tipsify);
+ * - vertex fetch optimization, which renumbers vertices in the order the triangles
+ * first use them, so that vertex fetches walk memory forwards.
+ *
+ * The passes leave the triangles themselves and their winding untouched. The result
+ * of the cache pass is measured by the average cache miss ratio (ACMR, vertex shader
+ * invocations per triangle, at best about 0.5) and the average transformed vertex
+ * ratio (ATVR, invocations per vertex, at best 1), computed on a simulated FIFO cache.
+ * \c optimize() keeps the original order of meshes it would not improve, such as
+ * small primitives.
+ *
+ * Meshes built through a <b>ModelBuilder</b> are optimized automatically when enabled
+ * with \c setAutomatic(), or per builder with \c ModelBuilder::setOptimize().
+ */
+#pragma once
+
+#include "ModelBuilder.h"
+
+#include <atomic>
+
+namespace giselle
+{
+namespace model
+{
+
+	class MeshOptimizer
+	{
+		public:
+			/** Efficiency of the post-transform vertex cache on a mesh */
+			struct CacheStatistics
+			{
+				/** vertex shader invocations per triangle */
+				float acmr;
+				/** vertex shader invocations per vertex used */
+				float atvr;
+			};
+
+			/** The cache statistics of a mesh before and after optimizing it */
+			struct Report
+			{
+				CacheStatistics before;
+				CacheStatistics after;
+			};
+
+			/** Size of the simulated FIFO cache of the statistics */
+			static constexpr unsigned int CACHE_SIZE = 16;
+
+			/** Default ACMR threshold of \c optimizeOverdraw() */
+			static constexpr float OVERDRAW_THRESHOLD = 1.05f;
+
+			/**
+			 * Measures the efficiency of the vertex cache on an index array.
+			 * \param indices the index array, 3 indices per triangle
+			 * \param nTriangles the number of triangles
+			 * \param nVertices the number of vertices
+			 * \param cache_size the number of entries of the simulated cache
+			 * \return the statistics, zeros for an empty mesh
+			 */
+			static CacheStatistics analyze(const unsigned int* indices, unsigned int nTriangles,
+					unsigned int nVertices, unsigned int cache_size = CACHE_SIZE);
+
+			/**
+			 * Orders the triangles for the vertex cache.
+			 * \param indices the index array to reorder
+			 * \param nTriangles the number of triangles
+			 * \param nVertices the number of vertices
+			 */
+			static void optimizeVertexCache(unsigned int* indices, unsigned int nTriangles,
+					unsigned int nVertices);
+
+			/**
+			 * Orders clusters of triangles to reduce overdraw, keeping the order of
+			 * the triangles within each cluster. Meant to follow
+			 * \c optimizeVertexCache().
+			 * \param indices the index array to reorder
+			 * \param nTriangles the number of triangles
+			 * \param positions the vertex positions, 3 floats per vertex
+			 * \param nVertices the number of vertices
+			 * \param threshold how much the ACMR may grow for smaller clusters, at
+			 * least 1: clusters end once their own ACMR is within this factor of
+			 * the ACMR of the area they belong to
+			 */
+			static void optimizeOverdraw(unsigned int* indices, unsigned int nTriangles,
+					const float* positions, unsigned int nVertices,
+					float threshold = OVERDRAW_THRESHOLD);
+
+			/**
+			 * Renumbers the vertices in the order the triangles first use them.
+			 * Unused vertices are moved to the end.
+			 * \param vertices the vertex data, in planar floats
+			 * \param layout the layout of the mesh, whose planar float version
+			 * describes \b vertices
+			 * \param nVertices the number of vertices
+			 * \param indices the index array to update
+			 * \param nTriangles the number of triangles
+			 */
+			static void optimizeVertexFetch(float* vertices, const VertexLayout& layout,
+					unsigned int nVertices, unsigned int* indices, unsigned int nTriangles);
+
+			/**
+			 * Runs all three passes on the arrays of a builder. When the new order
+			 * does not lower the ACMR, the arrays are left as they were.
+			 * \param builder the builder, with its arrays filled
+			 * \return the cache statistics before and after
+			 */
+			static Report optimize(ModelBuilder& builder);
+
+			/**
+			 * Creates an optimized copy of a model, with the same material.
+			 * \param model the model to optimize
+			 * \param p_report where to store the cache statistics, may be null
+			 * \return the optimized model
+			 */
+			static Model optimize(const Model& model, Report* p_report = nullptr);
+
+			/**
+			 * Defines whether new builders optimize their meshes (see
+			 * \c ModelBuilder::setOptimize() ), which includes the primitives
+			 * such as \c Sphere(). Disabled by default.
+			 * \param enabled whether to optimize meshes when they are built
+			 */
+			static void setAutomatic(bool enabled);
+
+			/** \return whether new builders optimize their meshes */
+			static bool isAutomatic(void);
+
+		private:
+			static std::atomic<bool> automatic;
+	};
+
+};
+};
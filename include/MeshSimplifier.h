@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file MeshSimplifier.h
+ * \class giselle::model::MeshSimplifier
+ *
+ * \brief Reduces the number of triangles of meshes, to make levels of detail.
+ *
+ * The simplifier collapses edges of the mesh in order of increasing quadric error
+ * (Garland and Heckbert), moving one vertex of the edge onto the other, so that the
+ * simplified mesh only uses vertices of the original one, with their normals and
+ * other attributes.
+ *
+ * Vertices that share a position but differ in their attributes (a seam, such as the
+ * hard edge between a cylinder's side and its caps) are collapsed together, and only
+ * along the seam. Vertices on the border of an open mesh only move along the border.
+ * Border and seam corners, and non-manifold vertices, never move. Collapses that
+ * would turn a triangle by more than about 75 degrees are rejected.
+ *
+ * The error of a simplified mesh is the distance between its surface and the
+ * original one, relative to the diagonal of the mesh's bounding box.
+ *
+ * The work of each simplification pass is spread over the shared <b>JobSystem</b>
+ * for meshes of more than \c PARALLEL_GRAIN triangles.
+ */
+#pragma once
+
+#include "Model.h"
+
+#include <vector>
+
+namespace giselle
+{
+namespace model
+{
+
+	class MeshSimplifier
+	{
+		public:
+			/** Minimum number of triangles or edges per simplification task */
+			static constexpr unsigned int PARALLEL_GRAIN = 16384;
+
+			/** Default triangle ratio between successive levels of \c simplifyChain() */
+			static constexpr float LOD_RATIO = 0.5f;
+
+			/**
+			 * Simplifies a model down to a number of triangles, or until the error
+			 * would exceed a limit, whichever comes first.
+			 * \param model the model to simplify
+			 * \param target_triangles the number of triangles to reach
+			 * \param target_error the largest error allowed, relative to the
+			 * model's size; 1 or more for no limit
+			 * \param p_error where to store the error of the result, may be null
+			 * \return the simplified model, with the same material and vertex
+			 * layout, or a copy of \b model if it can't be simplified
+			 */
+			static Model simplify(const Model& model, unsigned int target_triangles,
+					float target_error = 1.0f, float* p_error = nullptr);
+
+			/**
+			 * Simplifies a model to a chain of levels of detail, in a single
+			 * simplification: each level has about \b ratio times the triangles of
+			 * the previous one. The chain ends early when the mesh can't be
+			 * simplified further within the error limit.
+			 * \param model the model to simplify, level 0 of the chain
+			 * \param levels the number of levels to make besides the model
+			 * \param ratio the triangle ratio between successive levels, in ]0,1[
+			 * \param target_error the largest error allowed, relative to the
+			 * model's size
+			 * \param p_errors where to store the error of each level, may be null
+			 * \return the model followed by its simplified levels
+			 */
+			static std::vector<Model> simplifyChain(const Model& model, unsigned int levels,
+					float ratio = LOD_RATIO, float target_error = 1.0f,
+					std::vector<float>* p_errors = nullptr);
+	};
+
+};
+};
@@ -42,8 +42,20 @@
  *
  * A model is inconsistent when one of the arrays are undefined or
  * the index array references an unexistent vertex.
+ *
+ * The arrays are kept in a <b>MeshData</b>, shared by all copies of the model: a model
+ * is only a handle to its mesh along with its own material, and copying it takes
+ * constant time and memory. Models built from the same mesh are drawn from the same
+ * GL buffers, stored in the mesh's vertex layout (see \c MeshData::withLayout() ).
+ *
+ * Generators and loaders should write the arrays in place with a <b>ModelBuilder</b>
+ * rather than pass them to the constructor, which copies them.
  */
 #include "Material.h"
+#include "Vector4f.h"
+#include "MeshData.h"
+
+#include <memory>
 
 namespace giselle
 {
@@ -57,12 +69,7 @@ namespace model
 		friend class giselle::GContext;
 
 		private:
-			unsigned int nVertices;
-			unsigned int nTriangles;
-			float* vertex_arr;
-			float* vertex_normal_arr;
-			unsigned int* index_arr;
-
+			std::shared_ptr<const MeshData> p_mesh; // null when empty
 			Material material;
 
 		public:
@@ -78,6 +85,14 @@ namespace model
 					float* vertex_normal_array, unsigned int* index_array,
 					const Material& material = Material::BASE);
 
+			/**
+			 * Creates a model sharing existing mesh data
+			 * \param mesh the mesh data, or null for an empty model
+			 * \param material the model's material
+			 */
+			Model(const std::shared_ptr<const MeshData>& mesh,
+					const Material& material = Material::BASE);
+
 			/** Default destructor */
 			virtual ~Model();
 
@@ -91,6 +106,19 @@ namespace model
 			*/
 			Model(Model&& other);
 
+			/** Copy assignment
+			*  \param other Model to copy from
+			*/
+			Model& operator=(const Model& other);
+
+			/** Move assignment
+			*  \param other Temporary Model to move from
+			*/
+			Model& operator=(Model&& other);
+
+			/** Getter for the model's mesh data, null if the model is empty */
+			const std::shared_ptr<const MeshData>& getMesh(void) const;
+
 			/** Getter for the model's number of vertices */
 			unsigned int getNVertices(void) const;
 
@@ -106,6 +134,14 @@ namespace model
 			/** Getter for the model's index array */
 			const unsigned int* getIndexArray(void) const;
 
+			/**
+			 * Gets the axis-aligned bounding box of the model's vertices.
+			 * \param min output reference to the box's minimum corner
+			 * \param max output reference to the box's maximum corner
+			 * \return \b false if the model is empty, \b true otherwise
+			 */
+			bool getBounds(math::Vector4f& min, math::Vector4f& max) const;
+
 			/** Getter for the model's material */
 			const Material& getMaterial(void) const;
 
@@ -120,9 +156,6 @@ namespace model
 			 * \return whether the model is consistent
 			 */
 			bool isConsistent(void) const;
-
-		protected:
-		private:
 	};
 
 };
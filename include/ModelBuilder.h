@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+/**
+ * \file ModelBuilder.h
+ * \class giselle::model::ModelBuilder
+ *
+ * \brief Builds a model in its final storage.
+ *
+ * The builder allocates the vertex, vertex normal and index arrays of a model once,
+ * with the sizes given to \c reserve(), and lets generators and loaders write into
+ * them directly. \c build() then hands the arrays over to the <b>MeshData</b> of a new
+ * <b>Model</b>, without copying them, and leaves the builder empty.
+ *
+ * The arrays follow the layout of <b>Model</b>: 3 floats per vertex position and per
+ * vertex normal, and 3 indices per triangle, plus 2 floats of texture coordinates and
+ * 4 floats of color per vertex when the vertex layout given to \c reserve() has them.
+ * Their contents are undefined until written.
+ *
+ * When optimization is on (see \c setOptimize() ), \c build() reorders the triangles
+ * and vertices with <b>MeshOptimizer</b> before handing the arrays over.
+ */
+#include "Model.h"
+
+namespace giselle
+{
+namespace model
+{
+
+	class ModelBuilder
+	{
+		private:
+			unsigned int nVertices;
+			unsigned int nTriangles;
+			VertexLayout layout;
+			float* vertex_arr; // all attributes, in layout.planarFloat()
+			unsigned int* index_arr;
+			bool has_bounds;
+			math::Vector4f bounds_min, bounds_max;
+			bool optimize;
+
+		public:
+			/** Default constructor
+			 * Creates an empty builder
+			 */
+			ModelBuilder(void);
+
+			/**
+			 * Creates a builder with storage for a model of the given size.
+			 * \param nVertices the number of vertices
+			 * \param nTriangles the number of triangles
+			 * \param layout the vertex layout of the mesh
+			 */
+			ModelBuilder(unsigned int nVertices, unsigned int nTriangles,
+					const VertexLayout& layout = VertexLayout());
+
+			/** Destructor, releases the arrays not handed over to a model */
+			~ModelBuilder(void);
+
+			/** Copy constructor deleted */
+			ModelBuilder(const ModelBuilder& other) = delete;
+
+			/** Move constructor
+			*  \param other builder to move from
+			*/
+			ModelBuilder(ModelBuilder&& other);
+
+			/**
+			 * Allocates the arrays for a model of the given size, releasing the
+			 * previous ones.
+			 * \param nVertices the number of vertices
+			 * \param nTriangles the number of triangles
+			 * \param layout the vertex layout of the mesh, which tells which
+			 * attributes it has and how they are stored on the GPU
+			 */
+			void reserve(unsigned int nVertices, unsigned int nTriangles,
+					const VertexLayout& layout = VertexLayout());
+
+			/** Getter for the number of vertices reserved */
+			unsigned int getNVertices(void) const;
+
+			/** Getter for the number of triangles reserved */
+			unsigned int getNTriangles(void) const;
+
+			/** Getter for the vertex layout reserved */
+			const VertexLayout& getLayout(void) const;
+
+			/** \return the vertex array to fill, 3 floats per vertex */
+			float* getVertexArray(void);
+
+			/** \return the vertex normal array to fill, 3 floats per vertex */
+			float* getVertexNormalArray(void);
+
+			/** \return the texture coordinate array to fill, 2 floats per
+			 * vertex, or null if the layout has none */
+			float* getTexCoordArray(void);
+
+			/** \return the color array to fill, 4 floats per vertex, or null
+			 * if the layout has none */
+			float* getColorArray(void);
+
+			/** \return the index array to fill, 3 indices per triangle */
+			unsigned int* getIndexArray(void);
+
+			/**
+			 * Defines the bounding box of the model, when the generator or the
+			 * file being loaded knows it, so that \c build() does not have to go
+			 * through the vertices again.
+			 * \param min the box's minimum corner
+			 * \param max the box's maximum corner
+			 */
+			void setBounds(const math::Vector4f& min, const math::Vector4f& max);
+
+			/**
+			 * Defines whether \c build() optimizes the mesh for the vertex cache,
+			 * overdraw and vertex fetches. The default is
+			 * \c MeshOptimizer::isAutomatic() at the builder's creation.
+			 * \param optimize whether to optimize the mesh
+			 */
+			void setOptimize(bool optimize);
+
+			/** \return whether \c build() optimizes the mesh */
+			bool getOptimize(void) const;
+
+			/**
+			 * Hands the arrays over to a new model and empties the builder.
+			 * \param material the model's material
+			 * \return the model, or an empty model if fewer than 3 vertices or
+			 * no triangles were reserved
+			 */
+			Model build(const Material& material = Material::BASE);
+
+			/**
+			 * Hands the arrays over to new mesh data and empties the builder.
+			 * \return the mesh data, or null if fewer than 3 vertices or no
+			 * triangles were reserved
+			 */
+			std::shared_ptr<const MeshData> buildMesh(void);
+
+		private:
+			float* attribute(VertexLayout::Attribute attribute);
+			void release(void);
+	};
+
+};
+};
@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file OcclusionCuller.h
+ * \class giselle::OcclusionCuller
+ *
+ * \brief Hardware occlusion culling of scene subtrees
+ *
+ * The occlusion culler tests the world-space bounding boxes of scene subtrees against
+ * the depth buffer using \c GL_ANY_SAMPLES_PASSED queries, and skips the subtrees that
+ * are hidden. The rendering pipeline never waits for a query result. Two modes are
+ * available:
+ *
+ * - \c DEFERRED : the boxes are tested at the end of the frame, and the results are
+ *   consumed in a later frame. A subtree found hidden is skipped as a whole, and only
+ *   its root box keeps being tested until it shows up again. Objects that become
+ *   visible may appear one frame late.
+ * - \c CONDITIONAL : the box of each top-level subtree is tested right before drawing
+ *   the subtree, which is drawn under \c glBeginConditionalRender() without waiting.
+ *   There is no latency, but hidden subtrees still cost their draw submission.
+ *
+ * Subtrees whose box contains the camera are always drawn. Only entities with
+ * bounds (see \c Entity::getBounds() ) contribute to the boxes of a subtree.
+ *
+ * One is automatically created in a <b>GContext</b>, and it is disabled by default.
+ */
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+
+#include "RenderItem.h"
+#include "Renderer.h"
+#include "Vector4f.h"
+
+namespace giselle
+{
+
+	class OcclusionCuller
+	{
+		public:
+			/** Occlusion culling modes */
+			enum Mode
+			{
+				/** no occlusion culling */
+				OFF,
+				/** skip subtrees found hidden in previous frames */
+				DEFERRED,
+				/** draw top-level subtrees under conditional rendering */
+				CONDITIONAL
+			};
+
+			/** Default constructor, occlusion culling disabled */
+			OcclusionCuller(void);
+
+			/** Destructor, releases all queries */
+			~OcclusionCuller(void);
+
+			/** Copy constructor deleted */
+			OcclusionCuller(const OcclusionCuller& other) = delete;
+
+			/** Move constructor
+			 * \param other culler to move from
+			 */
+			OcclusionCuller(OcclusionCuller&& other);
+
+			/** Move assignment
+			 * \param other culler to move from
+			 */
+			OcclusionCuller& operator=(OcclusionCuller&& other);
+
+			/**
+			 * Sets the occlusion culling mode. All pending results are discarded.
+			 * \param mode the new mode
+			 */
+			void setMode(Mode mode);
+
+			/** \return the current occlusion culling mode */
+			Mode getMode(void) const;
+
+			/**
+			 * Gets the number of culled draws. In \c DEFERRED mode, this is the
+			 * number of entities with bounds skipped in the last frame. In
+			 * \c CONDITIONAL mode, this is the number of entities with bounds in
+			 * the subtrees found hidden, as the results come back from the GPU.
+			 * Entities already culled when the subtree was selected or tested
+			 * (by software occlusion) are left out.
+			 * \return number of culled draws
+			 */
+			unsigned int getCulledDraws(void) const;
+
+			/**
+			 * Collects available query results and marks the items to skip in
+			 * this frame.
+			 * \param items the frame's render list
+			 * \param eye the camera's absolute position
+			 * \param margin distance around the camera to consider as inside a box
+			 */
+			void select(std::vector<RenderItem>& items, const math::Vector4f& eye, float margin);
+
+			/**
+			 * Tests the boxes selected for testing in this frame. Must be called
+			 * after all drawing (\c DEFERRED mode only).
+			 * \param renderer the renderer
+			 * \param items the frame's render list
+			 */
+			void issueQueries(Renderer& renderer, const std::vector<RenderItem>& items);
+
+			/**
+			 * Starts conditional rendering of a top-level subtree
+			 * (\c CONDITIONAL mode only).
+			 * \param renderer the renderer
+			 * \param item the root item of the subtree
+			 * \param items the frame's render list
+			 * \param test whether to test the subtree's box (first pass of the
+			 * frame), or reuse the previous test of the frame
+			 * \param color_writes whether color writes are to be restored after
+			 * testing the box
+			 * \return whether conditional rendering was started, in which case
+			 * \c endGroup() must be called after drawing the subtree
+			 */
+			bool beginGroup(Renderer& renderer, const RenderItem& item,
+							const std::vector<RenderItem>& items,
+							bool test, bool color_writes);
+
+			/**
+			 * Tells whether \c beginGroup() would test the box of a subtree,
+			 * issuing an occlusion query.
+			 * \param item the root item of the subtree
+			 * \param test the \b test argument to be given to \c beginGroup()
+			 * \return whether the box would be tested
+			 */
+			bool testsGroup(const RenderItem& item, bool test) const;
+
+			/** Ends conditional rendering of a subtree */
+			void endGroup(void);
+
+		private:
+			struct Query
+			{
+				unsigned int id;
+				bool pending;     // waiting for the result
+				bool visible;     // last known result
+				unsigned int last_frame; // last frame the subtree's root was reached
+				unsigned int draws; // entities with bounds in the subtree when tested
+			};
+
+			Mode mode;
+			unsigned int frame;
+			unsigned int culled_draws;
+			math::Vector4f eye;
+			float margin;
+			std::unordered_map<const scene::Entity*, Query> queries;
+			std::vector<std::pair<unsigned int, Query*>> to_test; // reused across frames
+
+			Query& query(const scene::Entity* p_ent);
+			bool collect(Query& q);
+			bool containsEye(const RenderItem& item) const;
+			void purge(bool all);
+
+			/** Number of frames an unreached query is kept */
+			static constexpr unsigned int MAX_AGE = 256;
+	};
+
+};
@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file PerfCounters.h
+ * \class giselle::PerfCounters
+ *
+ * \brief Hardware performance counters of the CPU phases of a frame
+ *
+ * Counts the cycles, instructions, cache misses and branch misses of a few phases
+ * of the frame, with the performance counters of the CPU, through Linux's
+ * \c perf_event_open(). Where the frame times of a \c FrameProfiler tell how long a
+ * phase took, these tell why: a traversal of the scene's tree with few instructions
+ * per cycle and many cache misses is bound by memory, not by computation.
+ *
+ * Only user space code of the thread that enabled the counters is counted, so the
+ * work that phases hand to the workers of the <b>JobSystem</b> is not included. When
+ * the CPU has fewer counters than requested, the kernel multiplexes them, and the
+ * counts are scaled from the time each counter actually ran.
+ *
+ * The counters are not available on other systems, or when the kernel denies access
+ * to them (see \c /proc/sys/kernel/perf_event_paranoid ); \c setEnabled() fails then.
+ *
+ * One is automatically created in a <b>GContext</b>, and it is disabled by default.
+ */
+#pragma once
+
+#include <cstdint>
+
+namespace giselle
+{
+
+	class PerfCounters
+	{
+		public:
+			/** CPU phases of a frame */
+			enum Phase
+			{
+				/** flattening the scene's tree */
+				TRAVERSAL,
+				/** composing the transformation matrices and bounds */
+				TRANSFORMS,
+				/** submitting the draws to GL */
+				SUBMIT
+			};
+
+			/** Number of phases */
+			static constexpr unsigned int PHASE_COUNT = 3;
+
+			/** Counted hardware events */
+			enum Event
+			{
+				CYCLES,
+				INSTRUCTIONS,
+				CACHE_MISSES,
+				BRANCH_MISSES
+			};
+
+			/** Number of events */
+			static constexpr unsigned int EVENT_COUNT = 4;
+
+			/** Counts of a frame */
+			struct FrameCounters
+			{
+				/** index of the frame, counted from the first counted frame */
+				std::uint64_t frame;
+				/** count of each event in each phase */
+				std::uint64_t counts[PHASE_COUNT][EVENT_COUNT];
+				/** whether each event could be counted */
+				bool available[EVENT_COUNT];
+			};
+
+			/** Default constructor, counters disabled */
+			PerfCounters(void);
+
+			/** Destructor, closes the counters */
+			~PerfCounters(void);
+
+			/** Copy constructor deleted */
+			PerfCounters(const PerfCounters& other) = delete;
+
+			/** Move constructor
+			 * \param other counters to move from
+			 */
+			PerfCounters(PerfCounters&& other);
+
+			/** Move assignment
+			 * \param other counters to move from
+			 */
+			PerfCounters& operator=(PerfCounters&& other);
+
+			/**
+			 * Enables or disables the counters. They count the calling thread,
+			 * which must be the one that renders.
+			 * \param enabled whether to count the next frames
+			 * \return whether the counters are in the requested state; enabling
+			 * fails when no event could be counted
+			 */
+			bool setEnabled(bool enabled);
+
+			/** \return whether the counters are enabled */
+			bool isEnabled(void) const;
+
+			/**
+			 * \param event the event
+			 * \return whether the event is being counted
+			 */
+			bool isAvailable(Event event) const;
+
+			/**
+			 * Starts counting a phase of the current frame.
+			 * \param phase the phase
+			 */
+			void begin(Phase phase);
+
+			/**
+			 * Stops counting a phase of the current frame. Phases entered more
+			 * than once in a frame add up.
+			 * \param phase the phase, as given to \c begin()
+			 */
+			void end(Phase phase);
+
+			/** Ends the current frame, publishing its counts */
+			void endFrame(void);
+
+			/**
+			 * \return the counts of the last frame, or all zeros (with \c frame
+			 * set to \c UINT64_MAX ) if none yet
+			 */
+			const FrameCounters& getFrameCounters(void) const;
+
+		private:
+			struct Reading
+			{
+				std::uint64_t values[EVENT_COUNT];
+				std::uint64_t time_enabled;
+				std::uint64_t time_running;
+			};
+
+			int fds[EVENT_COUNT]; // -1 for events not counted
+			unsigned int order[EVENT_COUNT]; // position of each event in a group read
+			unsigned int n_open;
+			int active; // phase being counted, -1 if none
+			std::uint64_t frame;
+			Reading start;
+			FrameCounters current;
+			FrameCounters last;
+
+			bool read(Reading& reading) const;
+			void close_all(void);
+	};
+
+};
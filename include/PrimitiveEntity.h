@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file PrimitiveEntity.h
+ * \class giselle::scene::PrimitiveEntity
+ * \brief An Entity with a parametric shape, tessellated to its size on screen
+ *
+ * Primitive entities hold the parameters of a shape, such as the radius of a sphere,
+ * rather than a model. Each frame, they pick the tessellation whose triangles stay
+ * around a given height on screen (see \c setTrianglePixels() ), among levels of
+ * \c MIN_SEGMENTS, twice as many, and so on up to \c MAX_SEGMENTS segments around
+ * their round parts. Each level is generated the first time it's needed and kept
+ * until the parameters change.
+ *
+ * Like <b>LODModelEntity</b>, primitive entities only switch levels once their size
+ * on screen gets past a level's limit by a margin (see \c setHysteresis() ).
+ *
+ * Subclasses define the shape with \c generate().
+ */
+#pragma once
+
+#include "Entity.h"
+#include "Model.h"
+#include "Material.h"
+#include "Renderer.h"
+
+namespace giselle
+{
+
+namespace scene
+{
+
+class PrimitiveEntity : public Entity
+{
+	public:
+		/** Number of segments of the coarsest level */
+		static constexpr unsigned int MIN_SEGMENTS = 4;
+
+		/** Number of tessellation levels, each with twice the segments of the
+		 * previous one */
+		static constexpr unsigned int LEVEL_COUNT = 7;
+
+		/** Number of segments of the finest level */
+		static constexpr unsigned int MAX_SEGMENTS = MIN_SEGMENTS << (LEVEL_COUNT - 1);
+
+		/** Default length of the segments on screen, in pixels */
+		static constexpr float DEFAULT_TRIANGLE_PIXELS = 8.0f;
+
+		/** Default margin of the level switches, relative to the limits */
+		static constexpr float DEFAULT_HYSTERESIS = 0.15f;
+
+	private:
+		model::Material material;
+		float triangle_pixels;
+		float hysteresis;
+		mutable unsigned int current;
+		mutable model::Model levels[LEVEL_COUNT]; // empty until first needed
+
+	public:
+		/**
+		 * The one constructor to rule them all.
+		 * \param material the material of the shape
+		 * \param pos position
+		 * \param ang orientation
+		 * \param children list of pointers to all children entities
+		 */
+		PrimitiveEntity(const model::Material& material = model::Material::BASE,
+				const math::Vector4f& pos = math::Vector4f(),
+				const math::Vector4f& ang = math::Vector4f(),
+				const std::list<Entity*> & children = std::list<Entity*>() );
+
+		/** Default destructor */
+		virtual ~PrimitiveEntity();
+
+		/** Copy constructor
+		 *  \param other entity to copy from
+		 */
+		PrimitiveEntity(const PrimitiveEntity& other);
+
+		/** Getter for the entity's material
+		 * \return reference to the material
+		 */
+		model::Material& getMaterial(void);
+
+		/** Setter for the entity's material
+		 * \param material the new material
+		 */
+		void setMaterial(const model::Material& material);
+
+		/**
+		 * Defines the length of the segments on screen the tessellation aims for.
+		 * \param pixels the length in pixels, more than 0
+		 */
+		void setTrianglePixels(float pixels);
+
+		/** \return the length of the segments on screen, in pixels */
+		float getTrianglePixels(void) const;
+
+		/**
+		 * Defines how far past a level's limit the size on screen must get before
+		 * the level switches.
+		 * \param hysteresis the margin, in [0,1[
+		 */
+		void setHysteresis(float hysteresis);
+
+		/** \return the margin of the level switches */
+		float getHysteresis(void) const;
+
+		/** \return the level rendered in the last frame */
+		virtual unsigned int getCurrentLevel(void) const;
+
+		/**
+		 * Gets the model of a tessellation level, generating it if needed.
+		 * \param level the level, in [0, LEVEL_COUNT[
+		 * \return reference to the level's model
+		 */
+		const model::Model& getLevel(unsigned int level) const;
+
+		/** \param level the level, in [0, LEVEL_COUNT[
+		 * \return the number of segments of the level */
+		static unsigned int segments(unsigned int level);
+
+		/**
+		 * Renders the entity. It will draw the current level's model.
+		 * \param renderer
+		 */
+		virtual void render(Renderer& renderer) const;
+
+		/**
+		 * Chooses the level to render, generating it if needed.
+		 * \param pixels the height of the entity on screen, in pixels
+		 */
+		virtual void selectDetail(float pixels) const;
+
+	protected:
+		/**
+		 * Generates the shape.
+		 * \param segments the number of segments around the shape's round parts
+		 * \return the model, whose material is ignored
+		 */
+		virtual model::Model generate(unsigned int segments) const = 0;
+
+		/** \return the radius of the shape's round parts */
+		virtual float curve_radius(void) const = 0;
+
+		/** Drops the generated levels, to be called when the parameters change */
+		void invalidate(void);
+};
+
+};
+
+};
@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+/**
+ * \file PrimitiveInstances.h
+ * \class giselle::model::PrimitiveInstances
+ *
+ * \brief Instances of a box, sphere or cylinder, drawn without vertex data.
+ *
+ * Primitive instances only hold the position and scale of each instance: 6 floats, or
+ * 24 bytes, whatever the tessellation. A <b>Renderer</b> draws all of them in one
+ * instanced draw, in which the vertex shader computes the vertices of the shape from
+ * \c gl_VertexID and fetches the parameters of its instance from a buffer texture
+ * with \c gl_InstanceID. No vertex or index buffer is involved, so millions of
+ * primitives cost no more memory than their parameters.
+ *
+ * The shapes are those of \c Box(), \c Sphere() and \c Cylinder(), in unit sizes,
+ * scaled on each axis and moved by each instance:
+ * - \c BOX spans [-1,1] on all axes, the scale holds its half sizes;
+ * - \c SPHERE has radius 1, the scale holds its radii;
+ * - \c CYLINDER has radius 1 and spans [0,1] in Y, the position is the center of its
+ * base, and the scale holds its radii in X and Z and its height in Y.
+ *
+ * The instances are uploaded the first time they are drawn, and again when drawn
+ * after a change. The number of instances is bound by the size of buffer textures,
+ * \c GL_MAX_TEXTURE_BUFFER_SIZE over 6 (millions on current hardware).
+ */
+#include "Vector4f.h"
+
+#include <vector>
+
+namespace giselle
+{
+	class Renderer;
+
+namespace model
+{
+
+	class PrimitiveInstances
+	{
+		friend class giselle::Renderer;
+
+		public:
+			/** The shape of the instances, as numbered by the vertex shader */
+			enum Shape
+			{
+				BOX = 1,
+				SPHERE = 2,
+				CYLINDER = 3
+			};
+
+			/** Number of floats of each instance: position, then scale */
+			static constexpr unsigned int INSTANCE_FLOATS = 6;
+
+			/** Default number of segments around spheres and cylinders */
+			static constexpr unsigned int DEFAULT_SEGMENTS = 16;
+
+			/** Largest number of segments around spheres and cylinders */
+			static constexpr unsigned int MAX_SEGMENTS = 256;
+
+		private:
+			Shape shape;
+			unsigned int segments;
+			std::vector<float> data; // INSTANCE_FLOATS per instance
+			mutable bool bounds_valid;
+			mutable math::Vector4f bounds_min, bounds_max;
+
+			// buffer object and its buffer texture, 0 until first drawn
+			mutable unsigned int buffer, texture;
+			mutable bool uploaded; // whether the buffer holds the current data
+
+		public:
+			/**
+			 * Creates an empty set of instances.
+			 * \param shape the shape of the instances
+			 * \param segments the number of segments around spheres and cylinders,
+			 * see \c setSegments()
+			 */
+			explicit PrimitiveInstances(Shape shape,
+					unsigned int segments = PrimitiveInstances::DEFAULT_SEGMENTS);
+
+			/** Destructor, releases the buffer objects */
+			~PrimitiveInstances(void);
+
+			/** Copy constructor. The copy gets its own buffer objects when drawn.
+			 * \param other the instances to copy from
+			 */
+			PrimitiveInstances(const PrimitiveInstances& other);
+
+			/** Copy assignment deleted */
+			PrimitiveInstances& operator=(const PrimitiveInstances& other) = delete;
+
+			/** Getter for the shape of the instances */
+			Shape getShape(void) const;
+
+			/**
+			 * Defines the tessellation of spheres and cylinders, ignored by boxes.
+			 * Spheres get half as many divisions in latitude.
+			 * \param segments the number of segments around the shape, rounded up
+			 * to an even number in [4, MAX_SEGMENTS]
+			 */
+			void setSegments(unsigned int segments);
+
+			/** Getter for the number of segments around spheres and cylinders */
+			unsigned int getSegments(void) const;
+
+			/**
+			 * Adds an instance.
+			 * \param position the position of the instance
+			 * \param scale the scale of the instance on each axis, more than 0
+			 * \return the index of the new instance
+			 */
+			unsigned int add(const math::Vector4f& position, const math::Vector4f& scale);
+
+			/**
+			 * Replaces the parameters of an instance.
+			 * \param index the index of the instance, in [0, getCount()[
+			 * \param position the new position
+			 * \param scale the new scale, more than 0
+			 */
+			void set(unsigned int index, const math::Vector4f& position,
+					const math::Vector4f& scale);
+
+			/** Removes all instances */
+			void clear(void);
+
+			/** Reserves memory for a number of instances
+			 * \param count the number of instances
+			 */
+			void reserve(unsigned int count);
+
+			/** \return the number of instances */
+			unsigned int getCount(void) const;
+
+			/** \return the parameters of the instances, \c INSTANCE_FLOATS per
+			 * instance */
+			const float* getData(void) const;
+
+			/** \return the number of vertices of each instance */
+			unsigned int getVertexCount(void) const;
+
+			/** \return the number of triangles of each instance */
+			unsigned int getTriangleCount(void) const;
+
+			/**
+			 * Gets the axis-aligned bounding box of all instances.
+			 * \param min output reference to the box's minimum corner
+			 * \param max output reference to the box's maximum corner
+			 * \return whether there is any instance
+			 */
+			bool getBounds(math::Vector4f& min, math::Vector4f& max) const;
+
+			/** \return whether the current instances were uploaded */
+			bool isUploaded(void) const;
+
+		private:
+			void calcBounds(void) const;
+	};
+
+};
+};
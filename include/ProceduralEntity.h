@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file ProceduralEntity.h
+ * \class giselle::scene::ProceduralEntity
+ * \brief An Entity with any number of boxes, spheres or cylinders, drawn without
+ * vertex data
+ *
+ * Procedural entities hold the position and scale of each of their primitives (see
+ * <b>model::PrimitiveInstances</b>), in the entity's coordinate space, and draw them
+ * all at once with vertices computed on the GPU. They suit large numbers of small
+ * primitives, such as particles, debris or instanced props, which would not fit in
+ * memory as meshes. All primitives share the shape, tessellation and material of the
+ * entity, and are culled as a whole, by the box around all of them.
+ */
+#pragma once
+
+#include "Entity.h"
+#include "PrimitiveInstances.h"
+#include "Material.h"
+#include "Renderer.h"
+
+namespace giselle
+{
+
+namespace scene
+{
+
+class ProceduralEntity : public Entity
+{
+	private:
+		model::PrimitiveInstances instances;
+		model::Material material;
+
+	public:
+		/**
+		 * The one constructor to rule them all.
+		 * \param shape the shape of the primitives
+		 * \param material the material of the primitives
+		 * \param pos position
+		 * \param ang orientation
+		 * \param children list of pointers to all children entities
+		 */
+		ProceduralEntity(model::PrimitiveInstances::Shape shape,
+				const model::Material& material = model::Material::BASE,
+				const math::Vector4f& pos = math::Vector4f(),
+				const math::Vector4f& ang = math::Vector4f(),
+				const std::list<Entity*> & children = std::list<Entity*>() );
+
+		/** Default destructor */
+		virtual ~ProceduralEntity();
+
+		/** Copy constructor
+		 *  \param other entity to copy from
+		 */
+		ProceduralEntity(const ProceduralEntity& other);
+
+		/** Getter for the entity's material
+		 * \return reference to the material
+		 */
+		model::Material& getMaterial(void);
+
+		/** Setter for the entity's material
+		 * \param material the new material
+		 */
+		void setMaterial(const model::Material& material);
+
+		/** Getter for the entity's primitives */
+		const model::PrimitiveInstances& getInstances(void) const;
+
+		/**
+		 * Defines the tessellation of spheres and cylinders.
+		 * \param segments the number of segments around the primitives, see
+		 * \c PrimitiveInstances::setSegments()
+		 */
+		void setSegments(unsigned int segments);
+
+		/**
+		 * Adds a primitive.
+		 * \param position the position of the primitive, see <b>PrimitiveInstances</b>
+		 * \param scale the scale of the primitive on each axis, more than 0
+		 * \return the index of the new primitive
+		 */
+		unsigned int add(const math::Vector4f& position, const math::Vector4f& scale);
+
+		/**
+		 * Replaces the parameters of a primitive.
+		 * \param index the index of the primitive
+		 * \param position the new position
+		 * \param scale the new scale, more than 0
+		 */
+		void set(unsigned int index, const math::Vector4f& position,
+				const math::Vector4f& scale);
+
+		/** Removes all primitives */
+		void clear(void);
+
+		/** Reserves memory for a number of primitives
+		 * \param count the number of primitives
+		 */
+		void reserve(unsigned int count);
+
+		/**
+		 * Renders the entity. It will draw all of its primitives.
+		 * \param renderer
+		 */
+		virtual void render(Renderer& renderer) const;
+
+		/**
+		 * Gets the bounding box of all primitives.
+		 * \param min output reference to the box's minimum corner
+		 * \param max output reference to the box's maximum corner
+		 * \return whether the entity has any primitive
+		 */
+		virtual bool getBounds(math::Vector4f& min, math::Vector4f& max) const;
+};
+
+};
+
+};
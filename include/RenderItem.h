@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file RenderItem.h
+ * \class giselle::RenderItem
+ *
+ * \brief An entity of a scene, flattened for rendering
+ *
+ * During \c render(), a graphical context walks the scene's tree of entities once and
+ * flattens it into a list of render items, in depth-first order: parents always come
+ * before their children, and the items of an entity's subtree are contiguous.
+ * The items hold everything the remaining rendering stages need (transformations,
+ * bounds, culling decisions and lights), so that those stages do not walk the tree again.
+ *
+ * Direct usage of this structure is unadvised.
+ */
+#pragma once
+
+#include "Entity.h"
+#include "Scene.h"
+#include "Mat4x4f.h"
+#include "Vector4f.h"
+
+namespace giselle
+{
+
+	struct RenderItem
+	{
+		/** the entity */
+		const scene::Entity* p_ent;
+		/** index of the parent item, -1 for the root */
+		int parent;
+		/** index one past the last item of the entity's subtree */
+		unsigned int end;
+
+		/** entity's own transformation */
+		math::Mat4x4f local;
+		/** absolute model transformation */
+		math::Mat4x4f mat;
+
+		/** whether the entity has bounds (see \c Entity::getBounds() ) */
+		bool has_bounds;
+		/** world-space bounding box of the entity */
+		math::Vector4f bmin, bmax;
+
+		/** whether any entity of the subtree has bounds */
+		bool has_sub_bounds;
+		/** world-space bounding box of the whole subtree */
+		math::Vector4f sub_min, sub_max;
+
+		/** whether the entity is not to be drawn in this frame */
+		bool culled;
+
+		/** number of lights shading the entity */
+		int n_lights;
+		/** indices of the lights shading the entity, most influential first */
+		int lights[scene::Scene::MAX_LIGHTS];
+	};
+
+};
@@ -47,21 +47,41 @@
 #include "ShaderProgram.h"
 #include "Material.h"
 #include "Model.h"
+#include "PrimitiveInstances.h"
+#include "ClusteredLighting.h"
+#include "FrameStats.h"
 #include <string>
 
 namespace giselle
 {
 
 	class GContext;
+	class OcclusionCuller;
+	class GBuffer;
+	class ShadowMaps;
 
 	class Renderer
 	{
 		friend class giselle::GContext;
+		friend class giselle::OcclusionCuller;
+		friend class giselle::ShadowMaps;
 		friend class giselle::scene::Entity;
 
 	private:
+		struct Deferred;
+
 		ShaderProgram* p_prg; // simple renderer, always use this shader
+		ShaderProgram* p_depth_prg; // position-only shader for the depth pre-pass
+		const ShaderProgram* p_current; // the program in use
+		bool depth_only; // whether the depth-only program is in use
+		unsigned int light_ubo; // uniform buffer of the "Lights" block
+		ShaderProgram* p_clustered_prg; // shades the lights of each fragment's cluster
+		bool clustered; // whether to shade with the clustered program
+		unsigned int cluster_buffers[4]; // light positions, colors, grid, indices
+		unsigned int cluster_textures[4];
+		Deferred* p_deferred; // deferred shading programs and materials, if enabled
 		math::Mat4x4f model; // holds current model transformation matrix
+		FrameStats stats; // counters of the current frame
 
 	public:
 		/** Default constructor */
@@ -77,7 +97,8 @@ namespace giselle
 		 */
 		Renderer(Renderer&& other);
 
-		/** Move assignment
+		/** Move assignment, exchanging the two renderers' resources: those of this
+		 * renderer are released along with \b other
 		 * \param other renderer to move from
 		 */
 		Renderer& operator=(Renderer&& other);
@@ -94,6 +115,10 @@ namespace giselle
 		 */
 		int getAttribute(const std::string& att_name) const;
 
+		/** \copydoc getAttribute(const std::string&) const
+		 * Unlike the \c std::string version, it never allocates. */
+		int getAttribute(const char* att_name) const;
+
 		/**
 		 * Retrieves the index of a given shader uniform attribute,
 		 * in the current shader program
@@ -102,6 +127,10 @@ namespace giselle
 		 */
 		int getUniform(const std::string& att_name) const;
 
+		/** \copydoc getUniform(const std::string&) const
+		 * Unlike the \c std::string version, it never allocates. */
+		int getUniform(const char* att_name) const;
+
 		/**
 		 * Passes a new material to the renderer, making the next rendered model
 		 * use the given material properties.
@@ -117,20 +146,128 @@ namespace giselle
 		void render(const scene::Entity& ent);
 
 		/**
-		 * Draws the given model
+		 * Draws the given model, uploading its mesh on the first draw
 		 * \param model the model to draw
 		 */
 		void drawModel(const model::Model& model);
 
+		/**
+		 * Draws all the given primitive instances in one instanced draw, with
+		 * vertices computed by the vertex shader. The instances are uploaded
+		 * when first drawn, and after each change. Needs OpenGL 3.3.
+		 * \param instances the instances to draw
+		 */
+		void drawInstances(const model::PrimitiveInstances& instances);
+
 	private:
 		bool initShaders(void);
 
-		/** Use the renderer's contained shader program. */
+		/** Use the renderer's contained shader program, or the clustered
+		 * one if enabled. */
 		void use(void);
 
-		/** Set light attributes */
-		void passLightProperties( const math::Vector4f& light_pos,
-								const math::Vector4f& light_color);
+		/** Choose whether \c use() selects the clustered shader program,
+		 * building it the first time it is enabled
+		 * \return false if the program could not be built */
+		bool setClustered(bool enabled);
+
+		/** Use the G-buffer program of deferred shading, starting a new table
+		 * of materials. Requires \c initDeferred(). */
+		void useGBuffer(void);
+
+		/** Make a program current, keeping track of it */
+		void use_program(const ShaderProgram* prg);
+
+		/** Create the programs of deferred shading
+		 * \return whether they could be created */
+		bool initDeferred(void);
+
+		/** Light the contents of a G-buffer onto the window, additively: a full
+		 * screen pass for the ambient light and the lights without attenuation,
+		 * then a light volume for every other light. The window's depth buffer
+		 * receives the depth of the G-buffer.
+		 * \param gbuffer the G-buffer, filled with the \c useGBuffer() program
+		 * \param view the view matrix
+		 * \param proj the projection matrix
+		 * \param light_pos 4 floats per light, as in \c passLights()
+		 * \param light_color 4 floats per light, as in \c passLights()
+		 * \param n the number of lights
+		 * \param x the x coordinate of the context's region
+		 * \param y the y coordinate of the context's region
+		 * \param p_shadows the shadow maps of the lights, or null
+		 */
+		void shadeDeferred(const GBuffer& gbuffer,
+						const math::Mat4x4f& view, const math::Mat4x4f& proj,
+						const float* light_pos, const float* light_color, unsigned int n,
+						int x, int y, const ShadowMaps* p_shadows);
+
+		/** Use the depth-only shader program. Materials are ignored and
+		 * models are drawn with positions only until \c use() is called. */
+		void useDepthOnly(void);
+
+		/** Create the lights' uniform buffer and bind it to the default program */
+		void init_lights(void);
+
+		/** Upload a mesh to its buffer objects, creating them */
+		void upload_mesh(const model::MeshData& mesh);
+		void upload_instances(const model::PrimitiveInstances& instances);
+
+		/** Set the uniforms the vertex shader decodes quantized positions and
+		 * normals with, for the given mesh or for plain ones if null */
+		void pass_decoding(const model::MeshData* p_mesh);
+
+		/** Create the clustered program and its buffer textures
+		 * \return whether the program was built */
+		bool init_clusters(void);
+
+		/** \return the shader program currently in use */
+		const ShaderProgram* current(void) const;
+
+		/** Draws a world-space box with the depth-only program, switching back
+		 * to the previous program afterwards. Color and depth writes are left
+		 * to the caller.
+		 * \param min the minimum corner of the box
+		 * \param max the maximum corner of the box
+		 */
+		void drawBounds(const math::Vector4f& min, const math::Vector4f& max);
+
+		/** Upload the lights of the scene to the "Lights" uniform block.
+		 * Only the first \c MAX_SCENE_LIGHTS lights are kept.
+		 * \param light_pos 4 floats per light: the world position, or the
+		 * direction with \c w = 0 for directional lights
+		 * \param light_color 4 floats per light: the color, and the quadratic
+		 * attenuation in the 4th component
+		 * \param n the number of lights
+		 */
+		void passLights(const float* light_pos, const float* light_color, unsigned int n);
+
+		/** Upload the lights and the cluster lists of a frame to the
+		 * clustered program, which must be in use.
+		 * \param clusters the light assignment of the frame
+		 * \param light_pos 4 floats per light, as in \c passLights()
+		 * \param light_color 4 floats per light, as in \c passLights()
+		 * \param n the number of lights
+		 * \param x the x coordinate of the context's region
+		 * \param y the y coordinate of the context's region
+		 * \param w the width of the context's region
+		 * \param h the height of the context's region
+		 */
+		void passClusters(const ClusteredLighting& clusters,
+						const float* light_pos, const float* light_color, unsigned int n,
+						int x, int y, int w, int h);
+
+		/** Bind the shadow maps of the lights to the program in use.
+		 * \param p_shadows the shadow maps, or null to disable shadows
+		 * \param remap the program's index of each scene light, or -1 for
+		 * lights it does not shade; null when the indices are the same
+		 */
+		void passShadows(const ShadowMaps* p_shadows, const int* remap = nullptr);
+
+		/** Set the lights shading the next rendered models
+		 * \param indices indices of the lights in the "Lights" block
+		 * \param n the number of lights, at most \c Scene::MAX_LIGHTS
+		 */
+		void passLightSelection(const int* indices, int n);
 
 		/** Set projection matrix attribute. */
 		void passProjection(const math::Mat4x4f& proj);
@@ -152,6 +289,24 @@ namespace giselle
 		 * \param modelView the matrix
 		 */
 		void passModelView(const math::Mat4x4f& modelView);
+
+		/** Capacity of the "Lights" uniform block of the default program */
+		static constexpr unsigned int MAX_SCENE_LIGHTS = 256;
+
+		/** Binding point of the "Lights" uniform block */
+		static constexpr unsigned int LIGHTS_BINDING = 0;
+
+		/** First of the four texture units used by the clustered program */
+		static constexpr unsigned int CLUSTER_TEXTURE_UNIT = 0;
+
+		/** First of the four texture units used by deferred lighting */
+		static constexpr unsigned int DEFERRED_TEXTURE_UNIT = 0;
+
+		/** First of the two texture units used by the shadow maps */
+		static constexpr unsigned int SHADOW_TEXTURE_UNIT = 4;
+
+		/** Texture unit of the parameters of procedural primitives */
+		static constexpr unsigned int PROCEDURAL_TEXTURE_UNIT = 6;
 	};
 
 };
@@ -32,8 +32,9 @@
  * contain an invisible root node, to which other entities are attached in order to
  * produce the desirable scene.
  *
- * Each scene can also contain one active light at a time. A light must be set before
- * rendering, using \c setLight()
+ * Each scene can also contain any number of active lights, set with \c setLight() or
+ * \c addLight(). Every entity is shaded by the \c MAX_LIGHTS lights of the scene
+ * which influence it the most, according to their distance and intensity.
  */
 #pragma once
 
@@ -63,7 +64,8 @@ namespace scene {
 			Entity& root(void);
 
 			/**
-			 * Defines the light being used for illuminating the scene
+			 * Defines the light being used for illuminating the scene, replacing
+			 * all previously set lights
 			 * \param light reference to the light entity
 			 */
 			void setLight(Light& light);
@@ -71,23 +73,33 @@ namespace scene {
 			/**
 			 * Adds a new light being used for illuminating the scene
 			 * \param light reference to the light entity
-			 * \return \b false if the maximum number of lights has been reached
-			 * (see <tt>MAX_LIGHTS</tt> ) \b true otherwise
+			 * \return \b false if the light was already added, \b true otherwise
 			 */
 			bool addLight(Light& light);
 
 			/**
-			 * \return reference to currently used light
+			 * Removes a light from the scene's active lights
+			 * \param light reference to the light entity
+			 */
+			void removeLight(Light& light);
+
+			/**
+			 * \return reference to the first light of the scene. The scene
+			 * must have at least one light.
 			 */
 			const Light& getLight(void) const;
 
-			/** Maximum number of active lights in a scene */
+			/**
+			 * \return reference to the list of active lights of the scene
+			 */
+			const std::list<Light*>& getLights(void) const;
+
+			/** Maximum number of lights shading each entity */
 			static constexpr int MAX_LIGHTS = 5;
 
 		protected:
 		private:
 			Entity r;
-			Light* p_light;
 			std::list<Light*> lights;
 	};
 
@@ -102,6 +102,9 @@ class ShaderProgram
 		 */
 		int getAttribute(const std::string& att_name) const;
 
+		/** \copydoc getAttribute(const std::string&) const */
+		int getAttribute(const char* att_name) const;
+
 		/**
 		 * Retrieves the index of a given uniform shader attribute
 		 * \param att_name the name of the attribute
@@ -109,10 +112,31 @@ class ShaderProgram
 		 */
 		int getUniform(const std::string& att_name) const;
 
+		/** \copydoc getUniform(const std::string&) const */
+		int getUniform(const char* att_name) const;
+
+		/** Vertex shader of the default program, also used by the clustered one */
+		static const char* const DEFAULT_VERTEX_SHADER;
+		/** Fragment shader shading the lights of each fragment's cluster
+		 * (see \c ClusteredLighting ) */
+		static const char* const CLUSTERED_FRAGMENT_SHADER;
+		/** Fragment shader writing the G-buffer of deferred shading */
+		static const char* const GBUFFER_FRAGMENT_SHADER;
+		/** Vertex shader of full screen passes, taking clip-space positions */
+		static const char* const SCREEN_VERTEX_SHADER;
+		/** Fragment shader of the first deferred lighting pass: ambient light
+		 * and lights without attenuation */
+		static const char* const DEFERRED_AMBIENT_FRAGMENT_SHADER;
+		/** Fragment shader of the light volumes of deferred lighting */
+		static const char* const DEFERRED_LIGHT_FRAGMENT_SHADER;
+		/** Vertex shader of the depth-only program, transforming positions only */
+		static const char* const DEPTH_VERTEX_SHADER;
+		/** Fragment shader of the depth-only program, writing no color */
+		static const char* const DEPTH_FRAGMENT_SHADER;
+
 	protected:
 	private:
 		bool loadShaders(const char* vertex_shader, const char* fragment_shader);
-		static const char* const DEFAULT_VERTEX_SHADER;
 		static const char* const DEFAULT_FRAGMENT_SHADER;
 };
 
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file ShadowMaps.h
+ * \class giselle::ShadowMaps
+ *
+ * \brief Cached shadow maps of the scene's lights
+ *
+ * Each light casting shadows (see \c Light::setCastShadows() ) gets a layer in two
+ * depth texture arrays: one rendered with the static shadow casters only, the other
+ * with the dynamic ones (see \c Entity::setShadowCasting() ). Shaders take a point
+ * as lit when it passes the depth test of both layers.
+ *
+ * Layers are cached across frames. A layer is only rendered again when the light's
+ * projection changes, or when the casters of its kind inside the light's frustum
+ * changed: an entity entered or left the frustum, an entity or one of its parents
+ * was flagged dirty (see \c Entity::markDirty() ), or an entity switched its level of
+ * detail (see \c Entity::getCurrentLevel() ). The projection is fitted to a sphere
+ * a quarter larger than the scene's bounding sphere, and kept until the light moves,
+ * the scene leaves that sphere or shrinks well inside it. Changes to dynamic casters
+ * thus leave the static layer untouched, as long as they stay within the slack.
+ *
+ * Directional lights use an orthographic projection covering the whole scene. Positional
+ * lights use a perspective projection towards the scene, and only cast shadows when
+ * they lie outside the scene's bounding sphere.
+ *
+ * A <b>GContext</b> uses it when enabled with \c setShadows().
+ */
+#pragma once
+
+#include <vector>
+#include <list>
+#include <cstdint>
+
+#include "Mat4x4f.h"
+#include "Light.h"
+#include "RenderItem.h"
+#include "Renderer.h"
+
+namespace giselle
+{
+
+	class ShadowMaps
+	{
+		private:
+			struct Layer
+			{
+				int light_index;         // index of the light in the scene's list
+				math::Mat4x4f view_proj; // the light's view and projection
+				math::Mat4x4f shadow_mat; // world space to shadow map coordinates
+				float center[3], radius; // the sphere the projection is fitted to
+				std::uint64_t keys[2];   // static and dynamic casters last drawn
+				bool valid;
+			};
+
+			unsigned int size;
+			unsigned int fbo;
+			unsigned int textures[2]; // static, dynamic
+			Layer layers[4]; // MAX_SHADOWS
+			unsigned int n_layers;
+			unsigned int updates;
+
+			std::vector<std::uint64_t> versions; // reused across frames
+			std::vector<unsigned int> casters;   // reused across frames
+
+		public:
+			/**
+			 * Creates the depth texture arrays.
+			 * \param size the width and height of each shadow map
+			 */
+			ShadowMaps(unsigned int size = ShadowMaps::DEFAULT_SIZE);
+
+			/** Destructor. Releases the textures. */
+			~ShadowMaps();
+
+			/** Copy constructor deleted */
+			ShadowMaps(const ShadowMaps& other) = delete;
+
+			/** \return whether the shadow maps could not be created */
+			bool operator!(void) const;
+
+			/**
+			 * Brings the shadow maps up to date, rendering the layers which changed.
+			 * The viewport and the current program are left to the caller.
+			 * \param renderer the renderer drawing the casters
+			 * \param items the render list, with transformations and bounds calculated
+			 * \param lights the lights of the scene
+			 * \param light_pos 4 floats per light, in the order of \b lights: the
+			 * world position, or the direction with \c w = 0 for directional lights
+			 * \param n the number of lights in \b light_pos
+			 */
+			void update(Renderer& renderer, const std::vector<RenderItem>& items,
+						const std::list<scene::Light*>& lights,
+						const float* light_pos, unsigned int n);
+
+			/** \return the number of lights with a shadow map */
+			unsigned int getCount(void) const;
+
+			/**
+			 * \param layer the shadow map, in [0, getCount()[
+			 * \return the index of the shadow map's light in the scene's list
+			 */
+			int getLightIndex(unsigned int layer) const;
+
+			/**
+			 * \param layer the shadow map, in [0, getCount()[
+			 * \return the matrix from world space to the shadow map's texture
+			 * coordinates and depth, all in [0,1]
+			 */
+			const math::Mat4x4f& getMatrix(unsigned int layer) const;
+
+			/** \return the depth texture array of the static casters */
+			unsigned int getStaticTexture(void) const;
+
+			/** \return the depth texture array of the dynamic casters */
+			unsigned int getDynamicTexture(void) const;
+
+			/** \return the number of layers rendered by the last \c update() */
+			unsigned int getUpdates(void) const;
+
+			/** Maximum number of lights with shadows */
+			static constexpr unsigned int MAX_SHADOWS = 4;
+			static constexpr unsigned int DEFAULT_SIZE = 1024;
+
+		private:
+			/** Calculate the view and projection of a light covering a sphere
+			 * \return whether the light can cast shadows */
+			bool light_matrix(const float* light_pos, const float* center, float radius,
+							math::Mat4x4f& view_proj) const;
+
+			/** Gather the casters of a kind in a light's frustum
+			 * \return a key identifying the casters and their versions */
+			std::uint64_t gather(const std::vector<RenderItem>& items,
+								const math::Mat4x4f& view_proj,
+								scene::Entity::ShadowCasting kind);
+
+			/** Render the gathered casters to a layer of a texture array */
+			void draw(Renderer& renderer, const std::vector<RenderItem>& items,
+					unsigned int texture, unsigned int layer, const math::Mat4x4f& view_proj);
+	};
+
+};
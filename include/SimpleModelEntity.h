@@ -46,6 +46,7 @@ class SimpleModelEntity : public Entity
 {
 	private:
 		model::Model model;
+		bool occluder;
 	public:
 		/** The one constructor to rule them all */
 		SimpleModelEntity(	const model::Model& model,
@@ -66,11 +67,36 @@ class SimpleModelEntity : public Entity
 		 */
 		model::Model& getModel() { return this->model; }
 
+		/**
+		 * Flags the entity as an occluder for software occlusion culling. Large
+		 * entities with simple models, such as walls and floors, make the best
+		 * occluders.
+		 * \param occluder whether the entity's model is an occluder
+		 */
+		void setOccluder(bool occluder);
+
+		/** \return whether the entity is flagged as an occluder */
+		bool isOccluder(void) const;
+
 		/**
 		 * Renders the entity. It will draw the contained model.
 		 * \param renderer
 		 */
 		virtual void render(Renderer& renderer) const;
+
+		/**
+		 * Gets the bounding box of the contained model.
+		 * \param min output reference to the box's minimum corner
+		 * \param max output reference to the box's maximum corner
+		 * \return whether the model is not empty
+		 */
+		virtual bool getBounds(math::Vector4f& min, math::Vector4f& max) const;
+
+		/**
+		 * \return pointer to the contained model if the entity is flagged as an
+		 * occluder, \c nullptr otherwise
+		 */
+		virtual const model::Model* getOccluder(void) const;
 };
 
 };
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file SoftwareOcclusion.h
+ * \class giselle::SoftwareOcclusion
+ *
+ * \brief CPU occlusion culling with a low resolution depth buffer
+ *
+ * The software occlusion culler rasterizes the triangles of a few large occluders
+ * into a small depth-only buffer, entirely on the CPU, and then answers whether
+ * axis-aligned boxes may be visible behind them. No round-trip to the GPU is needed,
+ * so the answers are available before anything is submitted for drawing.
+ *
+ * The depth buffer is split in bands of rows, which are rasterized in parallel on the
+ * shared job system. Four pixels are processed at a time with SSE2 when available.
+ *
+ * The tests are conservative for the boxes: a box is only reported hidden if the
+ * nearest depth of its corners lies behind the occluders in every pixel of its
+ * screen rectangle. Occluder triangles crossing the camera plane are dropped.
+ *
+ * A <b>GContext</b> uses it when enabled with \c setSoftwareOcclusion(), taking as
+ * occluders the entities flagged with \c SimpleModelEntity::setOccluder().
+ */
+#pragma once
+
+#include <vector>
+
+#include "Mat4x4f.h"
+#include "Vector4f.h"
+#include "Model.h"
+
+namespace giselle
+{
+
+	class SoftwareOcclusion
+	{
+		private:
+			struct Triangle
+			{
+				float ex[3], ey[3], ec[3]; // edge functions: ex*x + ey*y + ec >= 0 inside
+				float zx, zy, zc;          // depth plane: zx*x + zy*y + zc
+				int min_x, max_x, min_y, max_y;
+			};
+
+			unsigned int width, height;
+			std::vector<float> depth;
+			math::Mat4x4f view_proj;
+			std::vector<Triangle> triangles; // reused across frames
+			std::vector<float> clip;         // reused across frames
+
+		public:
+			/**
+			 * Builds a software occlusion culler.
+			 * \param width the width of the depth buffer, rounded up to a multiple of 4
+			 * \param height the height of the depth buffer
+			 */
+			SoftwareOcclusion(unsigned int width = SoftwareOcclusion::DEFAULT_WIDTH,
+							unsigned int height = SoftwareOcclusion::DEFAULT_HEIGHT);
+
+			/** \return the width of the depth buffer */
+			unsigned int getWidth(void) const;
+
+			/** \return the height of the depth buffer */
+			unsigned int getHeight(void) const;
+
+			/**
+			 * Starts a new frame: clears the depth buffer and the occluders.
+			 * \param view_proj the product of the projection and view matrices
+			 */
+			void begin(const math::Mat4x4f& view_proj);
+
+			/**
+			 * Adds the front-facing triangles of a model to the occluders.
+			 * \param model the occluder's model
+			 * \param model_mat the occluder's model transformation
+			 */
+			void addOccluder(const model::Model& model, const math::Mat4x4f& model_mat);
+
+			/**
+			 * Rasterizes all occluders added since \c begin() into the depth buffer.
+			 */
+			void rasterize(void);
+
+			/**
+			 * Tests whether a box may be visible behind the rasterized occluders.
+			 * Boxes outside the view volume are not visible.
+			 * \param min the minimum corner of the box, in world space
+			 * \param max the maximum corner of the box, in world space
+			 * \return \b false if the box is certainly hidden, \b true otherwise
+			 */
+			bool isVisible(const math::Vector4f& min, const math::Vector4f& max) const;
+
+			/** \return the number of occluder triangles added since \c begin() */
+			unsigned int getTriangleCount(void) const;
+
+			/** \return the depth buffer, row by row from the bottom, with depths
+			 * in [0,1] */
+			const float* getDepthBuffer(void) const;
+
+			static constexpr unsigned int DEFAULT_WIDTH = 256;
+			static constexpr unsigned int DEFAULT_HEIGHT = 128;
+			/** Number of rows rasterized by each task */
+			static constexpr unsigned int BAND_ROWS = 8;
+
+		private:
+			void rasterizeBand(unsigned int row_begin, unsigned int row_end);
+	};
+
+};
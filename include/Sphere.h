@@ -37,7 +37,8 @@ namespace model
 	 * Creates a sphere with a certain \b radius , \b latitude \b precision and
 	 * \b longitude \b precision
 	 *
-	 * The resulting sphere is centered in the origin.
+	 * The resulting sphere is centered in the origin. Spheres with the same
+	 * arguments share their mesh data (see \c MeshCache ).
 	 * \param radius the radius of the sphere
 	 * \param latitude_precision precision of the latitude of the sphere
 	 * \param longitude_precision precision of the longitude of the sphere
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file SphereEntity.h
+ * \class giselle::scene::SphereEntity
+ * \brief A sphere tessellated to its size on screen
+ *
+ * The sphere is centered on the entity's position, and made by \c model::Sphere() with
+ * as many latitude divisions as half its segments (see <b>PrimitiveEntity</b>).
+ */
+#pragma once
+
+#include "PrimitiveEntity.h"
+
+namespace giselle
+{
+
+namespace scene
+{
+
+class SphereEntity : public PrimitiveEntity
+{
+	private:
+		float radius;
+
+	public:
+		/**
+		 * The one constructor to rule them all.
+		 * \param radius the radius of the sphere, more than 0
+		 * \param material the material of the sphere
+		 * \param pos position
+		 * \param ang orientation
+		 * \param children list of pointers to all children entities
+		 */
+		SphereEntity(float radius,
+				const model::Material& material = model::Material::BASE,
+				const math::Vector4f& pos = math::Vector4f(),
+				const math::Vector4f& ang = math::Vector4f(),
+				const std::list<Entity*> & children = std::list<Entity*>() );
+
+		/** Default destructor */
+		virtual ~SphereEntity();
+
+		/** Setter for the radius of the sphere
+		 * \param radius the new radius, more than 0
+		 */
+		void setRadius(float radius);
+
+		/** Getter for the radius of the sphere */
+		float getRadius(void) const;
+
+		/**
+		 * Gets the bounding box of the sphere.
+		 * \param min output reference to the box's minimum corner
+		 * \param max output reference to the box's maximum corner
+		 * \return true
+		 */
+		virtual bool getBounds(math::Vector4f& min, math::Vector4f& max) const;
+
+	protected:
+		virtual model::Model generate(unsigned int segments) const;
+		virtual float curve_radius(void) const;
+};
+
+};
+
+};
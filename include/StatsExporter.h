@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file StatsExporter.h
+ * \class giselle::StatsExporter
+ *
+ * \brief Publishes the statistics of each frame in POSIX shared memory
+ *
+ * The exporter creates a shared memory object holding a ring of records, one per
+ * rendered frame, with the frame's counters (see \c FrameStats ) and the last
+ * complete timings of the \c FrameProfiler. Another process can then follow the
+ * frames of a live process with a \c StatsExporter::Reader, without attaching to it
+ * or slowing it down.
+ *
+ * The ring has a single writer and is meant for a single reader. Publishing is
+ * wait-free: the writer never waits for the reader, and overwrites the oldest
+ * records when the reader falls behind (or there is no reader at all). Each slot
+ * carries a sequence number, written before and after the record, which lets the
+ * reader detect records that were overwritten while being read, and skip ahead to
+ * the oldest record still in the ring.
+ *
+ * The shared memory object is removed when the exporter is closed. A <b>GContext</b>
+ * creates one on request, see \c GContext::setStatsExport().
+ */
+#pragma once
+
+#include "FrameProfiler.h"
+#include "FrameStats.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace giselle
+{
+
+	class StatsExporter
+	{
+		public:
+			/** The statistics of a frame */
+			struct Record
+			{
+				/** index of the frame, counted from the opening of the exporter */
+				std::uint64_t frame;
+				/** time of publication, in nanoseconds of the monotonic clock */
+				std::uint64_t time_ns;
+				/** the frame's counters, indexed by \c FrameStats::Counter */
+				std::uint64_t counters[FrameStats::COUNTER_COUNT];
+				/** index of the frame of the timings, which trail the counters
+				 * by a few frames; \c UINT64_MAX if profiling is disabled */
+				std::uint64_t timed_frame;
+				/** CPU time of each zone, in milliseconds */
+				double cpu_ms[FrameProfiler::ZONE_COUNT];
+				/** CPU time of the whole frame, in milliseconds */
+				double cpu_total_ms;
+				/** GPU time of each zone, in milliseconds */
+				double gpu_ms[FrameProfiler::ZONE_COUNT];
+				/** sum of the GPU times of the zones, in milliseconds */
+				double gpu_total_ms;
+				/** whether the GPU times are available (0 or 1) */
+				std::uint64_t gpu_valid;
+			};
+
+			/** Default number of records in the ring */
+			static constexpr unsigned int DEFAULT_CAPACITY = 1024;
+
+			/**
+			 * \brief Follows the records of an exporter from another process
+			 */
+			class Reader
+			{
+				public:
+					/** Builds a closed reader */
+					Reader(void);
+
+					/** Destructor, unmaps the ring */
+					~Reader(void);
+
+					/** Copy constructor deleted */
+					Reader(const Reader& other) = delete;
+
+					/**
+					 * Maps the ring of an exporter. Reading starts at the
+					 * oldest record in the ring.
+					 * \param name the name given to \c StatsExporter::open()
+					 * \return whether the ring was mapped
+					 */
+					bool open(const std::string& name);
+
+					/** Unmaps the ring */
+					void close(void);
+
+					/** \return whether a ring is mapped */
+					bool isOpen(void) const;
+
+					/**
+					 * Reads the next record, if the writer published it.
+					 * \param record the record to fill
+					 * \return whether a record was read
+					 */
+					bool read(Record& record);
+
+					/**
+					 * \return the number of records overwritten before they
+					 * could be read
+					 */
+					std::uint64_t getLost(void) const;
+
+				private:
+					void* p_map;
+					std::size_t map_size;
+					std::uint64_t next; // index of the next record to read
+					std::uint64_t lost;
+			};
+
+			/** Builds a closed exporter */
+			StatsExporter(void);
+
+			/** Destructor, closes the exporter */
+			~StatsExporter(void);
+
+			/** Copy constructor deleted */
+			StatsExporter(const StatsExporter& other) = delete;
+
+			/**
+			 * Creates the shared memory object and its ring. An existing object
+			 * of the same name is replaced.
+			 * \param name name of the object, a slash followed by up to 254
+			 * characters other than slashes (see \c shm_open() )
+			 * \param capacity the number of records in the ring
+			 * \return whether the ring was created
+			 */
+			bool open(const std::string& name, unsigned int capacity = DEFAULT_CAPACITY);
+
+			/** Unmaps and removes the shared memory object */
+			void close(void);
+
+			/** \return whether a ring is open */
+			bool isOpen(void) const;
+
+			/**
+			 * Publishes the statistics of a frame. Wait-free.
+			 * \param stats the frame's counters
+			 * \param times the last complete timings of the frames
+			 */
+			void publish(const FrameStats& stats, const FrameProfiler::FrameTimes& times);
+
+			/** \return the name of the shared memory object, empty if closed */
+			const std::string& getName(void) const;
+
+		private:
+			struct Header;
+			struct Slot;
+
+			void* p_map;
+			std::size_t map_size;
+			std::string name;
+			std::uint64_t written; // records published
+
+			static std::size_t ring_size(unsigned int capacity);
+	};
+
+};
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file TraceRecorder.h
+ * \class giselle::TraceRecorder
+ *
+ * \brief Recording of timestamped events, exported as Chrome trace JSON
+ *
+ * The trace recorder logs the beginning and the end of the library's work: the stages
+ * of each rendered frame, the tasks of the job system, shader compilations and the
+ * generation of primitive models. Applications may add their own events with
+ * \c begin() and \c end(), or with a \c Scope.
+ *
+ * Each thread writes its events to a buffer of its own, without locking. \c flush()
+ * moves the recorded events of all threads to a stream in the Chrome \c trace_event
+ * JSON format, which both \c chrome://tracing and Perfetto open. When a thread's
+ * buffer is full, its new events are dropped until the next flush (see
+ * \c getDroppedEvents() ).
+ *
+ * Recording is disabled by default. While disabled, each event costs a single relaxed
+ * atomic load.
+ *
+ * Event names and categories are not copied: they must be string literals, or
+ * otherwise outlive the next flush.
+ */
+#pragma once
+
+#include <atomic>
+#include <ostream>
+#include <vector>
+#include <cstdint>
+
+namespace giselle
+{
+
+	class TraceRecorder
+	{
+		public:
+			/**
+			 * \brief Records an event for the lifetime of the object
+			 *
+			 * The end of the event is recorded if and only if its beginning was.
+			 */
+			class Scope
+			{
+				const char* name;
+				const char* category;
+				bool active;
+
+				public:
+					/**
+					 * Records the beginning of an event, if recording is enabled.
+					 * \param name the name of the event
+					 * \param category the category of the event
+					 */
+					Scope(const char* name, const char* category)
+					:	name(name)
+					,	category(category)
+					,	active(TraceRecorder::isEnabled())
+					{
+						if (this->active) TraceRecorder::begin(name, category);
+					}
+
+					/** Records the end of the event */
+					~Scope()
+					{
+						if (this->active) TraceRecorder::end(this->name, this->category);
+					}
+
+					/** Copy constructor deleted */
+					Scope(const Scope& other) = delete;
+			};
+
+			/**
+			 * Starts or stops recording. Events already recorded are kept until
+			 * the next flush.
+			 * \param enabled whether to record events
+			 */
+			static void setEnabled(bool enabled);
+
+			/** \return whether events are being recorded */
+			static bool isEnabled(void)
+			{
+				return enabled.load(std::memory_order_relaxed);
+			}
+
+			/**
+			 * Records the beginning of an event on the calling thread.
+			 * \param name the name of the event
+			 * \param category the category of the event
+			 */
+			static void begin(const char* name, const char* category);
+
+			/**
+			 * Records the end of an event on the calling thread.
+			 * \param name the name of the event, as given to \c begin()
+			 * \param category the category of the event, as given to \c begin()
+			 */
+			static void end(const char* name, const char* category);
+
+			/**
+			 * Writes the events recorded so far by all threads as a Chrome trace
+			 * JSON document, and removes them from the buffers. Threads may keep
+			 * recording in the meantime.
+			 * \param out the stream to write to
+			 * \return whether the stream is still good after writing
+			 */
+			static bool flush(std::ostream& out);
+
+			/** \return the number of events dropped because of full buffers */
+			static std::uint64_t getDroppedEvents(void);
+
+			/** Capacity of each thread's buffer, in events */
+			static constexpr unsigned int THREAD_CAPACITY = 1 << 15;
+
+		private:
+			struct Event;
+			struct ThreadBuffer;
+
+			static std::atomic<bool> enabled;
+
+			static void record(const char* name, const char* category, char phase);
+			static ThreadBuffer& thread_buffer(void);
+			static std::vector<ThreadBuffer*>& registry(void);
+	};
+
+};
@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2014 Eduardo Pinho (enet4mikeenet AT gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to
+ * whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall
+ * be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+/**
+ * \file VertexLayout.h
+ * \class giselle::model::VertexLayout
+ *
+ * \brief Describes how the attributes of a mesh's vertices are stored.
+ *
+ * A layout gives the format of each vertex attribute (position, normal, texture
+ * coordinates and color), or \c NONE for attributes the mesh does not have, and
+ * whether the attributes are interleaved (one record per vertex) or planar (one array
+ * per attribute, in the order of \c Attribute ).
+ *
+ * Every element is padded to a multiple of 4 bytes, so a normal in \c SNORM8 takes
+ * 4 bytes. Normalized integer formats map to [-1, 1] (signed) or [0, 1] (unsigned),
+ * and values out of range are clamped.
+ *
+ * Some formats are quantized encodings, meant for a single attribute and decoded by
+ * the vertex shader: \c BOUNDS16 stores positions relative to the bounding box of the
+ * mesh (8 bytes instead of 12), and \c OCT16 stores unit normals in the octahedral
+ * mapping (4 bytes instead of 12). \c SNORM10 packs 3 components in 10 bits each, and
+ * needs no decoding.
+ *
+ * The vertex data of a <b>MeshData</b> is kept in planar floats on the CPU (see
+ * \c planarFloat() ), and converted to the mesh's layout once, when it is uploaded to
+ * the GPU. \c convert() converts vertex data between any two layouts.
+ *
+ * The <b>Renderer</b> feeds the attributes to the vertex shader inputs \c pos,
+ * \c vnorm, \c uv and \c vcolor, skipping those the current program lacks.
+ */
+#include <cstddef>
+
+namespace giselle
+{
+namespace model
+{
+
+	struct VertexLayout
+	{
+		/** Vertex attributes */
+		enum Attribute
+		{
+			/** 3 components, always present */
+			POSITION,
+			/** 3 components, always present */
+			NORMAL,
+			/** 2 components */
+			TEXCOORD,
+			/** 4 components, RGBA */
+			COLOR
+		};
+
+		/** Number of attributes */
+		static constexpr unsigned int ATTRIBUTE_COUNT = 4;
+
+		/** Storage formats of the components of an attribute */
+		enum Format
+		{
+			/** attribute absent */
+			NONE,
+			/** 32-bit float */
+			FLOAT,
+			/** 16-bit float */
+			HALF,
+			/** 16-bit signed normalized integer */
+			SNORM16,
+			/** 16-bit unsigned normalized integer */
+			UNORM16,
+			/** 8-bit signed normalized integer */
+			SNORM8,
+			/** 8-bit unsigned normalized integer */
+			UNORM8,
+			/** 16-bit unsigned normalized integer, relative to the bounds of
+			 * the mesh; positions only */
+			BOUNDS16,
+			/** octahedral mapping in 2 16-bit signed normalized integers;
+			 * unit normals only */
+			OCT16,
+			/** 10-bit signed normalized integers, packed in 32 bits with 2
+			 * unused bits; 3-component attributes only */
+			SNORM10
+		};
+
+		/** format of each attribute */
+		Format formats[ATTRIBUTE_COUNT];
+		/** whether the attributes are interleaved */
+		bool interleaved;
+
+		/** Builds the default layout: interleaved float positions and normals */
+		VertexLayout(void);
+
+		/**
+		 * Builds a layout.
+		 * \param position format of the positions, must not be \c NONE
+		 * \param normal format of the normals, must not be \c NONE
+		 * \param texcoord format of the texture coordinates
+		 * \param color format of the colors
+		 * \param interleaved whether the attributes are interleaved
+		 */
+		VertexLayout(Format position, Format normal, Format texcoord, Format color,
+				bool interleaved);
+
+		/** \return whether the layout has the given attribute */
+		bool has(Attribute attribute) const;
+
+		/** \return the number of components of an attribute */
+		static unsigned int components(Attribute attribute);
+
+		/** \return the number of bytes of an attribute of a vertex, 0 if absent */
+		unsigned int elementSize(Attribute attribute) const;
+
+		/** \return the number of bytes between consecutive values of an attribute */
+		unsigned int stride(Attribute attribute) const;
+
+		/**
+		 * \param attribute the attribute
+		 * \param nVertices the number of vertices of the data
+		 * \return the offset in bytes of the attribute of the first vertex
+		 */
+		std::size_t offset(Attribute attribute, unsigned int nVertices) const;
+
+		/**
+		 * \param nVertices the number of vertices
+		 * \return the number of bytes of vertex data in this layout
+		 */
+		std::size_t size(unsigned int nVertices) const;
+
+		/** \return a planar float layout with the same attributes */
+		VertexLayout planarFloat(void) const;
+
+		/** \return whether both layouts are the same */
+		bool operator==(const VertexLayout& other) const;
+
+		/** \return whether the layouts differ */
+		bool operator!=(const VertexLayout& other) const;
+
+		/** \return whether the vertex shader has to decode the layout's
+		 * positions or normals */
+		bool isQuantized(void) const;
+
+		/**
+		 * Converts vertex data from a layout to another. Attributes missing in the
+		 * source get default values: a normal of (0,0,1), texture coordinates of
+		 * (0,0) and a white color.
+		 * \param from the layout of the source data
+		 * \param src the source data
+		 * \param to the layout of the destination data
+		 * \param dst the destination, of \c to.size(nVertices) bytes
+		 * \param nVertices the number of vertices
+		 * \param bounds the bounds of the positions, as 3 floats of minimum and 3
+		 * of maximum; required when either layout has \c BOUNDS16 positions
+		 */
+		static void convert(const VertexLayout& from, const void* src,
+				const VertexLayout& to, void* dst, unsigned int nVertices,
+				const float* bounds = nullptr);
+
+		/** Interleaved float positions and normals */
+		static const VertexLayout INTERLEAVED;
+
+		/** Planar float positions and normals, as drawn before layouts existed */
+		static const VertexLayout PLANAR;
+
+		/** Interleaved float positions and 8-bit normals, 16 bytes per
+		 * vertex instead of 24 */
+		static const VertexLayout COMPACT;
+
+		/** Interleaved \c BOUNDS16 positions and \c OCT16 normals, 12 bytes
+		 * per vertex */
+		static const VertexLayout QUANTIZED;
+	};
+
+};
+};